@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "footprint.h"
+
+enum class AttributeType { Float32, Float64 };
+
+// One named per-vertex property, stored in its own array at the precision it had
+// in the file. A column can be created with a decoder instead of values; the
+// decoder then runs the first time any value is asked for and is released after.
+class AttributeColumn
+{
+public:
+
+    // fills values (already sized to the column) and returns false if it could not
+    using Decoder = std::function<bool(std::vector<double>& values)>;
+
+private:
+
+    std::string m_name;
+    AttributeType m_type;
+    size_t m_size;
+
+    // only the array matching the type is used
+    mutable std::vector<float> m_float32;
+    mutable std::vector<double> m_float64;
+
+    mutable Decoder m_decoder;
+    mutable std::once_flag m_decode_once;
+    mutable std::atomic<bool> m_decoded;
+
+public:
+
+    AttributeColumn(const std::string& name, AttributeType type, size_t size, Decoder decoder = nullptr);
+
+    const std::string& name() const;
+    AttributeType type() const;
+    size_t size() const;
+    bool is_decoded() const;
+
+    // any of these decode the column on first use, from whichever thread gets there first
+    void decode() const;
+    double value(size_t i) const;
+    const float* float32_data() const;  // nullptr unless the type is Float32
+    const double* float64_data() const; // nullptr unless the type is Float64
+
+    void set_value(size_t i, double value);
+
+    // bytes of the decoded values, 0 until the column is decoded
+    size_t memory_bytes() const;
+};
+
+// The attribute columns of a mesh, in file order. Copies share their columns.
+class AttributeTable
+{
+private:
+
+    std::vector<std::shared_ptr<AttributeColumn>> m_columns;
+
+public:
+
+    // a column with the same name is replaced
+    void add(const std::shared_ptr<AttributeColumn>& column);
+    const AttributeColumn* find(const std::string& name) const;
+    const std::vector<std::shared_ptr<AttributeColumn>>& columns() const;
+    size_t size() const;
+    bool empty() const;
+    void clear();
+
+    // the values of every column, and the columns themselves as control blocks,
+    // columns shared with other tables are counted in each of them
+    MemoryFootprint footprint() const;
+};
@@ -5,35 +5,123 @@
 #include <memory>
 
 #include "shader.h"
-#include "quadmesh.h"
+#include "fieldmesh.h"
+#include "footprint.h"
 
 class DrawItem
 {
+public:
+
+    enum class DrawMode { Points, Wireframe, Surface };
+
+    // CPU side vertex and index data for a DrawItem, building it needs no GL context
+    // so it can be done on a worker thread and handed to the main thread for upload
+    struct Payload
+    {
+        std::vector<float> vertex_data;
+        std::vector<unsigned int> face_data;
+        std::vector<float> attribute_data; // surfaces only, see SURFACE_ATTRIBUTE_FLOATS
+        // surfaces only, the vertices across the edges of vertex v are
+        // neighbors[neighbor_offsets[v] .. neighbor_offsets[v + 1]]
+        std::vector<unsigned int> neighbor_offsets;
+        std::vector<unsigned int> neighbors;
+        int floats_per_vertex = 3; // 6 for surfaces (pos, normal), 3 for spheres, see TUBE_FLOATS_PER_VERTEX
+    };
+
+    // tube vertices are a position, then the normal and scalar of the mesh under them, which
+    // flat_color.vert displaces them by so streamlines follow a raised height field
+    static const int TUBE_FLOATS_PER_VERTEX = 7;
+
+    // surfaces keep the per-vertex values that change between time steps (scalar
+    // then vector) in their own buffer, so a new step only rewrites that buffer
+    static const int SURFACE_ATTRIBUTE_FLOATS = 4;
+    static void surfaceAttributes(double scalar, const glm::dvec3& vector, float* out);
+
+    // texture units of the buffer textures a surface binds for its vertex shaders, the
+    // ones after the LIC textures
+    static const int SURFACE_TEXTURE_UNIT = 2;
+
 private:
 
     // std::vector<glm::vec3> m_vertex_data;
     std::vector<float> m_vertex_data;
     std::vector<unsigned int> m_face_data;
+    std::vector<float> m_attribute_data;
+    std::vector<unsigned int> m_neighbor_offsets;
+    std::vector<unsigned int> m_neighbors;
+    int m_floats_per_vertex = 3;
 
     unsigned int m_VAO;
     unsigned int m_VBO;
     unsigned int m_EBO;
+    unsigned int m_ABO; // attribute buffer, only used by surfaces
+    unsigned int m_OBO; // neighbor offsets, only used by surfaces
+    unsigned int m_NBO; // neighbors, only used by surfaces
 
-public:
+    // buffer textures over the vertex, attribute and neighbor buffers, so the vertex
+    // shaders can read the neighbors of a vertex, 0 when the surface has none
+    unsigned int m_vertex_texture = 0;
+    unsigned int m_attribute_texture = 0;
+    unsigned int m_neighbor_offset_texture = 0;
+    unsigned int m_neighbor_texture = 0;
 
-    enum class DrawMode { Points, Wireframe, Surface };
+    // size of each buffer on the GPU, these outlast the staging copies above
+    size_t m_vertex_bytes = 0;
+    size_t m_face_bytes = 0;
+    size_t m_attribute_bytes = 0;
+    size_t m_neighbor_offset_bytes = 0;
+    size_t m_neighbor_bytes = 0;
+
+    // bytes of each buffer sent to the GPU so far
+    size_t m_uploaded_vertex_bytes = 0;
+    size_t m_uploaded_face_bytes = 0;
+    size_t m_uploaded_attribute_bytes = 0;
+    size_t m_uploaded_neighbor_offset_bytes = 0;
+    size_t m_uploaded_neighbor_bytes = 0;
+
+    bool m_release_staging = false;
+
+public:
 
     // add the resolution and radius parameters
-    DrawItem(const QuadMesh& mesh, DrawMode draw_mode = DrawMode::Surface, int resolution = 4, float radius = 0.1f); 
+    DrawItem(const FieldMesh& mesh, DrawMode draw_mode = DrawMode::Surface, int resolution = 4, float radius = 0.1f);
+    // take over a payload, with max_upload_bytes = 0 the whole payload is uploaded
+    // right away, otherwise call upload() once per frame until it returns true
+    DrawItem(Payload&& payload, size_t max_upload_bytes = 0);
     ~DrawItem();
 
+    static Payload buildPayload(const FieldMesh& mesh, DrawMode draw_mode = DrawMode::Surface, int resolution = 4, float radius = 0.1f);
+
+    // upload at most max_bytes more of the payload, returns true once everything is on the GPU
+    bool upload(size_t max_bytes);
+    bool isUploaded() const;
+
+    // replace the scalar and vector values of a surface, SURFACE_ATTRIBUTE_FLOATS per vertex,
+    // only the ranges of vertices whose values changed are sent to the GPU
+    void updateAttributes(const std::vector<float>& attribute_data);
+
+    // bind the buffer textures of a surface and point the samplers of shader at them,
+    // its vertex shader works out the scalar gradient at a vertex from the neighbors
+    // when it displaces a height field (surfaceNeighbors is false when there are none)
+    void bindSurfaceTextures(const Shader& shader) const;
+
+    // drop the CPU copies of the vertex, face and attribute data once all of it is on the
+    // GPU, attribute updates then resend the whole buffer instead of what changed
+    void setReleaseStaging(bool release);
+    // the staging copies and the GPU buffers, a draw item keeps nothing else of size
+    MemoryFootprint footprint() const;
+
     void draw() const;
 
 private:
 
-    void initializeSurface(const QuadMesh& mesh);
+    static void buildSurface(const FieldMesh& mesh, Payload& payload);
     // add the tube_sides and tube_radius parameters
-    void initializeTubes(const QuadMesh& mesh, int tube_sides, float tube_radius); 
+    static void buildTubes(const FieldMesh& mesh, int tube_sides, float tube_radius, Payload& payload);
     // add the sphere_divisions and sphere_radius parameters
-    void initializeSpheres(const QuadMesh& mesh, int shpere_divisions, float sphere_radius); 
+    static void buildSpheres(const FieldMesh& mesh, int shpere_divisions, float sphere_radius, Payload& payload);
+
+    void initializeBuffers();
+    void initializeSurfaceTextures();
+    void releaseStaging();
 };
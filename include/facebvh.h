@@ -0,0 +1,143 @@
+#pragma once
+#include <glm/vec2.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "halfedgemesh.h"
+
+// Bounding volume hierarchy over the x-y bounding boxes of a mesh's faces, split
+// with the surface area heuristic (here the half perimeter, as the boxes are 2D),
+// so it stays shallow where small faces crowd together next to large ones. The
+// nodes live in one array, the two children of a node side by side, and their
+// boxes are floats rounded outward, which keeps a node to 24 bytes.
+class FaceBVH
+{
+public:
+
+    struct Node
+    {
+        float min_x, min_y, max_x, max_y;
+        uint32_t first; // first face in faces() for a leaf, left child for an inner node (right is first + 1)
+        uint32_t count; // number of faces, 0 for an inner node
+    };
+
+private:
+
+    std::vector<Node> m_nodes;     // root first
+    std::vector<uint32_t> m_faces; // face indices, the ones of each leaf together
+    size_t m_depth = 0;
+
+    // the traversals keep the nodes still to visit on a fixed stack, the build keeps
+    // the tree shallow enough for it
+    static const size_t STACK_SIZE = 128;
+
+public:
+
+    FaceBVH() = default;
+    explicit FaceBVH(const HalfEdgeMesh& mesh);
+
+    const std::vector<Node>& nodes() const { return m_nodes; }
+    const std::vector<uint32_t>& faces() const { return m_faces; }
+    size_t depth() const { return m_depth; }
+
+    // calls fn(face) for every face whose box contains point, in no particular order
+    template <typename Function>
+    void for_each_face_at(const glm::dvec2& point, Function fn) const
+    {
+        for_each_leaf([&](const Node& node)
+        {
+            return point.x >= node.min_x && point.x <= node.max_x && point.y >= node.min_y && point.y <= node.max_y;
+        }, fn);
+    }
+
+    // calls fn(face) for every face whose box overlaps the box from min to max, in no particular order
+    template <typename Function>
+    void for_each_face_overlapping(const glm::dvec2& min, const glm::dvec2& max, Function fn) const
+    {
+        for_each_leaf([&](const Node& node)
+        {
+            return max.x >= node.min_x && min.x <= node.max_x && max.y >= node.min_y && min.y <= node.max_y;
+        }, fn);
+    }
+
+    // the face with the smallest distance2(face), the squared distance from point to the
+    // face, which the box distance is a lower bound of, and HalfEdgeMesh::INVALID if the
+    // mesh has no faces or none is within max_distance
+    template <typename Function>
+    uint32_t nearest_face(const glm::dvec2& point, Function distance2,
+        double max_distance = std::numeric_limits<double>::infinity()) const
+    {
+        uint32_t best = HalfEdgeMesh::INVALID;
+        double best_distance2 = max_distance * max_distance;
+        if (m_nodes.empty())
+            return best;
+        uint32_t stack[STACK_SIZE];
+        size_t size = 0;
+        stack[size++] = 0;
+        while (size > 0)
+        {
+            const Node& node = m_nodes[stack[--size]];
+            if (box_distance2(node, point) > best_distance2)
+                continue;
+            if (node.count > 0)
+            {
+                for (uint32_t i = node.first; i < node.first + node.count; i++)
+                {
+                    double d2 = distance2(m_faces[i]);
+                    if (d2 < best_distance2 || (d2 == best_distance2 && m_faces[i] < best))
+                    {
+                        best_distance2 = d2;
+                        best = m_faces[i];
+                    }
+                }
+                continue;
+            }
+            // the nearer child goes on top so it is searched first
+            const double left = box_distance2(m_nodes[node.first], point);
+            const double right = box_distance2(m_nodes[node.first + 1], point);
+            stack[size++] = (left <= right) ? node.first + 1 : node.first;
+            stack[size++] = (left <= right) ? node.first : node.first + 1;
+        }
+        return best;
+    }
+
+    size_t memory_bytes() const;
+
+private:
+
+    // calls fn(face) for the faces of every leaf that visit(node) accepts, descending
+    // only into the inner nodes it accepts
+    template <typename Visit, typename Function>
+    void for_each_leaf(Visit visit, Function fn) const
+    {
+        if (m_nodes.empty())
+            return;
+        uint32_t stack[STACK_SIZE];
+        size_t size = 0;
+        stack[size++] = 0;
+        while (size > 0)
+        {
+            const Node& node = m_nodes[stack[--size]];
+            if (!visit(node))
+                continue;
+            if (node.count > 0)
+            {
+                for (uint32_t i = node.first; i < node.first + node.count; i++)
+                    fn(m_faces[i]);
+                continue;
+            }
+            stack[size++] = node.first + 1;
+            stack[size++] = node.first;
+        }
+    }
+
+    static double box_distance2(const Node& node, const glm::dvec2& point)
+    {
+        double dx = std::max(std::max(node.min_x - point.x, point.x - node.max_x), 0.0);
+        double dy = std::max(std::max(node.min_y - point.y, point.y - node.max_y), 0.0);
+        return dx * dx + dy * dy;
+    }
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "halfedgemesh.h"
+
+// Uniform grid of buckets over the x-y bounding boxes of a mesh's faces. Every face
+// is listed, in face order, in each bucket its box overlaps, so the faces that can
+// contain a point are the ones in the point's bucket. The buckets are about the mean
+// face size across, which keeps the expected number of candidates per point constant
+// when the faces are of similar size.
+class FaceGrid
+{
+private:
+
+    glm::dvec2 m_min = glm::dvec2(0.0); // bounds of the face boxes
+    glm::dvec2 m_max = glm::dvec2(0.0);
+    glm::dvec2 m_inverse_cell_size = glm::dvec2(0.0);
+    size_t m_nx = 0;
+    size_t m_ny = 0;
+    double m_mean_candidates = 0.0;
+
+    // the faces of bucket i + j * nx are m_cell_faces[m_cell_offsets[i + j * nx] ..
+    // m_cell_offsets[i + j * nx + 1]]
+    std::vector<uint32_t> m_cell_offsets;
+    std::vector<uint32_t> m_cell_faces;
+
+public:
+
+    FaceGrid() = default;
+    explicit FaceGrid(const HalfEdgeMesh& mesh);
+
+    size_t nx() const;
+    size_t ny() const;
+    // faces in the bucket of a face, on average over the faces, about what a point inside the mesh gets
+    double mean_candidates() const;
+
+    // faces whose bounding box overlaps the bucket of point, in face order, none outside the grid
+    std::pair<const uint32_t*, const uint32_t*> candidates(const glm::dvec3& point) const;
+
+    size_t memory_bytes() const;
+
+private:
+
+    // bucket column or row of a coordinate, clamped to the grid
+    size_t column(double x) const;
+    size_t row(double y) const;
+};
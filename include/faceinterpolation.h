@@ -0,0 +1,151 @@
+#pragma once
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "halfedgemesh.h"
+
+// Per-face coefficients for interpolating vertex values inside the quads of a mesh,
+// worked out once so a sample costs a few multiply-adds, a square root and four
+// fetches instead of a scan of the quad's corners. A quad is the bilinear map
+//     p(s, t) = a + e s + f t + g s t
+// from the unit square to the x-y plane that takes (0, 0), (1, 0), (1, 1) and (0, 1)
+// to its corners in winding order. The local coordinates (s, t) of a point come from
+// inverting the map in closed form, so skewed and curvilinear quads interpolate as
+// well as axis aligned ones. The coefficients are kept as a struct of arrays, one
+// array per coefficient.
+class FaceInterpolation
+{
+public:
+
+    // the bilinear map of one quad, with the parts of the inverse that do not depend
+    // on the point
+    struct Quad
+    {
+        glm::dvec2 a, e, f, g;
+        double ef; // cross(e, f)
+        double gf; // cross(g, f)
+    };
+
+private:
+
+    // by face, the coefficients of its Quad
+    std::vector<double> m_ax, m_ay, m_ex, m_ey, m_fx, m_fy, m_gx, m_gy, m_ef, m_gf;
+    // by face, 4 each: its vertices in winding order, at (0, 0), (1, 0), (1, 1) and (0, 1)
+    std::vector<uint32_t> m_corners;
+
+public:
+
+    FaceInterpolation() = default;
+    explicit FaceInterpolation(const HalfEdgeMesh& mesh);
+
+    // the map of the quad with these corners in winding order
+    static Quad quad(const glm::dvec2 corners[4]);
+    // (s, t) of point in the quad, clamped to the unit square for points just outside
+    static glm::dvec2 local_coordinates(const Quad& quad, const glm::dvec2& point);
+    // weights of the 4 corners in winding order at local coordinates st, summing to 1
+    static void weights(const glm::dvec2& st, double w[4])
+    {
+        w[0] = (1.0 - st.x) * (1.0 - st.y);
+        w[1] = st.x * (1.0 - st.y);
+        w[2] = st.x * st.y;
+        w[3] = (1.0 - st.x) * st.y;
+    }
+
+    size_t num_faces() const { return m_ax.size(); }
+    const uint32_t* corners(uint32_t f) const { return &m_corners[4 * size_t(f)]; }
+    Quad quad(uint32_t f) const
+    {
+        return Quad{ glm::dvec2(m_ax[f], m_ay[f]), glm::dvec2(m_ex[f], m_ey[f]),
+                     glm::dvec2(m_fx[f], m_fy[f]), glm::dvec2(m_gx[f], m_gy[f]), m_ef[f], m_gf[f] };
+    }
+
+    // weights of the corners of face f at point
+    void weights(uint32_t f, const glm::dvec3& point, double w[4]) const
+    {
+        weights(local_coordinates(quad(f), glm::dvec2(point)), w);
+    }
+
+    // the value at point in face f, from value(v) at each corner vertex v
+    template <typename Value, typename Function>
+    Value interpolate(uint32_t f, const glm::dvec3& point, Function value) const
+    {
+        double w[4];
+        weights(f, point, w);
+        const uint32_t* c = corners(f);
+        return w[0] * Value(value(c[0])) + w[1] * Value(value(c[1])) +
+               w[2] * Value(value(c[2])) + w[3] * Value(value(c[3]));
+    }
+
+    size_t memory_bytes() const;
+
+private:
+
+    static double cross(const glm::dvec2& u, const glm::dvec2& v) { return u.x * v.y - u.y * v.x; }
+    // s on the line of the quad at t, through point (h = point - a)
+    static double s_at(const Quad& quad, const glm::dvec2& h, double t);
+};
+
+inline FaceInterpolation::Quad FaceInterpolation::quad(const glm::dvec2 corners[4])
+{
+    Quad q;
+    q.a = corners[0];
+    q.e = corners[1] - corners[0];
+    q.f = corners[3] - corners[0];
+    q.g = corners[0] - corners[1] + corners[2] - corners[3];
+    q.ef = cross(q.e, q.f);
+    q.gf = cross(q.g, q.f);
+    return q;
+}
+
+inline double FaceInterpolation::s_at(const Quad& quad, const glm::dvec2& h, double t)
+{
+    // h - f t = s (e + g t), solved along the larger component
+    const glm::dvec2 num = h - quad.f * t;
+    const glm::dvec2 den = quad.e + quad.g * t;
+    if (std::abs(den.x) >= std::abs(den.y))
+        return (den.x != 0.0) ? num.x / den.x : 0.5;
+    return num.y / den.y;
+}
+
+inline glm::dvec2 FaceInterpolation::local_coordinates(const Quad& quad, const glm::dvec2& point)
+{
+    // crossing h - f t = s (e + g t) with e + g t leaves k2 t^2 + k1 t + k0 = 0
+    const glm::dvec2 h = point - quad.a;
+    const double k0 = cross(h, quad.e);
+    const double k1 = quad.ef + cross(h, quad.g);
+    const double k2 = quad.gf;
+    double t0, t1;
+    if (k2 == 0.0)
+    {
+        // a parallelogram, which every axis aligned quad is, makes it linear
+        t0 = t1 = (k1 != 0.0) ? -k0 / k1 : 0.5;
+    }
+    else
+    {
+        // the two roots without cancellation, t0 the one that stays finite as the quad
+        // nears a parallelogram
+        const double root = std::sqrt(std::max(k1 * k1 - 4.0 * k0 * k2, 0.0));
+        const double m = -0.5 * (k1 + std::copysign(root, k1));
+        t0 = (m != 0.0) ? k0 / m : 0.0;
+        t1 = m / k2;
+    }
+
+    // the root that lands inside the unit square, or nearest it
+    auto outside = [](const glm::dvec2& st)
+    {
+        return std::max(std::max(-st.x, st.x - 1.0), std::max(-st.y, st.y - 1.0));
+    };
+    glm::dvec2 st(s_at(quad, h, t0), t0);
+    if (t1 != t0)
+    {
+        const glm::dvec2 other(s_at(quad, h, t1), t1);
+        if (outside(other) < outside(st))
+            st = other;
+    }
+    return glm::dvec2(std::min(std::max(st.x, 0.0), 1.0), std::min(std::max(st.y, 0.0), 1.0));
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <glm/vec3.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "attributes.h"
+#include "footprint.h"
+
+struct PlyData;
+
+// called by the loading constructor as it moves through its stages, fraction is in [0, 1]
+using LoadProgress = std::function<void(const char* stage, double fraction)>;
+
+// Where FieldMesh::sample writes the fields, one value per point in each array that
+// is set. Points outside the mesh get NaN.
+struct FieldSamples
+{
+    double* scalars = nullptr;
+    glm::dvec3* vectors = nullptr; // projected to x-y, like the streamlines use them
+    // attribute columns of the mesh and an array for each, a tensor is sampled as
+    // one column per component
+    std::vector<const AttributeColumn*> columns;
+    std::vector<double*> column_values;
+};
+
+// What the viewer needs from a loaded dataset, whether it is held as an explicit
+// QuadMesh or as a StructuredGrid2D. Vertices keep their index from the .ply file,
+// so per-vertex arrays (time series frames, attribute buffers) work with either.
+class FieldMesh
+{
+public:
+
+    virtual ~FieldMesh() = default;
+
+    // open a .ply file as a StructuredGrid2D if it is a regular lattice, as a QuadMesh otherwise
+    static std::unique_ptr<FieldMesh> open(const char* filename, bool verbose = true,
+        const LoadProgress& progress = nullptr);
+    // same, with the file contents already read by the caller
+    static std::unique_ptr<FieldMesh> open(const char* filename, const PlyData& ply, bool verbose = true,
+        const LoadProgress& progress = nullptr);
+
+    virtual size_t num_vertices() const = 0;
+    virtual size_t num_edges() const = 0;
+    virtual size_t num_faces() const = 0;
+
+    virtual glm::dvec3 vertex_position(size_t v) const = 0;
+    virtual glm::dvec3 vertex_normal(size_t v) const = 0;
+    virtual double vertex_scalar(size_t v) const = 0;
+    virtual glm::dvec3 vertex_vector(size_t v) const = 0;
+    // the vertex properties without a slot of their own (see plyreader.h)
+    virtual const AttributeTable& attributes() const = 0;
+    virtual AttributeTable& attributes() = 0;
+    // vertex indices of an edge, and of a quad in winding order
+    virtual void edge_vertices(size_t e, unsigned int ids[2]) const = 0;
+    virtual void face_vertices(size_t f, unsigned int ids[4]) const = 0;
+
+    virtual glm::dvec3 midpoint() const = 0;
+    virtual double get_radius() const = 0;
+    virtual void print_info() const = 0;
+    // the memory held by the mesh, including its attribute columns
+    virtual MemoryFootprint footprint() const = 0;
+
+    // hash of the face list and vertex positions as loaded, meshes with the same
+    // hash can exchange vertex attributes without rebuilding anything
+    virtual uint64_t topology_hash() const = 0;
+
+    virtual void get_min_max_scalar(double& min_scalar, double& max_scalar) const = 0;
+    virtual void get_min_max_coords(double& min_x, double& max_x,
+                                    double& min_y, double& max_y,
+                                    double& min_z, double& max_z) const = 0;
+    virtual double get_grid_spacing() const = 0;
+
+    // replace every vertex scalar and vector, 4 values per vertex (s, vx, vy, vz)
+    virtual void set_vertex_attributes(const std::vector<double>& values) = 0;
+
+    // streamline through the centroid of face f, traced backward then forward
+    virtual void compute_face_xy_streamline(std::vector<glm::dvec3>& streamline, size_t f,
+        double step_size, int num_steps) const = 0;
+
+    // the fields at count points, interpolated inside the face each point is in (at its
+    // x and y), split over the worker threads. Points next to each other in the array
+    // that are close together in space are found fastest.
+    virtual void sample(const glm::dvec3* points, size_t count, const FieldSamples& out) const = 0;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <iomanip>
+#include <ostream>
+
+// Bytes held by a mesh or a draw item, split by what they are for. Arrays count
+// their capacity, which is what was actually allocated for them.
+struct MemoryFootprint
+{
+    size_t positions = 0;      // vertex positions and normals, face normals
+    size_t attributes = 0;     // scalars, vectors and named attribute columns
+    size_t adjacency = 0;      // faces, edges, half-edges and index maps
+    size_t control_blocks = 0; // shared_ptr control blocks and the objects that own the arrays
+    size_t staging = 0;        // CPU copies of data that is also on the GPU
+    size_t gpu = 0;            // estimated, from the sizes the buffers were allocated with
+
+    // a make_shared control block beyond the object it holds, its vtable and two counts
+    static const size_t SHARED_CONTROL_BLOCK_BYTES = sizeof(void*) + 2 * sizeof(int);
+
+    size_t cpu_total() const { return positions + attributes + adjacency + control_blocks + staging; }
+
+    MemoryFootprint& operator+=(const MemoryFootprint& other)
+    {
+        positions += other.positions;
+        attributes += other.attributes;
+        adjacency += other.adjacency;
+        control_blocks += other.control_blocks;
+        staging += other.staging;
+        gpu += other.gpu;
+        return *this;
+    }
+
+    // one line per category, in MB
+    void print(std::ostream& out, const char* label) const
+    {
+        const double mb = 1024.0 * 1024.0;
+        std::ios_base::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(2);
+        out << label << " memory: " << cpu_total() / mb << " MB on the CPU, " << gpu / mb << " MB on the GPU" << std::endl;
+        out << "  positions: " << positions / mb << " MB" << std::endl;
+        out << "  attributes: " << attributes / mb << " MB" << std::endl;
+        out << "  adjacency: " << adjacency / mb << " MB" << std::endl;
+        out << "  control blocks: " << control_blocks / mb << " MB" << std::endl;
+        out << "  staging copies: " << staging / mb << " MB" << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+    }
+};
+
+// bytes allocated for a vector's elements
+template <typename Vector>
+size_t capacity_bytes(const Vector& v)
+{
+    return v.capacity() * sizeof(typename Vector::value_type);
+}
@@ -0,0 +1,209 @@
+#pragma once
+#include <glm/vec3.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+// Running totals of the memory taken by mesh arrays, across all meshes. A load
+// should add a few allocations per array, not one per vertex, edge or face.
+struct MeshAllocationStats
+{
+    std::atomic<size_t> allocations{0};
+    std::atomic<size_t> deallocations{0};
+    std::atomic<size_t> bytes_in_use{0};
+    std::atomic<size_t> peak_bytes{0};
+};
+
+inline MeshAllocationStats& mesh_allocation_stats()
+{
+    static MeshAllocationStats stats;
+    return stats;
+}
+
+// std::allocator that keeps mesh_allocation_stats() up to date
+template <typename T>
+struct MeshAllocator
+{
+    using value_type = T;
+
+    MeshAllocator() = default;
+    template <typename U>
+    MeshAllocator(const MeshAllocator<U>&) {}
+
+    T* allocate(size_t n)
+    {
+        MeshAllocationStats& stats = mesh_allocation_stats();
+        const size_t bytes = n * sizeof(T);
+        stats.allocations.fetch_add(1, std::memory_order_relaxed);
+        const size_t in_use = stats.bytes_in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = stats.peak_bytes.load(std::memory_order_relaxed);
+        while (in_use > peak && !stats.peak_bytes.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {}
+        return static_cast<T*>(::operator new(bytes));
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        MeshAllocationStats& stats = mesh_allocation_stats();
+        stats.deallocations.fetch_add(1, std::memory_order_relaxed);
+        stats.bytes_in_use.fetch_sub(n * sizeof(T), std::memory_order_relaxed);
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const MeshAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const MeshAllocator<U>&) const { return false; }
+};
+
+template <typename T>
+using MeshArray = std::vector<T, MeshAllocator<T>>;
+
+// Precision of a mesh's vertex and face values. MatchFile is only a load setting:
+// it picks Float32 when every position, normal, scalar and vector property in the
+// file fits in a float, and Float64 otherwise.
+enum class MeshPrecision { MatchFile, Float32, Float64 };
+
+// Order of the vertices and faces in a mesh's arrays. FileOrder keeps them as the
+// file lists them, Morton sorts both along a Z-order curve through the bounding box
+// so neighbors in space are mostly neighbors in memory.
+enum class MeshLayout { FileOrder, Morton };
+
+// The per-vertex and per-face values of a mesh at one precision
+template <typename Real>
+struct MeshGeometry
+{
+    using real = Real;
+    using vec3 = glm::vec<3, Real>;
+
+    // by vertex
+    MeshArray<vec3> positions;
+    MeshArray<vec3> normals;
+    MeshArray<Real> scalars;
+    MeshArray<vec3> vectors;
+
+    // by face
+    MeshArray<vec3> face_normals;
+};
+
+// Index based storage behind QuadMesh. Every quad f owns the half-edges 4f .. 4f+3,
+// half-edge 4f+k runs from corner k to corner k+1 of the quad, so its face and the
+// next and previous half-edges follow from the index and only its twin is stored.
+// Per-vertex and per-face values each live in their own contiguous array, so the
+// whole mesh is a fixed number of allocations and is freed by releasing those.
+// The values are held in float or double, see geometry(); the accessors below
+// return double either way.
+struct HalfEdgeMesh
+{
+    static constexpr uint32_t INVALID = UINT32_MAX;
+
+    MeshPrecision precision = MeshPrecision::Float64; // Float32 or Float64
+    MeshGeometry<float> geometry32;   // only the one matching precision is used
+    MeshGeometry<double> geometry64;
+
+    // by vertex
+    MeshArray<uint32_t> vertex_half;  // half-edge leaving the vertex in the first face of its ring
+    MeshArray<uint32_t> vertex_ids;   // index of the vertex in the file, empty in file order
+    MeshArray<uint32_t> id_vertices;  // the other way around, also empty in file order
+
+    // by face
+    MeshArray<uint32_t> face_ids;     // index of the quad in the file's face list
+
+    // by half-edge
+    MeshArray<uint32_t> half_vertex;  // origin, so 4 per face are the quad's corners in order
+    MeshArray<uint32_t> half_twin;    // half-edge across the edge, INVALID on the boundary
+    MeshArray<uint32_t> half_edge;
+
+    // by edge
+    MeshArray<uint32_t> edge_vertices; // v1 then v2
+    MeshArray<uint32_t> edge_half;     // first half-edge along it, INVALID for edges without faces
+
+    size_t num_vertices() const
+    {
+        return is_float32() ? geometry32.positions.size() : geometry64.positions.size();
+    }
+    size_t num_edges() const { return edge_half.size(); }
+    size_t num_faces() const { return face_ids.size(); }
+
+    bool is_float32() const { return precision == MeshPrecision::Float32; }
+
+    uint32_t vertex_id(uint32_t v) const { return vertex_ids.empty() ? v : vertex_ids[v]; }
+    uint32_t vertex_of_id(uint32_t id) const { return id_vertices.empty() ? id : id_vertices[id]; }
+
+    // calls fn with the geometry in use, so loops over the values can be written
+    // once as a generic lambda and compiled for each precision
+    template <typename Function>
+    decltype(auto) geometry(Function fn)
+    {
+        return is_float32() ? fn(geometry32) : fn(geometry64);
+    }
+    template <typename Function>
+    decltype(auto) geometry(Function fn) const
+    {
+        return is_float32() ? fn(geometry32) : fn(geometry64);
+    }
+
+    glm::dvec3 position(uint32_t v) const
+    {
+        return is_float32() ? glm::dvec3(geometry32.positions[v]) : geometry64.positions[v];
+    }
+    glm::dvec3 normal(uint32_t v) const
+    {
+        return is_float32() ? glm::dvec3(geometry32.normals[v]) : geometry64.normals[v];
+    }
+    double scalar(uint32_t v) const
+    {
+        return is_float32() ? double(geometry32.scalars[v]) : geometry64.scalars[v];
+    }
+    glm::dvec3 vector(uint32_t v) const
+    {
+        return is_float32() ? glm::dvec3(geometry32.vectors[v]) : geometry64.vectors[v];
+    }
+    glm::dvec3 face_normal(uint32_t f) const
+    {
+        return is_float32() ? glm::dvec3(geometry32.face_normals[f]) : geometry64.face_normals[f];
+    }
+
+    static uint32_t face_of(uint32_t h) { return h >> 2; }
+    static uint32_t next(uint32_t h) { return (h & ~3u) | ((h + 1) & 3u); }
+    static uint32_t prev(uint32_t h) { return (h & ~3u) | ((h + 3) & 3u); }
+
+    // the half-edge leaving v in the face of h, where h is a half-edge of that face
+    // that starts or ends at v (twins may run either way if the winding flips)
+    uint32_t leaving(uint32_t h, uint32_t v) const { return half_vertex[h] == v ? h : next(h); }
+
+    // whether the first face in the ring of v has no neighbor before it
+    bool ring_is_open(uint32_t v) const
+    {
+        uint32_t h = vertex_half[v];
+        return h != INVALID && half_twin[h] == INVALID;
+    }
+
+    // calls fn(h) with the half-edge leaving v in each face around it, in ring order
+    // starting at vertex_half[v], the face is face_of(h) and the edge crossed to get
+    // to the next face is half_edge[prev(h)]
+    template <typename Function>
+    void for_each_ring_half(uint32_t v, Function fn) const
+    {
+        const uint32_t start = vertex_half[v];
+        if (start == INVALID)
+            return;
+        uint32_t h = start;
+        for (size_t steps = 0; steps <= num_faces(); steps++)
+        {
+            fn(h);
+            uint32_t t = half_twin[prev(h)];
+            if (t == INVALID)
+                return;
+            h = leaving(t, v);
+            if (face_of(h) == face_of(start))
+                return;
+        }
+    }
+
+    void clear()
+    {
+        *this = HalfEdgeMesh();
+    }
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+
+// read-only memory mapping of an entire file
+// the mapping is released when the object goes out of scope
+class MappedFile
+{
+private:
+
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+
+public:
+
+    MappedFile(const char* filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool is_open() const;
+    const char* data() const;
+    size_t size() const;
+
+private:
+
+    void close();
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+
+// Loads a .ply file as a QuadMesh in file order and again along a Morton curve
+// (see MeshLayout), times the normal, interpolation and streamline loops on each,
+// and prints the two side by side. Cache misses are counted by replaying the
+// vertex fetches of the normal loop through a simulated 32 KB, 8-way L1 cache.
+bool run_layout_benchmark(const char* filename);
+
+// Times point location through a bucket grid of the faces (see FaceGrid) and through a
+// bounding volume hierarchy (see FaceBVH) against checking every face in turn, for 1M
+// random points within the bounds of the mesh in filename and of a generated grid of
+// synthetic_faces quads, then QuadMesh::locate against the lookup along a path of 1M
+// points close together.
+bool run_locator_benchmark(const char* filename, size_t synthetic_faces = 10000000);
+
+// Times FieldMesh::sample against locating and interpolating one point at a time, for
+// the vectors at a 1000 x 1000 raster over the bounds of the mesh in filename and at
+// as many random points, on the file as a QuadMesh and, if it is a regular lattice,
+// as a StructuredGrid2D, and prints the samples per second and the largest difference.
+// Then compares the inverse bilinear interpolation inside faces (see FaceInterpolation)
+// with the axis aligned box interpolation it replaced, for speed and for how exactly it
+// gives back the positions of the points, on the file and on a generated grid of
+// irregular quads.
+bool run_sampling_benchmark(const char* filename);
+
+// Times read_ply_file on ASCII files against a kept copy of the getline and istringstream
+// loop it replaced, on filename and on a generated synthetic_vertices vertex grid written
+// to the temporary directory and deleted afterwards, and checks both read the same values.
+bool run_ply_benchmark(const char* filename, size_t synthetic_vertices = 10000000);
+
+// Times QuadMesh::set_up_edges against a kept copy of the search around vertex rings it
+// replaced, on generated grids of 1M, 4M and 16M quads with the faces in grid order and
+// shuffled, and checks both give the same twins and edge numbers.
+bool run_edge_benchmark();
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct PlyData;
+class MappedFile;
+
+// A mesh cache file stores everything QuadMesh builds after parsing a .ply file
+// (vertex values, normals, half-edges, edges and where each vertex ring starts),
+// so the file can be reopened without rebuilding the topology. Attribute columns are not
+// stored, they are decoded from the .ply file itself when used. A file that
+// FieldMesh::open found to be a regular grid gets a StructuredGrid2D cache instead,
+// with its lattice in the header, so it is not parsed again to tell.
+//
+// Layout of a quad mesh: MeshCacheHeader, then these arrays, each padded to 8 bytes
+//   double   vertex_values[num_vertices * 10]  pos, normal, scalar, vector
+//   double   face_normals[num_faces * 3]
+//   uint32_t face_ids[num_faces]
+//   uint32_t half_vertex[num_faces * 4]        see HalfEdgeMesh
+//   uint32_t half_twin[num_faces * 4]
+//   uint32_t half_edge[num_faces * 4]
+//   uint32_t edge_vertices[num_edges * 2]
+//   uint32_t edge_half[num_edges]
+//   uint32_t vertex_half[num_vertices]
+//   uint32_t vertex_ids[num_vertices]          only if the vertices were reordered
+//
+// Layout of a grid: MeshCacheHeader, then
+//   double   scalars[num_vertices]
+//   double   vectors[num_vertices * 3]
+//   uint32_t node_vertex[num_vertices]         only if the file is not in lattice order
+
+const char MESH_CACHE_MAGIC[8] = { 'Q', 'M', 'C', 'A', 'C', 'H', 'E', '\0' };
+const uint32_t MESH_CACHE_VERSION = 7;
+const size_t MESH_CACHE_VERTEX_VALUES = 10;
+
+// what a cache file holds
+enum class MeshCacheKind : uint32_t
+{
+    Mesh = 0,        // a quad mesh, the file was not checked for a regular grid
+    CheckedMesh = 1, // a quad mesh of a file FieldMesh::open found not to be a regular grid
+    Grid = 2         // a StructuredGrid2D
+};
+
+struct MeshCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t source_hash;  // content hash of the .ply file the cache was built from
+    uint64_t source_size;
+    uint64_t num_vertices;
+    uint64_t num_edges;
+    uint64_t num_faces;
+    double midpoint[3];
+    double radius;
+    uint64_t topology_hash;
+    uint32_t float32;        // 1 if the mesh held its values in float32, they are stored as doubles either way
+    uint32_t source_float32; // 1 if every slot value in the file fits a float32, what MatchFile picks
+    uint32_t layout;         // MeshLayout the mesh was built with, a cache with another layout is rebuilt
+    uint32_t kind;           // MeshCacheKind
+
+    // grids only, see StructuredGrid2D
+    uint32_t grid_lattice_order; // 1 if the vertices are listed in lattice order
+    double grid_origin[3];
+    double grid_spacing[2];
+    uint64_t grid_nx;
+    uint64_t grid_ny;
+    int32_t grid_corners[4];
+};
+
+// a .ply file being opened, mapped and hashed once for everything that reads it
+struct MeshSource
+{
+    const char* filename = nullptr;
+    const MappedFile* file = nullptr; // nullptr if the file could not be opened
+    uint64_t hash = 0;                // content hash and size, which key the cache
+    uint64_t size = 0;
+    std::string cache_path;           // empty when the cache is off
+    MeshCacheKind kind = MeshCacheKind::Mesh; // recorded in a cache written for a quad mesh
+};
+
+// 64 bit content hash, large buffers are hashed in parallel chunks
+uint64_t hash_bytes(const char* data, size_t size);
+
+// hash of a mesh's face list (4 vertex indices per quad) and vertex positions (x, y, z per vertex),
+// two files with the same topology hash differ at most in their vertex attributes
+uint64_t topology_hash(const unsigned int* face_indices, size_t num_face_indices, const double* positions, size_t num_positions);
+// the same for the contents of a .ply file, from the values as read (before a mesh
+// rounds them to its precision)
+uint64_t topology_hash(const PlyData& ply);
+
+// where the cache for a .ply file lives: keyed by hash inside cache_directory, or next
+// to the file if the directory is empty
+std::string mesh_cache_path(const char* ply_filename, const std::string& cache_directory, uint64_t hash);
+
+// the header of the cache at path, false unless it is from this version and for this source
+bool read_mesh_cache_header(const std::string& path, uint64_t source_hash, uint64_t source_size,
+    MeshCacheHeader& header);
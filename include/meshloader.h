@@ -0,0 +1,92 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "fieldmesh.h"
+#include "drawitem.h"
+
+// Loads meshes on a background thread so the window keeps drawing while a large
+// file is parsed and its topology is built. The worker also builds the surface
+// payload, leaving only the GL upload for the main thread.
+// A file with the same faces and vertex positions as the mesh on screen is not
+// rebuilt at all, the result then only carries its vertex attributes.
+// Tiles of a tiled mesh are queued separately and loaded after any mesh request,
+// only their surface payloads are kept.
+class MeshLoader
+{
+public:
+
+    struct Result
+    {
+        std::string filename;
+        std::unique_ptr<FieldMesh> mesh;
+        DrawItem::Payload surface;
+
+        // set instead of mesh when the file matched the current topology, vertex_values
+        // holds s, vx, vy, vz per vertex, attributes the file's other columns and
+        // surface only its attribute_data
+        bool attributes_only = false;
+        uint64_t topology_hash = 0;
+        std::vector<double> vertex_values;
+        AttributeTable attributes;
+    };
+
+    struct TileResult
+    {
+        size_t index = 0;
+        bool loaded = false;
+        DrawItem::Payload surface;
+    };
+
+private:
+
+    std::thread m_thread;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    std::string m_pending;   // next file to load, empty if none was requested
+    uint64_t m_pending_topology = 0;
+    std::string m_loading;   // file the worker is loading now
+    std::string m_stage;
+    double m_progress = 0.0;
+    std::unique_ptr<Result> m_result;
+
+    std::deque<std::pair<size_t, std::string>> m_tile_requests;
+    std::vector<TileResult> m_tile_results;
+    uint64_t m_tile_generation = 0; // bumped by clear_tiles, older loads are dropped
+
+public:
+
+    MeshLoader();
+    ~MeshLoader(); // waits for a load in progress to finish
+
+    // queue a file to load, replacing any request the worker has not started yet, pass the
+    // topology hash of the mesh on screen (or 0) to allow an attributes only result
+    void request(const std::string& filename, uint64_t current_topology = 0);
+
+    // true while a file is queued or being loaded
+    bool busy() const;
+    // name, stage and fraction done of the file being loaded, false if idle
+    bool progress(std::string& filename, std::string& stage, double& fraction) const;
+
+    // hand over the most recently finished load, false if there is none
+    bool take_result(Result& result);
+
+    // queue a tile to load, tiles are loaded in the order they were requested
+    void request_tile(size_t index, const std::string& filename);
+    // drop queued tiles and tile results, for when the tiled mesh is closed
+    void clear_tiles();
+    // hand over the tiles finished since the last call
+    std::vector<TileResult> take_tiles();
+
+private:
+
+    void run();
+    void load(const std::string& filename, uint64_t current_topology, Result& result);
+    void load_tile(const std::string& filename, TileResult& result);
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// number of threads the parallel loops below will use
+inline unsigned int num_worker_threads()
+{
+    unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+// call fn(chunk) for every chunk in [0, num_chunks), spreading the chunks over the worker threads
+// the calling thread does its share of the work, and all chunks are finished when this returns
+template <typename Function>
+void parallel_for_chunks(size_t num_chunks, Function fn)
+{
+    size_t num_threads = std::min<size_t>(num_worker_threads(), num_chunks);
+    if (num_threads <= 1)
+    {
+        for (size_t chunk = 0; chunk < num_chunks; chunk++)
+            fn(chunk);
+        return;
+    }
+
+    auto run_thread = [&](size_t t)
+    {
+        for (size_t chunk = t; chunk < num_chunks; chunk += num_threads)
+            fn(chunk);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (size_t t = 1; t < num_threads; t++)
+        threads.emplace_back(run_thread, t);
+    run_thread(0);
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+// split [0, count) into one contiguous range per worker thread and call fn(begin, end) on each
+// ranges smaller than min_per_thread are not worth a thread, so small loops run inline
+template <typename Function>
+void parallel_for(size_t count, Function fn, size_t min_per_thread = 1024)
+{
+    size_t num_chunks = std::min<size_t>(num_worker_threads(), std::max<size_t>(1, count / min_per_thread));
+    parallel_for_chunks(num_chunks, [&](size_t chunk)
+    {
+        size_t begin = count * chunk / num_chunks;
+        size_t end = count * (chunk + 1) / num_chunks;
+        fn(begin, end);
+    });
+}
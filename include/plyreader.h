@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "attributes.h"
+
+class MappedFile;
+
+enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+enum class PlyType { Invalid, Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+// per-vertex values every mesh uses, in the order they are stored in PlyData
+// any other vertex property (tensors, pressure, ...) becomes an attribute column
+enum VertexSlot
+{
+    SLOT_NONE = -1,
+    SLOT_X, SLOT_Y, SLOT_Z,
+    SLOT_NX, SLOT_NY, SLOT_NZ,
+    SLOT_S,
+    SLOT_VX, SLOT_VY, SLOT_VZ,
+    NUM_VERTEX_SLOTS
+};
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type = PlyType::Invalid;        // value type, or index type for lists
+    PlyType count_type = PlyType::Invalid;  // only used by list properties
+    bool is_list = false;
+    size_t offset = 0;                      // byte offset inside a fixed size binary record
+    int slot = SLOT_NONE;                   // destination vertex slot, resolved once from the name
+};
+
+struct PlyElement
+{
+    std::string name;
+    size_t count = 0;
+    std::vector<PlyProperty> properties;
+    size_t stride = 0; // binary record size in bytes, 0 if the element has list properties
+};
+
+struct PlyHeader
+{
+    PlyFormat format = PlyFormat::Ascii;
+    std::vector<PlyElement> elements;
+    size_t body_offset = 0; // first byte after "end_header"
+};
+
+// flattened contents of a quad mesh .ply file
+struct PlyData
+{
+    size_t num_vertices = 0;
+    std::vector<double> vertex_values;      // NUM_VERTEX_SLOTS values per vertex
+    std::vector<unsigned int> face_indices; // 4 vertex indices per quad face
+    std::vector<unsigned int> face_ids;     // index of each quad in the file's face list
+    // Float32 when every slot property in the file fits a float without rounding
+    AttributeType slot_type = AttributeType::Float64;
+
+    // the other vertex properties, decoded from the file when first used, the file is
+    // reopened then and the columns are left at zero if it changed in between
+    AttributeTable attributes;
+};
+
+bool host_is_little_endian();
+size_t ply_type_size(PlyType type);
+int vertex_slot(const std::string& property_name);
+
+bool parse_ply_header(const char* data, size_t size, PlyHeader& header);
+// with read_faces false, reading stops after the vertex element (for files known to share a face list)
+bool read_ply_file(const char* filename, PlyData& data, bool read_faces = true);
+// the same, from the file already mapped by the caller
+bool read_ply_file(const MappedFile& file, const char* filename, PlyData& data, bool read_faces = true);
+// only the attribute columns, for meshes whose slots and faces came from somewhere else (the mesh cache)
+bool read_ply_attributes(const MappedFile& file, const char* filename, AttributeTable& attributes);
@@ -6,100 +6,86 @@
 #include <vector>
 #include <memory>
 #include <string>
-
-// forward declarations
+#include <cstdint>
+#include <array>
+#include <mutex>
+#include <limits>
+
+#include "fieldmesh.h"
+#include "halfedgemesh.h"
+#include "facegrid.h"
+#include "facebvh.h"
+#include "faceinterpolation.h"
+
+struct MeshSource;
+
+// Vertex, Edge and Face are read-only views of one element of a QuadMesh: its
+// arrays and an index into them. They are cheap to copy and compare, a default
+// constructed one is null, and like iterators they are only valid while the mesh
+// is alive. operator-> lets them be used like the pointers they replaced.
 class Vertex;
 class Edge;
 class Face;
 
-class Vertex : public std::enable_shared_from_this<Vertex>
+class Vertex
 {
 private:
 
-    unsigned int m_id;
-    glm::dvec3 m_position;
-    glm::dvec3 m_normal;
-    glm::dvec3 m_offset = glm::dvec3(0.0);
-
-    double m_scalar;
-    glm::dvec3 m_vector;
-    glm::dmat2x2 m_tensor;
-
-    std::vector<std::shared_ptr<Edge>> m_edges;
-    std::vector<std::shared_ptr<Face>> m_faces;
+    const HalfEdgeMesh* m_mesh = nullptr;
+    uint32_t m_index = HalfEdgeMesh::INVALID;
 
 public:
 
-    Vertex(unsigned int id, 
-        const glm::dvec3& position = glm::dvec3(0.0, 0.0, 0.0),
-		const glm::dvec3& normal = glm::dvec3(0.0, 0.0, 0.0),
-        const double scalar = 0.0,
-        const glm::dvec3& vector = glm::dvec3(0.0f,0.0f,0.0f),
-        const glm::dmat2x2& tensor = glm::dmat2x2(0.0));
-    ~Vertex();
+    Vertex() = default;
+    Vertex(std::nullptr_t) {}
+    Vertex(const HalfEdgeMesh* mesh, uint32_t index) : m_mesh(mesh), m_index(index) {}
+
+    explicit operator bool() const { return m_mesh != nullptr; }
+    bool operator==(const Vertex& other) const { return m_mesh == other.m_mesh && m_index == other.m_index; }
+    bool operator!=(const Vertex& other) const { return !(*this == other); }
+    const Vertex* operator->() const { return this; }
 
     unsigned int id() const;
     glm::dvec3 pos() const;
     glm::dvec3 normal() const;
-    glm::dvec4 color() const;
     double scalar() const;
     glm::dvec3 vector() const;
-    glm::dmat2x2 tensor() const;
-
-    void set_pos(const glm::dvec3& p);
-    void set_normal(const glm::dvec3& n);
-    void set_color(const glm::dvec4& c);
-    void set_scalar(double s);
-    void set_vector(const glm::dvec3& v);
-    void set_tensor(const glm::dmat2x2& t);
-
-    void add_edge(const std::shared_ptr<Edge> e);
-    void add_face(const std::shared_ptr<Face> f);
-    const std::vector<std::shared_ptr<Edge>>& edges() const;
-    const std::vector<std::shared_ptr<Face>>& faces() const;
-    std::vector<std::shared_ptr<Edge>>& edges();
-    std::vector<std::shared_ptr<Face>>& faces();
+
+    // the faces around the vertex in order, and the edges between them (plus the
+    // boundary edge before the first face if the ring is open)
+    std::vector<Face> faces() const;
+    std::vector<Edge> edges() const;
     size_t num_edges() const;
     size_t num_faces() const;
-
-    void compute_average_normal();
-    void reorder_pointers();
-    
-    void offset_position(const glm::dvec3& offset);
-    void reset_position();
 };
 
-
-
 class Edge
 {
 private:
 
-    unsigned int m_id;
-    std::shared_ptr<Vertex> m_v1;
-    std::shared_ptr<Vertex> m_v2;
-    std::vector<std::shared_ptr<Face>> m_faces; 
-    // should contain 1 or 2 faces in a manifold mesh surface
+    const HalfEdgeMesh* m_mesh = nullptr;
+    uint32_t m_index = HalfEdgeMesh::INVALID;
 
 public:
 
-    Edge(unsigned int id, const std::shared_ptr<Vertex> v1, const std::shared_ptr<Vertex> v2);
-    ~Edge();
+    Edge() = default;
+    Edge(std::nullptr_t) {}
+    Edge(const HalfEdgeMesh* mesh, uint32_t index) : m_mesh(mesh), m_index(index) {}
+
+    explicit operator bool() const { return m_mesh != nullptr; }
+    bool operator==(const Edge& other) const { return m_mesh == other.m_mesh && m_index == other.m_index; }
+    bool operator!=(const Edge& other) const { return !(*this == other); }
+    const Edge* operator->() const { return this; }
 
     unsigned int id() const;
-    const std::shared_ptr<Vertex> v1() const;
-    const std::shared_ptr<Vertex> v2() const;
-    std::shared_ptr<Vertex> v1();
-    std::shared_ptr<Vertex> v2();
-    const std::shared_ptr<Vertex> other_vertex(const std::shared_ptr<Vertex> v) const;
-    std::shared_ptr<Vertex> other_vertex(const std::shared_ptr<Vertex> v);
-
-    const std::vector<std::shared_ptr<Face>>& faces() const;
-    std::vector<std::shared_ptr<Face>>& faces();
+    Vertex v1() const;
+    Vertex v2() const;
+    Vertex other_vertex(const Vertex& v) const;
+
+    // 1 or 2 faces in a manifold mesh surface, none for streamline edges
+    std::vector<Face> faces() const;
     size_t num_faces() const;
-    const std::shared_ptr<Face> other_face(const std::shared_ptr<Face> f) const;
-    std::shared_ptr<Face> other_face(const std::shared_ptr<Face> f);
-    void add_face(const std::shared_ptr<Face> f);
+    Face other_face(const Face& f) const;
 
     double length() const;
 };
@@ -108,99 +94,284 @@ class Face
 {
 private:
 
-    unsigned int m_id;
-    glm::dvec3 m_normal;
-    glm::dvec4 m_color;
-
-    std::vector<std::shared_ptr<Vertex>> m_vertices; // should always contain 4 vertices
-    std::vector<std::shared_ptr<Edge>> m_edges;      // should always contain 4 edges
+    const HalfEdgeMesh* m_mesh = nullptr;
+    uint32_t m_index = HalfEdgeMesh::INVALID;
 
 public:
 
-    Face(unsigned int id, const std::vector<std::shared_ptr<Vertex>>& vertices);
-    ~Face();
+    Face() = default;
+    Face(std::nullptr_t) {}
+    Face(const HalfEdgeMesh* mesh, uint32_t index) : m_mesh(mesh), m_index(index) {}
 
-    unsigned int id() const;
-    glm::dvec3 normal() const;
-    glm::dvec4 color() const;
+    explicit operator bool() const { return m_mesh != nullptr; }
+    bool operator==(const Face& other) const { return m_mesh == other.m_mesh && m_index == other.m_index; }
+    bool operator!=(const Face& other) const { return !(*this == other); }
+    const Face* operator->() const { return this; }
 
-    void compute_normal();
-    void set_color(const glm::dvec4& c);
+    unsigned int id() const;    // from the file, see index() for the position in the mesh
+    uint32_t index() const;
+    glm::dvec3 normal() const;
 
-    const std::vector<std::shared_ptr<Vertex>>& vertices() const;
-    std::vector<std::shared_ptr<Vertex>>& vertices();
-    const std::vector<std::shared_ptr<Edge>>& edges() const;
-    std::vector<std::shared_ptr<Edge>>& edges();
+    std::array<Vertex, 4> vertices() const;
+    std::array<Edge, 4> edges() const;   // edge k joins corners k and k + 1
     size_t num_vertices() const;
     size_t num_edges() const;
-    
+
     const glm::dvec3 centroid() const;
 
     bool contains_xy_point(const glm::dvec3& point) const;
+    // squared distance from point to the quad, both projected to the x-y plane, 0 inside it
+    double squared_xy_distance(const glm::dvec3& point) const;
     glm::dvec3 bilinear_interpolate_xy_vector(const glm::dvec3& point) const;
 };
 
+// all vertices, edges or faces of a mesh, for range-for loops and indexing
+template <typename Element>
+class ElementRange
+{
+private:
+
+    const HalfEdgeMesh* m_mesh;
+    size_t m_size;
+
+public:
 
+    class iterator
+    {
+    private:
+
+        const HalfEdgeMesh* m_mesh;
+        uint32_t m_index;
+
+    public:
+
+        iterator(const HalfEdgeMesh* mesh, uint32_t index) : m_mesh(mesh), m_index(index) {}
+        Element operator*() const { return Element(m_mesh, m_index); }
+        iterator& operator++() { m_index++; return *this; }
+        bool operator!=(const iterator& other) const { return m_index != other.m_index; }
+    };
+
+    ElementRange(const HalfEdgeMesh* mesh, size_t size) : m_mesh(mesh), m_size(size) {}
+
+    iterator begin() const { return iterator(m_mesh, 0); }
+    iterator end() const { return iterator(m_mesh, static_cast<uint32_t>(m_size)); }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    Element operator[](size_t i) const { return Element(m_mesh, static_cast<uint32_t>(i)); }
+};
 
-class QuadMesh
+
+
+// summary values of a QuadMesh, see QuadMesh::statistics()
+struct MeshStatistics
+{
+    double min_scalar = 0.0;
+    double max_scalar = 0.0;
+    double mean_scalar = 0.0;
+    double scalar_variance = 0.0;
+
+    glm::dvec3 min_position = glm::dvec3(0.0); // bounds of the vertex positions
+    glm::dvec3 max_position = glm::dvec3(0.0);
+
+    double min_edge_length = 0.0;
+    double mean_edge_length = 0.0;
+    double max_edge_length = 0.0;
+};
+
+// where QuadMesh::locate found a point, and how
+struct Location
+{
+    Face face;               // nullptr if no face contains the point
+    uint32_t steps = 0;      // edges crossed walking from the hint
+    bool used_index = false; // the walk gave up and the point was looked up instead
+};
+
+class QuadMesh : public FieldMesh
 {
 private:
 
-    std::vector<std::shared_ptr<Vertex>> m_vertices;
-    std::vector<std::shared_ptr<Edge>> m_edges;
-    std::vector<std::shared_ptr<Face>> m_faces;
+    HalfEdgeMesh m_mesh;
+    AttributeTable m_attributes;
 
 	glm::dvec3 m_midpoint = glm::dvec3(0.0, 0.0, 0.0);
 	double radius = 0.0;
+    uint64_t m_topology_hash = 0; // see topology_hash() in meshcache.h
+
+    // computed on first use, the scalar part is dropped when the scalars change and
+    // the bounds and edge lengths when the positions do
+    mutable std::mutex m_statistics_mutex;
+    mutable MeshStatistics m_statistics;
+    mutable bool m_scalar_statistics_valid = false;
+    mutable bool m_position_statistics_valid = false;
+
+    // indexes of the faces' x-y boxes, built on first use and dropped when the positions change
+    mutable std::mutex m_locator_mutex;
+    mutable std::unique_ptr<FaceGrid> m_face_grid;
+    mutable std::unique_ptr<FaceBVH> m_face_bvh;
+    mutable std::unique_ptr<FaceInterpolation> m_face_interpolation;
+
+    // topology cache for meshes loaded from .ply files (see meshcache.h)
+    static bool s_cache_enabled;
+    static std::string s_cache_directory;
+    static uint64_t s_cache_limit;
+
+    static MeshPrecision s_precision;
+    static MeshLayout s_layout;
 
 public:
 
     QuadMesh();
-    QuadMesh(const char* filename); // load from PLY file
-    QuadMesh(const QuadMesh& base_mesh, double step_size, int num_steps);
+    QuadMesh(const char* filename, bool verbose = true,
+        const LoadProgress& progress = nullptr, bool use_cache = true); // load from PLY file
+    // same, with the file contents already read by the caller
+    QuadMesh(const char* filename, const PlyData& ply, bool verbose = true,
+        const LoadProgress& progress = nullptr);
+    // same, from a file FieldMesh::open has mapped and hashed, ply is its contents if already read
+    QuadMesh(const MeshSource& source, const PlyData* ply, bool verbose = true,
+        const LoadProgress& progress = nullptr);
+    // streamlines through the centroid of every face of base_mesh, as edges; each vertex
+    // keeps the scalar of base_mesh there and its normal, so the tubes can follow a height field
+    QuadMesh(const FieldMesh& base_mesh, double step_size, int num_steps);
+    // the given streamlines, as edges
+    explicit QuadMesh(const std::vector<std::vector<glm::dvec3>>& streamlines);
     ~QuadMesh();
 
-    const std::vector<std::shared_ptr<Vertex>>& vertices() const;
-    const std::vector<std::shared_ptr<Edge>>& edges() const;
-    const std::vector<std::shared_ptr<Face>>& faces() const;
-
-    size_t num_vertices() const;
-    size_t num_edges() const;
-    size_t num_faces() const;
-
-    glm::dvec3 midpoint() const;
-    double get_radius() const;
+    // cache files are keyed by content hash in the user's cache directory ($XDG_CACHE_HOME
+    // or ~/.cache, %LOCALAPPDATA% on Windows), the cache is off if there is none; with the
+    // directory set to "" they are written next to each .ply file instead
+    static void set_cache_enabled(bool enabled);
+    static void set_cache_directory(const std::string& directory);
+    static bool cache_enabled();
+    static std::string cache_directory();
+    // after each write the least recently used cache files are deleted until the cache
+    // directory holds at most this many bytes (8 GiB by default), 0 for no limit
+    static void set_cache_limit(uint64_t bytes);
+    static uint64_t cache_limit();
+    // where the cache for a .ply file with this content hash goes
+    static std::string cache_path(const char* filename, uint64_t hash);
+
+    // precision of the vertex and face values of meshes loaded from now on, by default
+    // (MatchFile) float32 files stay float32, the accessors return doubles either way
+    static void set_precision(MeshPrecision precision);
+    MeshPrecision precision() const;
+    // order of the vertices and faces of meshes loaded from now on, file order by default
+    static void set_layout(MeshLayout layout);
+    MeshLayout layout() const;
+
+    ElementRange<Vertex> vertices() const;
+    ElementRange<Edge> edges() const;
+    ElementRange<Face> faces() const;
+    const HalfEdgeMesh& half_edge_mesh() const;
+
+    size_t num_vertices() const override;
+    size_t num_edges() const override;
+    size_t num_faces() const override;
+
+    // FieldMesh access by index into edges() and faces(), vertices go by their index in
+    // the file (Vertex::id()), which is their index into vertices() unless reordered
+    glm::dvec3 vertex_position(size_t v) const override;
+    glm::dvec3 vertex_normal(size_t v) const override;
+    double vertex_scalar(size_t v) const override;
+    glm::dvec3 vertex_vector(size_t v) const override;
+    const AttributeTable& attributes() const override;
+    AttributeTable& attributes() override;
+    void edge_vertices(size_t e, unsigned int ids[2]) const override;
+    void face_vertices(size_t f, unsigned int ids[4]) const override;
+
+    glm::dvec3 midpoint() const override;
+    double get_radius() const override;
 
     void compute_face_normals();
     void average_vertex_normals();
     void compute_midpoint_and_radius();
 
-    void print_info() const;
+    void print_info() const override;
+    MemoryFootprint footprint() const override;
 
-    void get_min_max_scalar(double& min_scalar, double& max_scalar) const;
-    void set_height_from_scalar(double factor);
-    void reset_vertex_positions();
+    uint64_t topology_hash() const override;
+
+    void get_min_max_scalar(double& min_scalar, double& max_scalar) const override;
+    void set_vertex_attributes(const std::vector<double>& values) override;
     void get_min_max_coords(double& min_x, double& max_x, 
                             double& min_y, double& max_y,
-                            double& min_z, double& max_z) const;
-
-    double get_grid_spacing() const;
-
-    const std::shared_ptr<Face> get_face_containing_xy_point(const glm::dvec3& point) const;
-
+                            double& min_z, double& max_z) const override;
+
+    // the mean edge length
+    double get_grid_spacing() const override;
+
+    MeshStatistics statistics() const;
+
+    // the first face, in face order, whose x-y projection contains point, nullptr if none does
+    Face get_face_containing_xy_point(const glm::dvec3& point) const;
+    // same face, found by checking every face in turn
+    Face scan_for_face_containing_xy_point(const glm::dvec3& point) const;
+    // a face containing point, found by walking from hint across the edge the point is
+    // furthest outside of, for points close to the last one such as successive samples
+    // along a streamline. Walks that leave the mesh, circle or run long, and a null
+    // hint, end in get_face_containing_xy_point
+    Location locate(const glm::dvec3& point, const Face& hint) const;
+    // the face nearest to point in the x-y plane, nullptr if none is within max_distance
+    Face get_nearest_xy_face(const glm::dvec3& point,
+        double max_distance = std::numeric_limits<double>::infinity()) const;
+    // the faces whose x-y bounding box overlaps the box from min to max, in face order
+    void get_faces_overlapping_xy_box(const glm::dvec3& min, const glm::dvec3& max, std::vector<Face>& faces) const;
+
+    // the indexes behind the queries above, built here on first use. Point location goes
+    // through the bucket grid unless its buckets are crowded, where the faces vary a lot
+    // in size, and through the hierarchy then, the other two queries always use the hierarchy
+    const FaceGrid& face_grid() const;
+    const FaceBVH& face_bvh() const;
+    bool locates_with_face_grid() const;
+    // the per-face interpolation coefficients behind the streamlines and sample(), built
+    // on first use and dropped with the indexes
+    const FaceInterpolation& face_interpolation() const;
+    // the same if something has built it already, nullptr otherwise
+    const FaceInterpolation* built_face_interpolation() const;
+
+    // table is built_face_interpolation() looked up once by the caller for the whole
+    // streamline, with nullptr the vector is interpolated from the face's corners
     glm::dvec3 take_xy_streamline_step(const glm::dvec3& current_pos,
-        const std::shared_ptr<Face>& current_face, std::shared_ptr<Face>& next_face,
-        double step_size, int direction) const;
+        const Face& current_face, Face& next_face,
+        double step_size, int direction, const FaceInterpolation* table = nullptr) const;
 
     void compute_xy_streamline(std::vector<glm::dvec3>& streamline,
-        const glm::dvec3& start_pos, const std::shared_ptr<Face>& start_face,
+        const glm::dvec3& start_pos, const Face& start_face,
         double step_size, int num_steps) const;
 
+    void compute_face_xy_streamline(std::vector<glm::dvec3>& streamline, size_t f,
+        double step_size, int num_steps) const override;
+
+    void sample(const glm::dvec3* points, size_t count, const FieldSamples& out) const override;
+
 
 private:
 
     void construct_simple_quad_mesh();
-    void vertex_to_face_pointers();
     void set_up_edges();
     void reorder_vertex_pointers();
+    void reorder_along_curve();
+    void add_streamline(const std::vector<glm::dvec3>& streamline, const glm::dvec3& normal = glm::dvec3(0.0, 0.0, 1.0));
+
+    // the index points are looked up in, resolved once so a loop over many points
+    // does not take the locator lock for each of them
+    struct FaceLookup
+    {
+        const FaceGrid* grid = nullptr; // set if the bucket grid is used
+        const FaceBVH* bvh = nullptr;   // otherwise
+    };
+    FaceLookup face_lookup() const;
+    Face find_face(const FaceLookup& lookup, const glm::dvec3& point) const;
+    // the walk of locate, false if it gave up
+    bool walk_to(const glm::dvec3& point, const Face& hint, Location& location) const;
+
+    void invalidate_statistics(bool scalars, bool positions);
+    void invalidate_locators();
+    void compute_scalar_statistics() const;
+    void compute_position_statistics() const;
+
+    void load(const char* filename, const PlyData* ply, bool verbose, const LoadProgress& progress,
+        bool use_cache = true);
+    void load(const MeshSource& source, const PlyData* ply, bool verbose, const LoadProgress& progress);
+    bool read_mesh_cache(const std::string& path, uint64_t source_hash, uint64_t source_size);
+    bool write_mesh_cache(const MeshSource& source, bool source_float32) const;
 };
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "fieldmesh.h"
+
+// A quad mesh whose vertices form a regular, axis aligned lattice in a plane of
+// constant z, which is what most of our simulation output is. Only the lattice
+// (origin, spacing, size) and flat per-vertex arrays are kept, so locating a point,
+// stepping to a neighbouring cell and interpolating are closed form instead of
+// searches through an explicit mesh. Vertices keep their index from the file; cells
+// are numbered row by row from the origin, i + j * (nx - 1). Tensors are not kept.
+class StructuredGrid2D : public FieldMesh
+{
+public:
+
+    enum class Side { Left, Right, Bottom, Top };
+    static const size_t NO_CELL = SIZE_MAX;
+
+private:
+
+    glm::dvec3 m_origin = glm::dvec3(0.0); // lattice node (0, 0), at the minimum x and y
+    glm::dvec2 m_spacing = glm::dvec2(1.0);
+    size_t m_nx = 0;                       // nodes along x
+    size_t m_ny = 0;                       // nodes along y
+
+    // the corners of every quad in the file, in winding order, as offsets di + 2 * dj in its cell
+    int m_corners[4] = { 0, 1, 3, 2 };
+    double m_normal_z = 1.0;               // +1 or -1, from the winding
+
+    // lattice node (i + j * nx) to vertex index and back, both empty when the file
+    // lists its vertices in lattice order
+    std::vector<unsigned int> m_node_vertex;
+    std::vector<unsigned int> m_vertex_node;
+
+    // by vertex index
+    std::vector<double> m_scalars;
+    std::vector<glm::dvec3> m_vectors;
+    AttributeTable m_attributes;
+
+    // range of m_scalars, worked out on first use after the scalars change
+    mutable std::mutex m_scalar_range_mutex;
+    mutable double m_min_scalar = 0.0;
+    mutable double m_max_scalar = 0.0;
+    mutable bool m_scalar_range_valid = false;
+
+    glm::dvec3 m_midpoint = glm::dvec3(0.0);
+    double m_radius = 0.0;
+    uint64_t m_topology_hash = 0;
+
+public:
+
+    // a grid for the file contents, or nullptr unless every vertex sits on a regular lattice
+    // (within a small fraction of the spacing) and the quads are exactly its cells, wound alike
+    static std::unique_ptr<StructuredGrid2D> detect(const PlyData& ply);
+
+    // the grid kept in a cache file by write_cache, nullptr unless it is a grid built from this source
+    static std::unique_ptr<StructuredGrid2D> read_cache(const std::string& path, uint64_t source_hash, uint64_t source_size);
+    bool write_cache(const std::string& path, uint64_t source_hash, uint64_t source_size) const;
+
+    size_t nx() const;
+    size_t ny() const;
+    glm::dvec3 origin() const;
+    glm::dvec2 spacing() const;
+
+    // vertex index of lattice node (i, j)
+    unsigned int node_vertex(size_t i, size_t j) const;
+
+    // cell containing the x-y position of point, false outside the grid
+    bool locate(const glm::dvec3& point, size_t& cell) const;
+    // the cell across one side of a cell, NO_CELL at the border
+    size_t neighbor(size_t cell, Side side) const;
+
+    // bilinear interpolation inside a cell, the vector is projected to x-y like Face's
+    double interpolate_scalar(const glm::dvec3& point, size_t cell) const;
+    glm::dvec3 interpolate_xy_vector(const glm::dvec3& point, size_t cell) const;
+
+    // FieldMesh
+    size_t num_vertices() const override;
+    size_t num_edges() const override;
+    size_t num_faces() const override;
+
+    glm::dvec3 vertex_position(size_t v) const override;
+    glm::dvec3 vertex_normal(size_t v) const override;
+    double vertex_scalar(size_t v) const override;
+    glm::dvec3 vertex_vector(size_t v) const override;
+    const AttributeTable& attributes() const override;
+    AttributeTable& attributes() override;
+    // edges along x come first, i + j * (nx - 1), then edges along y, i + j * nx
+    void edge_vertices(size_t e, unsigned int ids[2]) const override;
+    void face_vertices(size_t f, unsigned int ids[4]) const override;
+
+    glm::dvec3 midpoint() const override;
+    double get_radius() const override;
+    void print_info() const override;
+    MemoryFootprint footprint() const override;
+    uint64_t topology_hash() const override;
+
+    void get_min_max_scalar(double& min_scalar, double& max_scalar) const override;
+    void get_min_max_coords(double& min_x, double& max_x,
+                            double& min_y, double& max_y,
+                            double& min_z, double& max_z) const override;
+    // the smaller of the two spacings
+    double get_grid_spacing() const override;
+
+    void set_vertex_attributes(const std::vector<double>& values) override;
+
+    void compute_xy_streamline(std::vector<glm::dvec3>& streamline, const glm::dvec3& start_pos,
+        double step_size, int num_steps) const;
+    void compute_face_xy_streamline(std::vector<glm::dvec3>& streamline, size_t f,
+        double step_size, int num_steps) const override;
+    void sample(const glm::dvec3* points, size_t count, const FieldSamples& out) const override;
+
+private:
+
+    StructuredGrid2D() = default;
+
+    void set_normal_from_corners();
+    size_t vertex_node(size_t v) const;
+    // local coordinates of point in a cell, and the vertices at (i, j), (i + 1, j), (i, j + 1), (i + 1, j + 1)
+    void cell_corners(const glm::dvec3& point, size_t cell, double& u, double& w, unsigned int ids[4]) const;
+    glm::dvec3 take_xy_streamline_step(const glm::dvec3& current_pos, size_t current_cell,
+        size_t& next_cell, double step_size, int direction) const;
+    void trace_xy_streamline(std::vector<glm::dvec3>& streamline, const glm::dvec3& start_pos,
+        size_t start_cell, double step_size, int num_steps) const;
+    void compute_midpoint_and_radius();
+};
@@ -0,0 +1,107 @@
+#pragma once
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "quadmesh.h"
+
+// A quad mesh that has been split into spatial tiles on disk, for datasets that
+// are too big to hold in memory as one QuadMesh. Each tile is a small binary .ply
+// file listed in a text index (.tiles). Queries load the tiles they need on the
+// CPU, and the least recently used ones are released once the resident tiles go
+// over the memory budget. The view only needs the tiles' drawables, which are
+// built on a loader thread and counted against a budget of their own.
+class TiledMesh
+{
+public:
+
+    // where the drawable of a tile is
+    enum class Drawable { None, Loading, Drawn, Failed };
+
+    struct Tile
+    {
+        std::string filename;
+        size_t num_vertices = 0;
+        size_t num_faces = 0;
+        glm::dvec2 min_xy = glm::dvec2(0.0); // xy bounds of every face in the tile
+        glm::dvec2 max_xy = glm::dvec2(0.0);
+        std::shared_ptr<QuadMesh> mesh;      // null while the tile is only on disk
+        size_t bytes = 0;                    // estimated memory while resident
+        Drawable drawable = Drawable::None;
+        size_t gpu_bytes = 0;                // of its drawable, or reserved for it while it loads
+    };
+
+private:
+
+    std::vector<Tile> m_tiles;
+    std::list<size_t> m_lru; // resident tiles, most recently used at the front
+    size_t m_memory_budget;
+    size_t m_resident_bytes = 0;
+    std::list<size_t> m_drawn; // tiles with a drawable, most recently visible at the front
+    size_t m_gpu_budget;
+    size_t m_gpu_bytes = 0;
+
+    glm::dvec3 m_min = glm::dvec3(0.0);
+    glm::dvec3 m_max = glm::dvec3(0.0);
+    double m_min_scalar = 0.0;
+    double m_max_scalar = 0.0;
+
+public:
+
+    TiledMesh(const char* index_filename, size_t memory_budget = size_t(1) << 30,
+        size_t gpu_budget = size_t(1) << 30);
+    ~TiledMesh();
+
+    // split a .ply file into tiles_x by tiles_y tiles and write the tile index
+    static bool build_tiles(const char* ply_filename, const char* index_filename, int tiles_x, int tiles_y);
+
+    size_t num_tiles() const;
+    const Tile& tile(size_t i) const;
+    size_t resident_bytes() const;
+    void set_memory_budget(size_t bytes);
+    size_t gpu_bytes() const;
+    void set_gpu_budget(size_t bytes);
+
+    glm::dvec3 midpoint() const;
+    double get_radius() const;
+    void get_min_max_scalar(double& min_scalar, double& max_scalar) const;
+    void get_min_max_coords(double& min_x, double& max_x,
+                            double& min_y, double& max_y,
+                            double& min_z, double& max_z) const;
+
+    // load a tile if needed and mark it as most recently used
+    std::shared_ptr<QuadMesh> get_tile(size_t i);
+    std::vector<size_t> tiles_overlapping(const glm::dvec2& min_xy, const glm::dvec2& max_xy) const;
+
+    // plan the drawables for the view rectangle: tiles in view without one go in load,
+    // drawn tiles out of view that must go to make room for them in release. Tiles in
+    // view are never released, and no load starts once the GPU budget is used up.
+    void update_residency(const glm::dvec2& min_xy, const glm::dvec2& max_xy,
+        std::vector<size_t>& load, std::vector<size_t>& release);
+    // the drawable of a tile passed in load is built, gpu_bytes is 0 if the tile failed to load
+    void tile_loaded(size_t i, size_t gpu_bytes);
+
+    Face get_face_containing_xy_point(const glm::dvec3& point,
+        std::shared_ptr<QuadMesh>& tile_mesh);
+
+    void compute_xy_streamline(std::vector<glm::dvec3>& streamline,
+        const glm::dvec3& start_pos, double step_size, int num_steps);
+    // streamlines from the centers of a seeds_x by seeds_y lattice over the part of the
+    // rectangle inside the mesh bounds, as the edges of a QuadMesh
+    std::unique_ptr<QuadMesh> compute_xy_streamlines(const glm::dvec2& min_xy, const glm::dvec2& max_xy,
+        int seeds_x, int seeds_y, double step_size, int num_steps);
+    // mean edge length of the faces, estimated from the bounds and the face count
+    double get_grid_spacing() const;
+
+private:
+
+    void evict_until_under_budget(size_t keep);
+    void release_drawable(size_t i);
+    static size_t estimate_gpu_bytes(const Tile& tile);
+    void trace_xy_streamline(std::vector<glm::dvec3>& streamline, glm::dvec3 pos,
+        std::shared_ptr<QuadMesh> mesh, Face face,
+        double step_size, int num_steps, int direction);
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A sequence of .ply files that share one mesh (same vertices and faces) and only
+// differ in their per-vertex scalar and vector values, e.g. the time steps of a run.
+// The topology comes from the first frame, which is loaded as a normal QuadMesh.
+// The attributes of upcoming frames are decoded by background threads into a small
+// ring buffer ahead of the playback position.
+class TimeSeries
+{
+public:
+
+    struct Frame
+    {
+        size_t index = 0;
+        std::vector<double> values;    // s, vx, vy, vz per vertex (see QuadMesh::set_vertex_attributes)
+        std::vector<float> attributes; // the same values laid out for DrawItem::updateAttributes
+    };
+
+private:
+
+    std::vector<std::string> m_filenames;
+    size_t m_num_vertices;
+
+    // frame i lives in slot i % ring size while it is within the prefetch window
+    std::vector<std::shared_ptr<const Frame>> m_ring;
+    std::vector<size_t> m_decoding; // frames a decoder is working on
+    size_t m_position = 0;          // first frame of the prefetch window
+
+    std::vector<std::thread> m_decoders;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    // playback
+    bool m_playing = false;
+    double m_frame_rate = 30.0;
+    double m_next_frame_time = 0.0;
+    size_t m_shown = SIZE_MAX;
+
+public:
+
+    TimeSeries(const std::vector<std::string>& filenames, size_t num_vertices,
+        size_t ring_size = 16, unsigned int num_decoders = 0); // 0 decoders picks half the hardware threads
+    ~TimeSeries();
+
+    // files matching a pattern with * and ? in the file name, in natural order (r2 before r10)
+    static std::vector<std::string> expand_pattern(const std::string& pattern);
+    static void sort_filenames(std::vector<std::string>& filenames);
+
+    size_t num_frames() const;
+    const std::string& filename(size_t i) const;
+
+    // move the playback position, prefetching restarts from there
+    void seek(size_t i);
+    size_t position() const;
+
+    // the decoded frame if it is in the ring, nullptr if it is not ready yet
+    std::shared_ptr<const Frame> frame(size_t i);
+
+    void set_playing(bool playing);
+    bool playing() const;
+    void set_frame_rate(double frames_per_second);
+    double frame_rate() const;
+
+    // call once per rendered frame with the current time in seconds, returns the frame
+    // that should be shown if it changed since the last call, playback waits for frames
+    // that are still being decoded instead of skipping them
+    std::shared_ptr<const Frame> update(double time);
+
+private:
+
+    void run_decoder();
+    bool in_window(size_t i) const;
+    bool decode_frame(size_t i, Frame& frame) const;
+};
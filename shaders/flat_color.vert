@@ -4,10 +4,19 @@ uniform mat4 projectionMatrix;
 uniform mat4 viewMatrix;
 uniform mat4 modelMatrix;
 
+#include "height_field.glsl"
+
 layout (location = 0) in vec3 glVertex;
+layout (location = 1) in vec3 glNormal;
+layout (location = 2) in float glScalar;
 
 void main() 
 {
+    // tubes carry the normal and scalar of the surface under them and rise with it
+    vec3 vertex = glVertex;
+    vec3 normal = glNormal;
+    displace(glScalar, vertex, normal);
+
     mat4 mvp = projectionMatrix * viewMatrix * modelMatrix;
-    gl_Position = mvp * vec4(glVertex, 1.0);
+    gl_Position = mvp * vec4(vertex, 1.0);
 }
@@ -0,0 +1,56 @@
+// The height field the surface vertex shaders share, spliced in by Shader where a shader
+// has #include "height_field.glsl". displace() raises a vertex by its scalar.
+
+// height field, 0 while the surface is flat, see displace() below
+uniform float heightFactor;
+uniform float heightMinScalar;
+uniform float heightMaxScalar;
+
+// the surface's vertices (position then normal, 6 floats each), its attributes (scalar
+// then vector) and the vertices across the edges of each vertex, see DrawItem, read
+// for the scalar gradient while the height field is raised
+uniform samplerBuffer surfaceVertices;
+uniform samplerBuffer surfaceAttributes;
+uniform usamplerBuffer neighborOffsets;
+uniform usamplerBuffer neighbors;
+uniform bool surfaceNeighbors;
+
+// gradient of the scalar along the surface at this vertex, the least squares fit to the
+// differences to its neighbors in the tangent plane (exact for a linear scalar on a flat grid)
+vec3 scalarGradient(float scalar, vec3 vertex, vec3 normal)
+{
+    if (!surfaceNeighbors)
+        return vec3(0.0);
+    vec3 t1 = normalize(cross(normal, abs(normal.x) < 0.9 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0)));
+    vec3 t2 = cross(normal, t1);
+    mat2 a = mat2(0.0);
+    vec2 b = vec2(0.0);
+    int end = int(texelFetch(neighborOffsets, gl_VertexID + 1).r);
+    for (int k = int(texelFetch(neighborOffsets, gl_VertexID).r); k < end; k++)
+    {
+        int j = int(texelFetch(neighbors, k).r);
+        vec3 d = vec3(texelFetch(surfaceVertices, 6 * j).r, texelFetch(surfaceVertices, 6 * j + 1).r,
+                      texelFetch(surfaceVertices, 6 * j + 2).r) - vertex;
+        vec2 dt = vec2(dot(d, t1), dot(d, t2));
+        a += outerProduct(dt, dt);
+        b += (texelFetch(surfaceAttributes, j).r - scalar) * dt;
+    }
+    // neighbors all along one line leave the gradient across it open
+    float trace = a[0][0] + a[1][1];
+    if (determinant(a) <= 1e-6 * trace * trace)
+        return vec3(0.0);
+    vec2 g = inverse(a) * b;
+    return g.x * t1 + g.y * t2;
+}
+
+// move a vertex along its normal by heightFactor times its normalized scalar, and tilt
+// the normal by the scalar gradient along the surface to match (exact on a flat grid)
+void displace(float scalar, inout vec3 vertex, inout vec3 normal)
+{
+    if (heightFactor == 0.0 || heightMaxScalar <= heightMinScalar)
+        return;
+    float scale = heightFactor / (heightMaxScalar - heightMinScalar);
+    vec3 gradient = scalarGradient(scalar, vertex, normal);
+    vertex += scale * (scalar - heightMinScalar) * normal;
+    normal = normalize(normal - scale * gradient);
+}
@@ -9,6 +9,8 @@ uniform float minScalar;
 uniform float maxScalar;
 uniform float minX, maxX, minY, maxY;
 
+#include "height_field.glsl"
+
 // const variables are local to the shader and cannot be changed by the application
 const vec3 lightPos = vec3(2.0, 5.0, 0.0);
 
@@ -29,6 +31,10 @@ out vec2 vTexCoord;
 
 void main() 
 {
+    vec3 vertex = glVertex;
+    vec3 normal = glNormal;
+    displace(glScalar, vertex, normal);
+
     // model-view-projection matrix and model-view matrix tell us how to transform
     // the vertices so they are in the right place on the screen
     mat4 mvp = projectionMatrix * viewMatrix * modelMatrix;
@@ -36,13 +42,13 @@ void main()
     
     // eye_coord_pos is the vertex position relative to the camera position and view direction
     // this is needed accuratly compute light reflections that reach the camera
-    vec4 eye_coord_pos = viewMatrix * modelMatrix * vec4(glVertex, 1.0);
-    vNormal = mat3(transpose(inverse(mv))) * glNormal;
+    vec4 eye_coord_pos = viewMatrix * modelMatrix * vec4(vertex, 1.0);
+    vNormal = mat3(transpose(inverse(mv))) * normal;
     vLightDir = lightPos - eye_coord_pos.xyz;
     vViewDir = viewPos - eye_coord_pos.xyz;
 
     // gl_Position is a built-in mandatory output variable that holds the transformed vertex position
-    gl_Position = mvp * vec4(glVertex, 1.0);
+    gl_Position = mvp * vec4(vertex, 1.0);
 
     vScalar = (glScalar - minScalar) / (maxScalar - minScalar);
     vScalar = clamp(vScalar, 0.0, 1.0);
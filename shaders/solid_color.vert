@@ -5,10 +5,13 @@ uniform mat4 viewMatrix;
 uniform mat4 modelMatrix;
 uniform vec3 viewPos;
 
+#include "height_field.glsl"
+
 const vec3 lightPos = vec3(2.0, 5.0, 0.0);
 
 layout (location = 0) in vec3 glVertex;
 layout (location = 1) in vec3 glNormal;
+layout (location = 2) in float glScalar;
 
 out vec3 vNormal;
 out vec3 vLightDir;
@@ -16,13 +19,17 @@ out vec3 vViewDir;
 
 void main() 
 {
+    vec3 vertex = glVertex;
+    vec3 normal = glNormal;
+    displace(glScalar, vertex, normal);
+
     mat4 mvp = projectionMatrix * viewMatrix * modelMatrix;
     mat4 mv = viewMatrix * modelMatrix;
 
-    vec4 eye_coord_pos = viewMatrix * modelMatrix * vec4(glVertex, 1.0);
-    vNormal = mat3(transpose(inverse(mv))) * glNormal;
+    vec4 eye_coord_pos = viewMatrix * modelMatrix * vec4(vertex, 1.0);
+    vNormal = mat3(transpose(inverse(mv))) * normal;
     vLightDir = lightPos - eye_coord_pos.xyz;
     vViewDir = viewPos - eye_coord_pos.xyz;
 
-    gl_Position = mvp * vec4(glVertex, 1.0);
+    gl_Position = mvp * vec4(vertex, 1.0);
 }
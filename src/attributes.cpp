@@ -0,0 +1,124 @@
+#include "attributes.h"
+
+#include <algorithm>
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// AttributeColumn Class Methods
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+AttributeColumn::AttributeColumn(const std::string& name, AttributeType type, size_t size, Decoder decoder)
+    : m_name(name), m_type(type), m_size(size), m_decoder(std::move(decoder)), m_decoded(false)
+{
+    if (!m_decoder)
+        decode(); // nothing to wait for, just allocate the values
+}
+
+const std::string& AttributeColumn::name() const { return m_name; }
+AttributeType AttributeColumn::type() const { return m_type; }
+size_t AttributeColumn::size() const { return m_size; }
+bool AttributeColumn::is_decoded() const { return m_decoded.load(std::memory_order_acquire); }
+
+void AttributeColumn::decode() const
+{
+    if (is_decoded())
+        return;
+    std::call_once(m_decode_once, [this]
+    {
+        std::vector<double> values(m_size, 0.0);
+        if (m_decoder && !m_decoder(values))
+            std::fill(values.begin(), values.end(), 0.0);
+        m_decoder = nullptr; // lets go of whatever the decoder was reading from
+
+        if (m_type == AttributeType::Float32)
+            m_float32.assign(values.begin(), values.end());
+        else
+            m_float64 = std::move(values);
+        m_decoded.store(true, std::memory_order_release);
+    });
+}
+
+double AttributeColumn::value(size_t i) const
+{
+    decode();
+    return (m_type == AttributeType::Float32) ? static_cast<double>(m_float32[i]) : m_float64[i];
+}
+
+const float* AttributeColumn::float32_data() const
+{
+    decode();
+    return (m_type == AttributeType::Float32) ? m_float32.data() : nullptr;
+}
+
+const double* AttributeColumn::float64_data() const
+{
+    decode();
+    return (m_type == AttributeType::Float64) ? m_float64.data() : nullptr;
+}
+
+void AttributeColumn::set_value(size_t i, double value)
+{
+    decode();
+    if (m_type == AttributeType::Float32)
+        m_float32[i] = static_cast<float>(value);
+    else
+        m_float64[i] = value;
+}
+
+size_t AttributeColumn::memory_bytes() const
+{
+    if (!is_decoded())
+        return 0;
+    return capacity_bytes(m_float32) + capacity_bytes(m_float64);
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// AttributeTable Class Methods
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+void AttributeTable::add(const std::shared_ptr<AttributeColumn>& column)
+{
+    for (std::shared_ptr<AttributeColumn>& existing : m_columns)
+    {
+        if (existing->name() == column->name())
+        {
+            existing = column;
+            return;
+        }
+    }
+    m_columns.push_back(column);
+}
+
+const AttributeColumn* AttributeTable::find(const std::string& name) const
+{
+    for (const std::shared_ptr<AttributeColumn>& column : m_columns)
+    {
+        if (column->name() == name)
+            return column.get();
+    }
+    return nullptr;
+}
+
+const std::vector<std::shared_ptr<AttributeColumn>>& AttributeTable::columns() const { return m_columns; }
+size_t AttributeTable::size() const { return m_columns.size(); }
+bool AttributeTable::empty() const { return m_columns.empty(); }
+void AttributeTable::clear() { m_columns.clear(); }
+
+MemoryFootprint AttributeTable::footprint() const
+{
+    MemoryFootprint footprint;
+    footprint.control_blocks = capacity_bytes(m_columns);
+    for (const std::shared_ptr<AttributeColumn>& column : m_columns)
+    {
+        footprint.attributes += column->memory_bytes();
+        footprint.control_blocks += sizeof(AttributeColumn) + MemoryFootprint::SHARED_CONTROL_BLOCK_BYTES;
+    }
+    return footprint;
+}
@@ -1,138 +1,166 @@
 #include "drawitem.h"
 
-DrawItem::DrawItem(const QuadMesh& mesh, DrawMode draw_mode, int resolution, float radius)
-    : m_VAO(0), m_VBO(0), m_EBO(0)
+#include <algorithm>
+#include <cstdint>
+
+DrawItem::DrawItem(const FieldMesh& mesh, DrawMode draw_mode, int resolution, float radius)
+    : DrawItem(buildPayload(mesh, draw_mode, resolution, radius))
+{
+}
+
+DrawItem::DrawItem(Payload&& payload, size_t max_upload_bytes)
+    : m_VAO(0), m_VBO(0), m_EBO(0), m_ABO(0), m_OBO(0), m_NBO(0)
+{
+    m_vertex_data = std::move(payload.vertex_data);
+    m_face_data = std::move(payload.face_data);
+    m_attribute_data = std::move(payload.attribute_data);
+    m_neighbor_offsets = std::move(payload.neighbor_offsets);
+    m_neighbors = std::move(payload.neighbors);
+    m_floats_per_vertex = payload.floats_per_vertex;
+    m_vertex_bytes = m_vertex_data.size() * sizeof(float);
+    m_face_bytes = m_face_data.size() * sizeof(unsigned int);
+    m_attribute_bytes = m_attribute_data.size() * sizeof(float);
+    m_neighbor_offset_bytes = m_neighbor_offsets.size() * sizeof(unsigned int);
+    m_neighbor_bytes = m_neighbors.size() * sizeof(unsigned int);
+
+    initializeBuffers();
+    upload(max_upload_bytes == 0 ? SIZE_MAX : max_upload_bytes);
+}
+
+DrawItem::Payload DrawItem::buildPayload(const FieldMesh& mesh, DrawMode draw_mode, int resolution, float radius)
 {
+    Payload payload;
     switch (draw_mode)
     {
     case DrawMode::Surface:
-        initializeSurface(mesh);
+        buildSurface(mesh, payload);
         break;
     case DrawMode::Wireframe:
-        initializeTubes(mesh, resolution, radius); // tubes need a resolution and radius
+        buildTubes(mesh, resolution, radius, payload); // tubes need a resolution and radius
         break;
     case DrawMode::Points:
-        initializeSpheres(mesh, resolution, radius); // spheres need a resolution and radius 
+        buildSpheres(mesh, resolution, radius, payload); // spheres need a resolution and radius 
         break;
     default:
         break;
     }
+    return payload;
 }
 
-
 DrawItem::~DrawItem()
 {
     glDeleteVertexArrays(1, &m_VAO);
     glDeleteBuffers(1, &m_VBO);
     glDeleteBuffers(1, &m_EBO);
+    glDeleteBuffers(1, &m_ABO);
+    glDeleteBuffers(1, &m_OBO);
+    glDeleteBuffers(1, &m_NBO);
+    const unsigned int textures[4] = { m_vertex_texture, m_attribute_texture, m_neighbor_offset_texture, m_neighbor_texture };
+    glDeleteTextures(4, textures);
 }
 
 void DrawItem::draw() const
 {
-    if (m_vertex_data.empty() || m_face_data.empty()) return;
+    if (m_vertex_bytes == 0 || m_face_bytes == 0 || !isUploaded()) return;
 
     glBindVertexArray(m_VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(m_face_data.size()), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(m_face_bytes / sizeof(unsigned int)), GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
 }
 
-void DrawItem::initializeSurface(const QuadMesh& mesh)
+void DrawItem::surfaceAttributes(double scalar, const glm::dvec3& vector, float* out)
+{
+    out[0] = static_cast<float>(scalar);
+    // Make the dvec3->vec3 conversion explicit to avoid narrowing warnings (and be clear)
+    glm::vec3 vec = glm::vec3(vector);
+    out[1] = vec.x;
+    out[2] = vec.y;
+    out[3] = vec.z;
+}
+
+void DrawItem::buildSurface(const FieldMesh& mesh, Payload& payload)
 {
     // get the vertices and faces from the mesh
-    m_vertex_data.clear();
-    m_face_data.clear();
-    // m_vertex_data.reserve(mesh.num_vertices() * 2); // vertex position and normal
-    m_vertex_data.reserve(mesh.num_vertices() * 10); // vertex position, normal, scalar values, and vector values
-    m_face_data.reserve(mesh.num_faces() * 6); // each quad face will be drawn as two triangles
-    for (const std::shared_ptr<Vertex>& v : mesh.vertices())
+    std::vector<float>& vertex_data = payload.vertex_data;
+    std::vector<unsigned int>& face_data = payload.face_data;
+    std::vector<float>& attribute_data = payload.attribute_data;
+    payload.floats_per_vertex = 6;
+    vertex_data.reserve(mesh.num_vertices() * 6); // vertex position and normal
+    attribute_data.resize(mesh.num_vertices() * SURFACE_ATTRIBUTE_FLOATS); // scalar values, and vector values
+    face_data.reserve(mesh.num_faces() * 6); // each quad face will be drawn as two triangles
+    float* attributes = attribute_data.data();
+    for (size_t v = 0; v < mesh.num_vertices(); v++)
     {
-        // m_vertex_data.push_back(glm::vec3(v->pos()));
-        // m_vertex_data.push_back(glm::vec3(v->normal()));
-        glm::vec3 pos = glm::vec3(v->pos());
-        glm::vec3 norm = glm::vec3(v->normal());
-        float scalar = static_cast<float>(v->scalar());
-        // Make the scalar->vec3 conversion explicit to avoid narrowing warnings (and be clear)
-        glm::vec3 vector = glm::vec3(static_cast<float>(v->scalar()));
-        m_vertex_data.push_back(pos.x);
-        m_vertex_data.push_back(pos.y);
-        m_vertex_data.push_back(pos.z);
-        m_vertex_data.push_back(norm.x);
-        m_vertex_data.push_back(norm.y);
-        m_vertex_data.push_back(norm.z);
-        m_vertex_data.push_back(scalar);
-        m_vertex_data.push_back(vector.x);
-        m_vertex_data.push_back(vector.y);
-        m_vertex_data.push_back(vector.z);
-        
+        glm::vec3 pos = glm::vec3(mesh.vertex_position(v));
+        glm::vec3 norm = glm::vec3(mesh.vertex_normal(v));
+        vertex_data.push_back(pos.x);
+        vertex_data.push_back(pos.y);
+        vertex_data.push_back(pos.z);
+        vertex_data.push_back(norm.x);
+        vertex_data.push_back(norm.y);
+        vertex_data.push_back(norm.z);
+        surfaceAttributes(mesh.vertex_scalar(v), mesh.vertex_vector(v), attributes);
+        attributes += SURFACE_ATTRIBUTE_FLOATS;
     }
-    for (const std::shared_ptr<Face>& f : mesh.faces())
+    for (size_t f = 0; f < mesh.num_faces(); f++)
     {
-        std::vector<std::shared_ptr<Vertex>> verts = f->vertices();
-        m_face_data.push_back(verts[0]->id()); // lower right triangle
-        m_face_data.push_back(verts[1]->id());
-        m_face_data.push_back(verts[2]->id());
-        m_face_data.push_back(verts[2]->id()); // upper left triangle
-        m_face_data.push_back(verts[3]->id());
-        m_face_data.push_back(verts[0]->id());
+        unsigned int verts[4];
+        mesh.face_vertices(f, verts);
+        face_data.push_back(verts[0]); // lower right triangle
+        face_data.push_back(verts[1]);
+        face_data.push_back(verts[2]);
+        face_data.push_back(verts[2]); // upper left triangle
+        face_data.push_back(verts[3]);
+        face_data.push_back(verts[0]);
     }
 
-    // set up buffers and arrays
-    glGenVertexArrays(1, &m_VAO);
-    glGenBuffers(1, &m_VBO);
-    glGenBuffers(1, &m_EBO);
-
-    glBindVertexArray(m_VAO);
-
-    // load vertex data into vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    // glBufferData(GL_ARRAY_BUFFER, m_vertex_data.size() * sizeof(glm::vec3), &m_vertex_data[0], GL_STATIC_DRAW); // fix mem issue
-    glBufferData(GL_ARRAY_BUFFER, m_vertex_data.size() * sizeof(float), &m_vertex_data[0], GL_STATIC_DRAW);
-
-    // load face data into element buffer
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_face_data.size() * sizeof(unsigned int), &m_face_data[0], GL_STATIC_DRAW);
-    
-    // Position: location 0, 3 floats, stride 10 floats
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)0);
-
-    // Normal: location 1, 3 floats, stride 10 floats, offset 3 floats
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(3 * sizeof(float)));
-
-    // Scalar: location 2, 1 float, stride 10 floats, offset 6 floats
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(6 * sizeof(float)));
-
-    // Vertex Vector: location 3, 3 floats, stride 10 floats, offset 7 floats
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(float), (void*)(7 * sizeof(float)));
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    // the vertices across the edges of each vertex, which the vertex shaders fit the
+    // scalar gradient to when they raise a height field, counted then filled in
+    std::vector<unsigned int>& offsets = payload.neighbor_offsets;
+    std::vector<unsigned int>& neighbors = payload.neighbors;
+    offsets.assign(mesh.num_vertices() + 1, 0);
+    for (size_t e = 0; e < mesh.num_edges(); e++)
+    {
+        unsigned int ends[2];
+        mesh.edge_vertices(e, ends);
+        offsets[ends[0] + 1]++;
+        offsets[ends[1] + 1]++;
+    }
+    for (size_t v = 0; v < mesh.num_vertices(); v++)
+        offsets[v + 1] += offsets[v];
+    neighbors.resize(offsets.back());
+    std::vector<unsigned int> next(offsets.begin(), offsets.end() - 1);
+    for (size_t e = 0; e < mesh.num_edges(); e++)
+    {
+        unsigned int ends[2];
+        mesh.edge_vertices(e, ends);
+        neighbors[next[ends[0]]++] = ends[1];
+        neighbors[next[ends[1]]++] = ends[0];
+    }
 }
 
-void DrawItem::initializeTubes(const QuadMesh& mesh, int tube_sides, float tube_radius)
+void DrawItem::buildTubes(const FieldMesh& mesh, int tube_sides, float tube_radius, Payload& payload)
 {
-    m_vertex_data.clear();
-    m_face_data.clear();
+    std::vector<float>& vertex_data = payload.vertex_data;
+    std::vector<unsigned int>& face_data = payload.face_data;
+    payload.floats_per_vertex = TUBE_FLOATS_PER_VERTEX;
 
     const float PI = 3.14159265358979323846f;
     float angle_increment = 2.0f * PI / static_cast<float>(tube_sides);
 
     unsigned int index_offset = 0;
 
-    for (const std::shared_ptr<Edge>& edge : mesh.edges())
+    for (size_t e = 0; e < mesh.num_edges(); e++)
     {
         // Get edge endpoints
-        auto v0 = edge->v1();
-        auto v1 = edge->v2();
-        glm::vec3 p0 = glm::vec3(v0->pos());
-        glm::vec3 p1 = glm::vec3(v1->pos());
+        unsigned int ends[2];
+        mesh.edge_vertices(e, ends);
+        glm::vec3 p0 = glm::vec3(mesh.vertex_position(ends[0]));
+        glm::vec3 p1 = glm::vec3(mesh.vertex_position(ends[1]));
 
         // Compute edge direction and perpendicular vectors for square cross-section
         glm::vec3 edge_dir = glm::normalize(p1 - p0);
-        glm::vec3 edge_norm = (glm::vec3(v0->normal()) + glm::vec3(v1->normal())) * 0.5f;
+        glm::vec3 edge_norm = (glm::vec3(mesh.vertex_normal(ends[0])) + glm::vec3(mesh.vertex_normal(ends[1]))) * 0.5f;
 
         glm::vec3 side_side = glm::normalize(glm::cross(edge_dir, edge_norm));
         glm::vec3 in_out = glm::normalize(glm::cross(side_side, edge_dir));
@@ -150,19 +178,20 @@ void DrawItem::initializeTubes(const QuadMesh& mesh, int tube_sides, float tube_
             corners1.push_back(p1 + offset);
         }
 
-        // Add vertices (position only for now)
+        // Add vertices, each with the normal and scalar of the mesh vertex at its end
+        // so the vertex shader raises the tube with the height field
+        glm::vec3 n0 = glm::vec3(mesh.vertex_normal(ends[0]));
+        glm::vec3 n1 = glm::vec3(mesh.vertex_normal(ends[1]));
+        float s0 = static_cast<float>(mesh.vertex_scalar(ends[0]));
+        float s1 = static_cast<float>(mesh.vertex_scalar(ends[1]));
         for (int i = 0; i < tube_sides; ++i)
         {
             glm::vec3 c0 = corners0[i];
             glm::vec3 c1 = corners1[i];
             // c0
-            m_vertex_data.push_back(c0.x);
-            m_vertex_data.push_back(c0.y);
-            m_vertex_data.push_back(c0.z);
+            vertex_data.insert(vertex_data.end(), { c0.x, c0.y, c0.z, n0.x, n0.y, n0.z, s0 });
             // c1
-            m_vertex_data.push_back(c1.x);
-            m_vertex_data.push_back(c1.y);
-            m_vertex_data.push_back(c1.z);
+            vertex_data.insert(vertex_data.end(), { c1.x, c1.y, c1.z, n1.x, n1.y, n1.z, s1 });
         }
 
         // Add faces (quads as two triangles per tube side)
@@ -175,43 +204,24 @@ void DrawItem::initializeTubes(const QuadMesh& mesh, int tube_sides, float tube_
             unsigned int i3 = index_offset + 2 * i + 1;
 
             // First triangle
-            m_face_data.push_back(i0);
-            m_face_data.push_back(i1);
-            m_face_data.push_back(i2);
+            face_data.push_back(i0);
+            face_data.push_back(i1);
+            face_data.push_back(i2);
             // Second triangle
-            m_face_data.push_back(i0);
-            m_face_data.push_back(i2);
-            m_face_data.push_back(i3);
+            face_data.push_back(i0);
+            face_data.push_back(i2);
+            face_data.push_back(i3);
         }
 
         index_offset += 2 * tube_sides;
     }
-
-    // Set up buffers and arrays
-    glGenVertexArrays(1, &m_VAO);
-    glGenBuffers(1, &m_VBO);
-    glGenBuffers(1, &m_EBO);
-
-    glBindVertexArray(m_VAO);
-
-    // Vertex Position: location 0, 3 floats, stride 3 floats
-    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, m_vertex_data.size() * sizeof(float), &m_vertex_data[0], GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_face_data.size() * sizeof(unsigned int), &m_face_data[0], GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
 }
 
-void DrawItem::initializeSpheres(const QuadMesh& mesh, int sphere_divisions, float sphere_radius)
+void DrawItem::buildSpheres(const FieldMesh& mesh, int sphere_divisions, float sphere_radius, Payload& payload)
 {
-    m_vertex_data.clear();
-    m_face_data.clear();
+    std::vector<float>& vertex_data = payload.vertex_data;
+    std::vector<unsigned int>& face_data = payload.face_data;
+    payload.floats_per_vertex = 3;
 
     // Generate a unit sphere mesh (icosphere or UV sphere)
     std::vector<glm::vec3> sphere_vertices;
@@ -286,45 +296,271 @@ void DrawItem::initializeSpheres(const QuadMesh& mesh, int sphere_divisions, flo
 
     // Now create a scaled sphere at each vertex position in the mesh
     unsigned int vertex_offset = 0;
-    for (const std::shared_ptr<Vertex>& v : mesh.vertices())
+    for (size_t v = 0; v < mesh.num_vertices(); v++)
     {
-        glm::vec3 center = glm::vec3(v->pos());
+        glm::vec3 center = glm::vec3(mesh.vertex_position(v));
 
         // Add sphere vertices, transformed to the vertex position and scaled
         for (const glm::vec3& sv : sphere_vertices) 
         {
             glm::vec3 pos = center + sphere_radius * sv;
-            m_vertex_data.push_back(pos.x);
-            m_vertex_data.push_back(pos.y);
-            m_vertex_data.push_back(pos.z);
+            vertex_data.push_back(pos.x);
+            vertex_data.push_back(pos.y);
+            vertex_data.push_back(pos.z);
         }
 
         // Add sphere faces (indices)
         for (const unsigned int& idx : sphere_indices) 
         {
-            m_face_data.push_back(vertex_offset + idx);
+            face_data.push_back(vertex_offset + idx);
         }
 
         vertex_offset += static_cast<unsigned int>(sphere_vertices.size());
     }
+}
 
-    // Set up buffers and arrays
+void DrawItem::initializeBuffers()
+{
+    if (m_vertex_data.empty() || m_face_data.empty()) return;
+
+    // set up buffers and arrays, the data itself is sent by upload()
     glGenVertexArrays(1, &m_VAO);
     glGenBuffers(1, &m_VBO);
     glGenBuffers(1, &m_EBO);
 
     glBindVertexArray(m_VAO);
 
-    // Vertex Position: location 0, 3 floats, stride 3 floats
+    // allocate the vertex buffer
     glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, m_vertex_data.size() * sizeof(float), &m_vertex_data[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, m_vertex_data.size() * sizeof(float), nullptr, GL_STATIC_DRAW);
 
+    // allocate the element buffer
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_face_data.size() * sizeof(unsigned int), &m_face_data[0], GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_face_data.size() * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
 
+    // Position: location 0, 3 floats, offset 0 floats
+    GLsizei stride = m_floats_per_vertex * sizeof(float);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+
+    if (m_floats_per_vertex == TUBE_FLOATS_PER_VERTEX)
+    {
+        // Normal: location 1, 3 floats, offset 3 floats; Scalar: location 2, 1 float, offset 6 floats
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+    }
+
+    if (!m_attribute_data.empty())
+    {
+        // Normal: location 1, 3 floats, stride 6 floats, offset 3 floats
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+
+        // the scalar and vector values live in the attribute buffer, which is rewritten per time step
+        glGenBuffers(1, &m_ABO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_ABO);
+        glBufferData(GL_ARRAY_BUFFER, m_attribute_data.size() * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        GLsizei attribute_stride = SURFACE_ATTRIBUTE_FLOATS * sizeof(float);
+
+        // Scalar: location 2, 1 float, stride 4 floats, offset 0 floats
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, attribute_stride, (void*)0);
+
+        // Vertex Vector: location 3, 3 floats, stride 4 floats, offset 1 float
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, attribute_stride, (void*)(1 * sizeof(float)));
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    if (!m_neighbors.empty())
+        initializeSurfaceTextures();
+}
+
+void DrawItem::initializeSurfaceTextures()
+{
+    // every buffer has to fit in a buffer texture, the largest is the vertex buffer read
+    // one float at a time, a surface too large for that keeps its normals untilted
+    GLint max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    const size_t texels = std::max(m_vertex_bytes / sizeof(float), m_neighbor_bytes / sizeof(unsigned int));
+    if (texels > static_cast<size_t>(max_texels))
+    {
+        std::vector<unsigned int>().swap(m_neighbor_offsets);
+        std::vector<unsigned int>().swap(m_neighbors);
+        m_neighbor_offset_bytes = 0;
+        m_neighbor_bytes = 0;
+        return;
+    }
+
+    // the neighbors never change, the data itself is sent by upload()
+    glGenBuffers(1, &m_OBO);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_OBO);
+    glBufferData(GL_TEXTURE_BUFFER, m_neighbor_offset_bytes, nullptr, GL_STATIC_DRAW);
+    glGenBuffers(1, &m_NBO);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_NBO);
+    glBufferData(GL_TEXTURE_BUFFER, m_neighbor_bytes, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // the textures read the buffers in place, so new attributes reach the shaders
+    // with the attribute buffer itself
+    auto texture = [](unsigned int& name, GLenum format, unsigned int buffer)
+    {
+        glGenTextures(1, &name);
+        glBindTexture(GL_TEXTURE_BUFFER, name);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    };
+    texture(m_vertex_texture, GL_R32F, m_VBO);
+    texture(m_attribute_texture, GL_RGBA32F, m_ABO);
+    texture(m_neighbor_offset_texture, GL_R32UI, m_OBO);
+    texture(m_neighbor_texture, GL_R32UI, m_NBO);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
 
+void DrawItem::bindSurfaceTextures(const Shader& shader) const
+{
+    const unsigned int textures[4] = { m_vertex_texture, m_attribute_texture, m_neighbor_offset_texture, m_neighbor_texture };
+    const char* samplers[4] = { "surfaceVertices", "surfaceAttributes", "neighborOffsets", "neighbors" };
+    for (int k = 0; k < 4; k++)
+    {
+        glActiveTexture(GL_TEXTURE0 + SURFACE_TEXTURE_UNIT + k);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[k]);
+        shader.setInt(samplers[k], SURFACE_TEXTURE_UNIT + k);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    shader.setBool("surfaceNeighbors", m_neighbor_texture != 0 && isUploaded());
+}
+
+// send the next part of one buffer, at most max_bytes, and take it off the budget
+template <typename T>
+static void upload_range(GLenum target, const std::vector<T>& data, size_t& uploaded, size_t& max_bytes)
+{
+    const size_t total = data.size() * sizeof(T);
+    if (max_bytes == 0 || uploaded >= total)
+        return;
+    size_t bytes = std::min(max_bytes, total - uploaded);
+    glBufferSubData(target, uploaded, bytes, reinterpret_cast<const char*>(data.data()) + uploaded);
+    uploaded += bytes;
+    max_bytes -= bytes;
+}
+
+bool DrawItem::upload(size_t max_bytes)
+{
+    if (m_VAO == 0 || isUploaded())
+        return true;
+
+    // vertex data first, then attributes and faces, never more than max_bytes in one call
+    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+    upload_range(GL_ARRAY_BUFFER, m_vertex_data, m_uploaded_vertex_bytes, max_bytes);
+    glBindBuffer(GL_ARRAY_BUFFER, m_ABO);
+    upload_range(GL_ARRAY_BUFFER, m_attribute_data, m_uploaded_attribute_bytes, max_bytes);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_OBO);
+    upload_range(GL_TEXTURE_BUFFER, m_neighbor_offsets, m_uploaded_neighbor_offset_bytes, max_bytes);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_NBO);
+    upload_range(GL_TEXTURE_BUFFER, m_neighbors, m_uploaded_neighbor_bytes, max_bytes);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // the element buffer binding is part of the VAO state
+    glBindVertexArray(m_VAO);
+    upload_range(GL_ELEMENT_ARRAY_BUFFER, m_face_data, m_uploaded_face_bytes, max_bytes);
     glBindVertexArray(0);
-}
\ No newline at end of file
+
+    if (!isUploaded())
+        return false;
+    if (m_release_staging)
+        releaseStaging();
+    return true;
+}
+
+bool DrawItem::isUploaded() const
+{
+    return m_uploaded_vertex_bytes == m_vertex_bytes &&
+           m_uploaded_attribute_bytes == m_attribute_bytes &&
+           m_uploaded_neighbor_offset_bytes == m_neighbor_offset_bytes &&
+           m_uploaded_neighbor_bytes == m_neighbor_bytes &&
+           m_uploaded_face_bytes == m_face_bytes;
+}
+
+void DrawItem::setReleaseStaging(bool release)
+{
+    m_release_staging = release;
+    if (release && isUploaded())
+        releaseStaging();
+}
+
+void DrawItem::releaseStaging()
+{
+    std::vector<float>().swap(m_vertex_data);
+    std::vector<unsigned int>().swap(m_face_data);
+    std::vector<float>().swap(m_attribute_data);
+    std::vector<unsigned int>().swap(m_neighbor_offsets);
+    std::vector<unsigned int>().swap(m_neighbors);
+}
+
+MemoryFootprint DrawItem::footprint() const
+{
+    MemoryFootprint footprint;
+    footprint.staging = capacity_bytes(m_vertex_data) + capacity_bytes(m_face_data) + capacity_bytes(m_attribute_data) +
+        capacity_bytes(m_neighbor_offsets) + capacity_bytes(m_neighbors);
+    footprint.gpu = m_vertex_bytes + m_face_bytes + m_attribute_bytes + m_neighbor_offset_bytes + m_neighbor_bytes;
+    return footprint;
+}
+
+void DrawItem::updateAttributes(const std::vector<float>& attribute_data)
+{
+    if (m_ABO == 0 || attribute_data.size() * sizeof(float) != m_attribute_bytes)
+        return;
+
+    if (m_attribute_data.empty())
+    {
+        // nothing to compare with once the staging copy is gone, send all of it
+        m_uploaded_attribute_bytes = m_attribute_bytes;
+        glBindBuffer(GL_ARRAY_BUFFER, m_ABO);
+        glBufferData(GL_ARRAY_BUFFER, m_attribute_bytes, nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, m_attribute_bytes, attribute_data.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+
+    // find the runs of vertices whose values changed, runs closer than a small gap
+    // are merged since a few extra bytes are cheaper than another upload call
+    const size_t n = attribute_data.size();
+    const size_t merge_gap = 64 * SURFACE_ATTRIBUTE_FLOATS;
+    std::vector<std::pair<size_t, size_t>> runs; // [begin, end) in floats
+    for (size_t begin = 0; begin < n; begin += SURFACE_ATTRIBUTE_FLOATS)
+    {
+        size_t end = begin + SURFACE_ATTRIBUTE_FLOATS;
+        if (std::equal(attribute_data.begin() + begin, attribute_data.begin() + end, m_attribute_data.begin() + begin))
+            continue;
+        if (!runs.empty() && begin - runs.back().second <= merge_gap)
+            runs.back().second = end;
+        else
+            runs.emplace_back(begin, end);
+    }
+    size_t changed = 0;
+    for (const auto& run : runs)
+        changed += run.second - run.first;
+    if (changed == 0)
+        return;
+
+    std::copy(attribute_data.begin(), attribute_data.end(), m_attribute_data.begin());
+    m_uploaded_attribute_bytes = n * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, m_ABO);
+    if (changed > n / 2)
+    {
+        // most of the buffer changed, orphan the old storage so we don't wait on draws still using it
+        glBufferData(GL_ARRAY_BUFFER, n * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, n * sizeof(float), m_attribute_data.data());
+    }
+    else
+    {
+        for (const auto& run : runs)
+            glBufferSubData(GL_ARRAY_BUFFER, run.first * sizeof(float), (run.second - run.first) * sizeof(float),
+                m_attribute_data.data() + run.first);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,322 @@
+#include "facebvh.h"
+#include "footprint.h"
+#include "parallel.h"
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+
+// an x-y box in float, rounded outward from the double corners it was made from
+struct Box
+{
+    glm::vec2 min = glm::vec2(std::numeric_limits<float>::infinity());
+    glm::vec2 max = glm::vec2(-std::numeric_limits<float>::infinity());
+
+    void grow(const Box& other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+    // the 2D stand-in for surface area
+    float half_perimeter() const { return (max.x - min.x) + (max.y - min.y); }
+    glm::vec2 center() const { return 0.5f * (min + max); }
+};
+
+// a face and its box, which move together while the faces are split so the boxes are
+// read in order
+struct Ref
+{
+    Box box;
+    uint32_t face;
+};
+
+float round_down(double x)
+{
+    float f = static_cast<float>(x);
+    return (f > x) ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+}
+
+float round_up(double x)
+{
+    float f = static_cast<float>(x);
+    return (f < x) ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+}
+
+// Binned SAH split of the faces into the nodes below one node. If tasks is set, nodes
+// with no more than task_size faces are left as tasks to be built on their own threads,
+// and the larger ones above them are binned in parallel.
+class Builder
+{
+public:
+
+    // a node's faces, with the bounds of their boxes and of their box centers
+    struct Range
+    {
+        uint32_t begin, end;
+        Box bounds, centers;
+    };
+    struct Task { uint32_t node; Range range; size_t depth; };
+
+    static const size_t NUM_BINS = 16;
+    // nodes with this many faces or fewer are leaves, checking them beats another step
+    // down, and past it the SAH decides up to MAX_LEAF_FACES
+    static const uint32_t MIN_LEAF_FACES = 4;
+    static const uint32_t MAX_LEAF_FACES = 8;
+    // past this depth splits halve the faces, so the depth stays below FaceBVH's stack size
+    static const size_t MAX_SAH_DEPTH = 64;
+
+    std::vector<Ref>& refs;
+    std::vector<FaceBVH::Node>& nodes;
+    std::vector<Task>* tasks = nullptr;
+    size_t task_size = 0;
+    size_t max_depth = 0;
+
+    Builder(std::vector<Ref>& refs, std::vector<FaceBVH::Node>& nodes) : refs(refs), nodes(nodes) {}
+
+    // the range of faces from begin to end, measured
+    Range range(uint32_t begin, uint32_t end)
+    {
+        Range r{ begin, end, Box(), Box() };
+        for_each_chunk_with<Range>(begin, end, [&](uint32_t b, uint32_t e, Range& partial)
+        {
+            for (uint32_t i = b; i < e; i++)
+            {
+                const Box& box = refs[i].box;
+                partial.bounds.grow(box);
+                glm::vec2 c = box.center();
+                partial.centers.grow(Box{ c, c });
+            }
+        }, [&](const Range& partial)
+        {
+            r.bounds.grow(partial.bounds);
+            r.centers.grow(partial.centers);
+        });
+        return r;
+    }
+
+    void build(uint32_t node, const Range& r, size_t depth)
+    {
+        const uint32_t count = r.end - r.begin;
+        if (tasks && count <= task_size)
+        {
+            tasks->push_back({ node, r, depth });
+            return;
+        }
+        max_depth = std::max(max_depth, depth);
+
+        FaceBVH::Node& n = nodes[node];
+        n.min_x = r.bounds.min.x;
+        n.min_y = r.bounds.min.y;
+        n.max_x = r.bounds.max.x;
+        n.max_y = r.bounds.max.y;
+        n.first = r.begin;
+        n.count = count;
+        if (count <= MIN_LEAF_FACES)
+            return;
+
+        const glm::vec2 extent = r.centers.max - r.centers.min;
+        const int axis = (extent.y > extent.x) ? 1 : 0;
+        Range left_range, right_range;
+        if (extent[axis] <= 0.0f || depth >= MAX_SAH_DEPTH)
+        {
+            // all centers in one place, where any split is as good as another, or deep
+            // enough that the tree should just halve the faces
+            if (extent[axis] <= 0.0f && count <= MAX_LEAF_FACES)
+                return;
+            const uint32_t mid = r.begin + count / 2;
+            auto less = [&](const Ref& a, const Ref& b) { return a.box.center()[axis] < b.box.center()[axis]; };
+            std::nth_element(refs.begin() + r.begin, refs.begin() + mid, refs.begin() + r.end, less);
+            left_range = range(r.begin, mid);
+            right_range = range(mid, r.end);
+        }
+        else
+        {
+            // the faces in bins along the axis, and the cheapest place to split the bins
+            const float scale = NUM_BINS / extent[axis];
+            const float origin = r.centers.min[axis];
+            auto bin_of = [&](const Ref& ref)
+            {
+                int bin = static_cast<int>((ref.box.center()[axis] - origin) * scale);
+                return std::min<size_t>(bin, NUM_BINS - 1);
+            };
+            struct Bins { Box boxes[NUM_BINS], centers[NUM_BINS]; uint32_t counts[NUM_BINS] = {}; };
+            Bins bins;
+            for_each_chunk_with<Bins>(r.begin, r.end, [&](uint32_t b, uint32_t e, Bins& partial)
+            {
+                for (uint32_t i = b; i < e; i++)
+                {
+                    const Box& box = refs[i].box;
+                    const size_t bin = bin_of(refs[i]);
+                    const glm::vec2 c = box.center();
+                    partial.boxes[bin].grow(box);
+                    partial.centers[bin].grow(Box{ c, c });
+                    partial.counts[bin]++;
+                }
+            }, [&](const Bins& partial)
+            {
+                for (size_t bin = 0; bin < NUM_BINS; bin++)
+                {
+                    bins.boxes[bin].grow(partial.boxes[bin]);
+                    bins.centers[bin].grow(partial.centers[bin]);
+                    bins.counts[bin] += partial.counts[bin];
+                }
+            });
+
+            float right_cost[NUM_BINS];
+            Box right;
+            uint32_t right_count = 0;
+            for (size_t bin = NUM_BINS - 1; bin > 0; bin--)
+            {
+                right.grow(bins.boxes[bin]);
+                right_count += bins.counts[bin];
+                right_cost[bin] = right_count * right.half_perimeter();
+            }
+            Box left;
+            uint32_t left_count = 0;
+            float best_cost = std::numeric_limits<float>::infinity();
+            size_t best_bin = 0;
+            for (size_t bin = 0; bin + 1 < NUM_BINS; bin++)
+            {
+                left.grow(bins.boxes[bin]);
+                left_count += bins.counts[bin];
+                if (left_count == 0 || left_count == count)
+                    continue;
+                float cost = left_count * left.half_perimeter() + right_cost[bin + 1];
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_bin = bin;
+                }
+            }
+
+            // a leaf when checking its faces costs no more than a step down and the faces on each side
+            if (count <= MAX_LEAF_FACES && count * r.bounds.half_perimeter() <= r.bounds.half_perimeter() + best_cost)
+                return;
+            const uint32_t mid = static_cast<uint32_t>(std::partition(refs.begin() + r.begin, refs.begin() + r.end,
+                [&](const Ref& ref) { return bin_of(ref) <= best_bin; }) - refs.begin());
+            left_range = Range{ r.begin, mid, Box(), Box() };
+            right_range = Range{ mid, r.end, Box(), Box() };
+            for (size_t bin = 0; bin < NUM_BINS; bin++)
+            {
+                Range& side = (bin <= best_bin) ? left_range : right_range;
+                side.bounds.grow(bins.boxes[bin]);
+                side.centers.grow(bins.centers[bin]);
+            }
+        }
+
+        const uint32_t left_child = static_cast<uint32_t>(nodes.size());
+        nodes.resize(nodes.size() + 2);
+        nodes[node].first = left_child;
+        nodes[node].count = 0;
+        build(left_child, left_range, depth + 1);
+        build(left_child + 1, right_range, depth + 1);
+    }
+
+private:
+
+    // fn(b, e, partial) on chunks of [begin, end), in parallel at the top of the tree,
+    // then merge(partial) for each chunk in order
+    template <typename Partial, typename Function, typename Merge>
+    void for_each_chunk_with(uint32_t begin, uint32_t end, Function fn, Merge merge)
+    {
+        // inside the subtrees, where this runs for every node, without asking for the thread count
+        if (!tasks)
+        {
+            Partial p{};
+            fn(begin, end, p);
+            merge(p);
+            return;
+        }
+        const size_t count = end - begin;
+        const size_t num_chunks = std::min<size_t>(num_worker_threads(), std::max<size_t>(1, count / 65536));
+        std::vector<Partial> partials(num_chunks);
+        parallel_for_chunks(num_chunks, [&](size_t chunk)
+        {
+            fn(static_cast<uint32_t>(begin + count * chunk / num_chunks),
+               static_cast<uint32_t>(begin + count * (chunk + 1) / num_chunks), partials[chunk]);
+        });
+        for (const Partial& p : partials)
+            merge(p);
+    }
+};
+
+} // namespace
+
+FaceBVH::FaceBVH(const HalfEdgeMesh& mesh)
+{
+    const size_t nf = mesh.num_faces();
+    if (nf == 0)
+        return;
+
+    // the x-y box of every face
+    std::vector<Ref> refs(nf);
+    parallel_for(nf, [&](size_t begin, size_t end)
+    {
+        for (size_t f = begin; f < end; f++)
+        {
+            const uint32_t* corners = &mesh.half_vertex[4 * f];
+            glm::dvec2 lo(mesh.position(corners[0])), hi = lo;
+            for (int k = 1; k < 4; k++)
+            {
+                glm::dvec2 pos(mesh.position(corners[k]));
+                lo = glm::min(lo, pos);
+                hi = glm::max(hi, pos);
+            }
+            refs[f].box.min = glm::vec2(round_down(lo.x), round_down(lo.y));
+            refs[f].box.max = glm::vec2(round_up(hi.x), round_up(hi.y));
+            refs[f].face = static_cast<uint32_t>(f);
+        }
+    }, 16384);
+
+    // the top of the tree on this thread, leaving subtrees of a few thousand faces and
+    // up, enough to go around the worker threads a few times
+    std::vector<Builder::Task> tasks;
+    m_nodes.reserve(2 * nf / Builder::MIN_LEAF_FACES + 1);
+    m_nodes.resize(1);
+    Builder top(refs, m_nodes);
+    top.tasks = &tasks;
+    top.task_size = std::max<size_t>(nf / (4 * num_worker_threads()), 4096);
+    top.build(0, top.range(0, static_cast<uint32_t>(nf)), 0);
+
+    // the subtrees, each into its own nodes, which are then appended to the top with
+    // their root in the place the top left for it
+    std::vector<std::vector<Node>> subtree_nodes(tasks.size());
+    std::vector<size_t> subtree_depths(tasks.size());
+    parallel_for_chunks(tasks.size(), [&](size_t t)
+    {
+        const Builder::Task& task = tasks[t];
+        subtree_nodes[t].resize(1);
+        Builder builder(refs, subtree_nodes[t]);
+        builder.build(0, task.range, task.depth);
+        subtree_depths[t] = builder.max_depth;
+    });
+    m_depth = top.max_depth;
+    for (size_t t = 0; t < tasks.size(); t++)
+    {
+        // node i > 0 of the subtree goes to base + i
+        const uint32_t base = static_cast<uint32_t>(m_nodes.size()) - 1;
+        std::vector<Node>& nodes = subtree_nodes[t];
+        for (Node& node : nodes)
+        {
+            if (node.count == 0)
+                node.first += base;
+        }
+        m_nodes[tasks[t].node] = nodes[0];
+        m_nodes.insert(m_nodes.end(), nodes.begin() + 1, nodes.end());
+        m_depth = std::max(m_depth, subtree_depths[t]);
+        std::vector<Node>().swap(nodes);
+    }
+    m_nodes.shrink_to_fit();
+    m_faces.resize(nf);
+    for (size_t i = 0; i < nf; i++)
+        m_faces[i] = refs[i].face;
+}
+
+size_t FaceBVH::memory_bytes() const
+{
+    return capacity_bytes(m_nodes) + capacity_bytes(m_faces);
+}
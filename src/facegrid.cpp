@@ -0,0 +1,133 @@
+#include "facegrid.h"
+#include "footprint.h"
+#include "parallel.h"
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+FaceGrid::FaceGrid(const HalfEdgeMesh& mesh)
+{
+    const size_t nf = mesh.num_faces();
+    if (nf == 0)
+        return;
+
+    // the x-y box of every face, and the bounds and mean size of all of them
+    std::vector<glm::dvec2> face_min(nf), face_max(nf);
+    const size_t num_chunks = std::min<size_t>(num_worker_threads(), std::max<size_t>(1, nf / 65536));
+    struct Partial { glm::dvec2 min, max; double sum_size; };
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<Partial> partials(num_chunks, Partial{ glm::dvec2(inf), glm::dvec2(-inf), 0.0 });
+    parallel_for_chunks(num_chunks, [&](size_t chunk)
+    {
+        Partial p = partials[chunk];
+        for (size_t f = nf * chunk / num_chunks; f < nf * (chunk + 1) / num_chunks; f++)
+        {
+            const uint32_t* corners = &mesh.half_vertex[4 * f];
+            glm::dvec2 lo(mesh.position(corners[0])), hi = lo;
+            for (int k = 1; k < 4; k++)
+            {
+                glm::dvec2 pos(mesh.position(corners[k]));
+                lo = glm::min(lo, pos);
+                hi = glm::max(hi, pos);
+            }
+            face_min[f] = lo;
+            face_max[f] = hi;
+            p.min = glm::min(p.min, lo);
+            p.max = glm::max(p.max, hi);
+            p.sum_size += 0.5 * ((hi.x - lo.x) + (hi.y - lo.y));
+        }
+        partials[chunk] = p;
+    });
+    glm::dvec2 min_pt(inf), max_pt(-inf);
+    double sum_size = 0.0;
+    for (const Partial& p : partials)
+    {
+        min_pt = glm::min(min_pt, p.min);
+        max_pt = glm::max(max_pt, p.max);
+        sum_size += p.sum_size;
+    }
+
+    // buckets the mean face size across, but no more than a few per face so a mesh
+    // with a lot of empty space inside its bounds does not get a huge grid
+    const glm::dvec2 extent = glm::max(max_pt - min_pt, glm::dvec2(std::numeric_limits<double>::min()));
+    double cell_size = sum_size / static_cast<double>(nf);
+    if (!(cell_size > 0.0))
+        cell_size = std::max(extent.x, extent.y);
+    const double max_cells = 4.0 * static_cast<double>(nf);
+    if ((extent.x / cell_size) * (extent.y / cell_size) > max_cells)
+        cell_size = std::sqrt(extent.x * extent.y / max_cells);
+    m_nx = std::max<size_t>(1, static_cast<size_t>(std::ceil(extent.x / cell_size)));
+    m_ny = std::max<size_t>(1, static_cast<size_t>(std::ceil(extent.y / cell_size)));
+    m_min = min_pt;
+    m_max = max_pt;
+    m_inverse_cell_size = glm::dvec2(static_cast<double>(m_nx) / extent.x, static_cast<double>(m_ny) / extent.y);
+
+    // counting sort of the faces into every bucket their box overlaps, filled in face
+    // order so each bucket lists its faces in order
+    auto cell_range = [&](size_t f, size_t& i0, size_t& i1, size_t& j0, size_t& j1)
+    {
+        i0 = column(face_min[f].x);
+        i1 = column(face_max[f].x);
+        j0 = row(face_min[f].y);
+        j1 = row(face_max[f].y);
+    };
+    m_cell_offsets.assign(m_nx * m_ny + 1, 0);
+    for (size_t f = 0; f < nf; f++)
+    {
+        size_t i0, i1, j0, j1;
+        cell_range(f, i0, i1, j0, j1);
+        for (size_t j = j0; j <= j1; j++)
+            for (size_t i = i0; i <= i1; i++)
+                m_cell_offsets[i + j * m_nx + 1]++;
+    }
+    double sum_squares = 0.0;
+    for (size_t c = 0; c < m_nx * m_ny; c++)
+    {
+        sum_squares += static_cast<double>(m_cell_offsets[c + 1]) * m_cell_offsets[c + 1];
+        m_cell_offsets[c + 1] += m_cell_offsets[c];
+    }
+    m_mean_candidates = sum_squares / static_cast<double>(m_cell_offsets.back());
+    m_cell_faces.resize(m_cell_offsets.back());
+    std::vector<uint32_t> fill(m_cell_offsets.begin(), m_cell_offsets.end() - 1);
+    for (size_t f = 0; f < nf; f++)
+    {
+        size_t i0, i1, j0, j1;
+        cell_range(f, i0, i1, j0, j1);
+        for (size_t j = j0; j <= j1; j++)
+            for (size_t i = i0; i <= i1; i++)
+                m_cell_faces[fill[i + j * m_nx]++] = static_cast<uint32_t>(f);
+    }
+}
+
+size_t FaceGrid::nx() const { return m_nx; }
+size_t FaceGrid::ny() const { return m_ny; }
+double FaceGrid::mean_candidates() const { return m_mean_candidates; }
+
+size_t FaceGrid::column(double x) const
+{
+    double i = std::floor((x - m_min.x) * m_inverse_cell_size.x);
+    return static_cast<size_t>(std::clamp(i, 0.0, static_cast<double>(m_nx - 1)));
+}
+
+size_t FaceGrid::row(double y) const
+{
+    double j = std::floor((y - m_min.y) * m_inverse_cell_size.y);
+    return static_cast<size_t>(std::clamp(j, 0.0, static_cast<double>(m_ny - 1)));
+}
+
+std::pair<const uint32_t*, const uint32_t*> FaceGrid::candidates(const glm::dvec3& point) const
+{
+    // a face's box and a point inside it go through the same rounding, so the point's
+    // bucket is always one the face was listed in
+    if (m_cell_offsets.empty() || !(point.x >= m_min.x && point.x <= m_max.x && point.y >= m_min.y && point.y <= m_max.y))
+        return { nullptr, nullptr };
+    const size_t cell = column(point.x) + row(point.y) * m_nx;
+    return { m_cell_faces.data() + m_cell_offsets[cell], m_cell_faces.data() + m_cell_offsets[cell + 1] };
+}
+
+size_t FaceGrid::memory_bytes() const
+{
+    return capacity_bytes(m_cell_offsets) + capacity_bytes(m_cell_faces);
+}
@@ -0,0 +1,40 @@
+#include "faceinterpolation.h"
+#include "footprint.h"
+#include "parallel.h"
+
+FaceInterpolation::FaceInterpolation(const HalfEdgeMesh& mesh)
+{
+    const size_t nf = mesh.num_faces();
+    for (std::vector<double>* coefficient : { &m_ax, &m_ay, &m_ex, &m_ey, &m_fx, &m_fy, &m_gx, &m_gy, &m_ef, &m_gf })
+        coefficient->resize(nf);
+    m_corners.assign(mesh.half_vertex.begin(), mesh.half_vertex.begin() + 4 * nf);
+    parallel_for(nf, [&](size_t begin, size_t end)
+    {
+        for (size_t f = begin; f < end; f++)
+        {
+            const uint32_t* corners = &m_corners[4 * f];
+            glm::dvec2 positions[4];
+            for (int k = 0; k < 4; k++)
+                positions[k] = glm::dvec2(mesh.position(corners[k]));
+            const Quad q = quad(positions);
+            m_ax[f] = q.a.x;
+            m_ay[f] = q.a.y;
+            m_ex[f] = q.e.x;
+            m_ey[f] = q.e.y;
+            m_fx[f] = q.f.x;
+            m_fy[f] = q.f.y;
+            m_gx[f] = q.g.x;
+            m_gy[f] = q.g.y;
+            m_ef[f] = q.ef;
+            m_gf[f] = q.gf;
+        }
+    }, 16384);
+}
+
+size_t FaceInterpolation::memory_bytes() const
+{
+    size_t bytes = capacity_bytes(m_corners);
+    for (const std::vector<double>* coefficient : { &m_ax, &m_ay, &m_ex, &m_ey, &m_fx, &m_fy, &m_gx, &m_gy, &m_ef, &m_gf })
+        bytes += capacity_bytes(*coefficient);
+    return bytes;
+}
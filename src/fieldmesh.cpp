@@ -0,0 +1,94 @@
+#include "fieldmesh.h"
+#include "quadmesh.h"
+#include "structuredgrid.h"
+#include "plyreader.h"
+#include "meshcache.h"
+#include "mappedfile.h"
+#include <iostream>
+
+static void print_grid(const char* filename, const StructuredGrid2D& grid, bool cached)
+{
+    std::cout << "Opened structured grid from " << filename << " (" << grid.nx() << " x "
+              << grid.ny() << (cached ? ", cached)" : ")") << std::endl;
+    grid.print_info();
+}
+
+std::unique_ptr<FieldMesh> FieldMesh::open(const char* filename, bool verbose, const LoadProgress& progress)
+{
+    auto report = [&](const char* stage, double fraction)
+    {
+        if (progress)
+            progress(stage, fraction);
+    };
+
+    // the file is mapped and hashed once, the cache says whether it is a grid, so
+    // on a hit it is not parsed at all
+    MappedFile file(filename);
+    if (!file.is_open())
+    {
+        std::cout << "Could not open .ply file: " << filename << std::endl;
+        return nullptr;
+    }
+    MeshSource source;
+    source.filename = filename;
+    source.file = &file;
+    source.kind = MeshCacheKind::CheckedMesh;
+    if (QuadMesh::cache_enabled())
+    {
+        report("hashing file", 0.0);
+        source.hash = hash_bytes(file.data(), file.size());
+        source.size = file.size();
+        source.cache_path = QuadMesh::cache_path(filename, source.hash);
+
+        MeshCacheHeader header;
+        if (read_mesh_cache_header(source.cache_path, source.hash, source.size, header))
+        {
+            if (header.kind == static_cast<uint32_t>(MeshCacheKind::CheckedMesh))
+                return std::make_unique<QuadMesh>(source, nullptr, verbose, progress);
+            std::unique_ptr<StructuredGrid2D> grid;
+            if (header.kind == static_cast<uint32_t>(MeshCacheKind::Grid))
+                grid = StructuredGrid2D::read_cache(source.cache_path, source.hash, source.size);
+            if (grid)
+            {
+                read_ply_attributes(file, filename, grid->attributes());
+                report("done", 1.0);
+                if (verbose)
+                    print_grid(filename, *grid, true);
+                return grid;
+            }
+        }
+    }
+
+    // not cached, or cached by a QuadMesh that was never checked for a grid
+    report("reading file", 0.05);
+    PlyData ply;
+    if (!read_ply_file(file, filename, ply))
+        return nullptr;
+    report("checking for a regular grid", 0.25);
+    std::unique_ptr<StructuredGrid2D> grid = StructuredGrid2D::detect(ply);
+    if (!grid)
+        return std::make_unique<QuadMesh>(source, &ply, verbose, progress);
+
+    if (!source.cache_path.empty() && !grid->write_cache(source.cache_path, source.hash, source.size))
+        std::cout << "Could not write mesh cache file: " << source.cache_path << std::endl;
+    report("done", 1.0);
+    if (verbose)
+        print_grid(filename, *grid, false);
+    return grid;
+}
+
+std::unique_ptr<FieldMesh> FieldMesh::open(const char* filename, const PlyData& ply, bool verbose,
+    const LoadProgress& progress)
+{
+    if (progress)
+        progress("checking for a regular grid", 0.25);
+    std::unique_ptr<StructuredGrid2D> grid = StructuredGrid2D::detect(ply);
+    if (!grid)
+        return std::make_unique<QuadMesh>(filename, ply, verbose, progress);
+
+    if (progress)
+        progress("done", 1.0);
+    if (verbose)
+        print_grid(filename, *grid, false);
+    return grid;
+}
@@ -6,6 +6,10 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <random>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
 
 #include <random>
 #define STB_IMAGE_IMPLEMENTATION
@@ -15,6 +19,10 @@
 #include "trackball.h"
 #include "quadmesh.h"
 #include "drawitem.h"
+#include "tiledmesh.h"
+#include "meshbenchmark.h"
+#include "meshloader.h"
+#include "timeseries.h"
 
 
 
@@ -29,6 +37,8 @@ double last_mouse_y = 0.0;
 bool translating = false;
 bool rotating = false;
 bool toggle_height = false;
+float height_factor = 1.0f;
+glm::vec2 height_scalar_range(0.0f, 1.0f); // scalars at the bottom and top of the height field
 bool toggle_contours;
 int color_scheme = 0; // 0 = soild color, 1 = grayscale, 3 = 
 bool draw_streamlines = false;
@@ -43,10 +53,27 @@ glm::vec3 cameraUp(0.0f, 1.0f, 0.0f);
 
 // objects
 std::unique_ptr<Trackball> trackball = nullptr;
-std::unique_ptr<QuadMesh> mesh_data = nullptr;
+std::unique_ptr<FieldMesh> mesh_data = nullptr;
 std::unique_ptr<DrawItem> mesh_surface = nullptr;
 std::unique_ptr<QuadMesh> stream_data = nullptr;
 std::unique_ptr<DrawItem> stream_tubes = nullptr;
+std::unique_ptr<TiledMesh> tiled_data = nullptr;
+std::map<size_t, std::unique_ptr<DrawItem>> tile_surfaces; // drawables for resident tiles
+
+// background loading, the new mesh replaces mesh_data once its surface is on the GPU
+std::unique_ptr<MeshLoader> mesh_loader = nullptr;
+std::unique_ptr<FieldMesh> loaded_mesh = nullptr;
+std::unique_ptr<DrawItem> loaded_surface = nullptr;
+std::string loaded_filename;
+std::string window_title = "Scientific Visualization";
+std::string loading_title; // window title while a load is in progress
+const size_t UPLOAD_BYTES_PER_FRAME = 16 << 20; // keeps large uploads from stalling a frame
+const int TILED_STREAMLINE_SEEDS = 64; // a tiled mesh seeds streamlines on a lattice this wide over the view
+
+// time series playback, the first frame is loaded as mesh_data and later frames only replace its attributes
+std::unique_ptr<TimeSeries> time_series = nullptr;
+std::vector<std::string> pending_series; // frames of a series whose first frame is still loading
+std::shared_ptr<const TimeSeries::Frame> series_frame = nullptr; // frame on screen
 
 // shader programs
 std::shared_ptr<Shader> surfaceShader = nullptr;
@@ -68,7 +95,17 @@ unsigned int imageTexture;
 void set_scene();
 void load_shaders();
 void update_shaders();
+void set_height_uniforms(const Shader& shader, bool shown);
 void load_textures();
+void view_xy_bounds(glm::dvec2& min_xy, glm::dvec2& max_xy);
+void update_visible_tiles();
+void update_loading(GLFWwindow* window);
+void show_new_dataset(GLFWwindow* window, const char* filename, bool same_mesh = false);
+void start_time_series(const std::string& filename);
+uint64_t current_topology();
+void open_time_series(const std::vector<std::string>& filenames);
+void update_time_series(GLFWwindow* window);
+void pause_time_series();
 
 // GLFW Callback Declarations
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -89,6 +126,39 @@ void drop_callback(GLFWwindow* window, int count, const char** paths);
 
 int main(int argc, char* argv[])
 {
+    // split a large mesh into tiles without opening a window
+    if (argc == 6 && std::string(argv[1]) == "--tile")
+    {
+        bool ok = TiledMesh::build_tiles(argv[2], argv[3], std::atoi(argv[4]), std::atoi(argv[5]));
+        return ok ? 0 : -1;
+    }
+
+    // compare the mesh loops with the file's vertex order and with a Morton order
+    if (argc == 3 && std::string(argv[1]) == "--layout-benchmark")
+        return run_layout_benchmark(argv[2]) ? 0 : -1;
+
+    // point location through the face grid against a scan of every face
+    if ((argc == 3 || argc == 4) && std::string(argv[1]) == "--locator-benchmark")
+    {
+        size_t synthetic_faces = (argc == 4) ? std::strtoull(argv[3], nullptr, 10) : 10000000;
+        return run_locator_benchmark(argv[2], synthetic_faces) ? 0 : -1;
+    }
+
+    // batched field sampling against one point at a time
+    if (argc == 3 && std::string(argv[1]) == "--sampling-benchmark")
+        return run_sampling_benchmark(argv[2]) ? 0 : -1;
+
+    // the ASCII reader against the istringstream loop it replaced
+    if ((argc == 3 || argc == 4) && std::string(argv[1]) == "--ply-benchmark")
+    {
+        size_t synthetic_vertices = (argc == 4) ? std::strtoull(argv[3], nullptr, 10) : 10000000;
+        return run_ply_benchmark(argv[2], synthetic_vertices) ? 0 : -1;
+    }
+
+    // edge construction on generated grids, with the faces in order and shuffled
+    if (argc == 2 && std::string(argv[1]) == "--edge-benchmark")
+        return run_edge_benchmark() ? 0 : -1;
+
 	// check command line arguments
     // const char* data_path = "";
     // if (argc > 1)
@@ -153,6 +223,13 @@ int main(int argc, char* argv[])
     load_textures();
     load_shaders();
 
+    // start the background mesh loader
+    mesh_loader = std::make_unique<MeshLoader>();
+
+    // play back a time series given as a file pattern, e.g. --series "data/scalar_data/r*.ply"
+    if (argc == 3 && std::string(argv[1]) == "--series")
+        open_time_series(TimeSeries::expand_pattern(argv[2]));
+
     // create drawable item from the mesh
     // commented out to allow for the drop files into window feature
     // std::unique_ptr<DrawItem> mesh_surface = 
@@ -170,6 +247,8 @@ int main(int argc, char* argv[])
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
 
+        update_loading(window);
+        update_time_series(window);
         set_scene();
         
         // bind textures for LIC shader
@@ -190,11 +269,33 @@ int main(int argc, char* argv[])
             surfaceShader->setMat4("viewMatrix", view);
             surfaceShader->setMat4("modelMatrix", model);
             surfaceShader->setVec3("viewPos", cameraPos);
+            set_height_uniforms(*surfaceShader, toggle_height);
+            mesh_surface->bindSurfaceTextures(*surfaceShader);
             
             glDepthMask(GL_TRUE);            
             mesh_surface->draw();
         }
 
+        // draw the visible tiles of a tiled mesh
+        if (tiled_data) {
+            update_visible_tiles();
+            surfaceShader->use();
+            surfaceShader->setMat4("projectionMatrix", projection);
+            surfaceShader->setMat4("viewMatrix", view);
+            surfaceShader->setMat4("modelMatrix", model);
+            surfaceShader->setVec3("viewPos", cameraPos);
+            set_height_uniforms(*surfaceShader, false);
+
+            glDepthMask(GL_TRUE);
+            for (auto& [i, surface] : tile_surfaces)
+            {
+                if (!surface->isUploaded())
+                    continue;
+                surface->bindSurfaceTextures(*surfaceShader);
+                surface->draw();
+            }
+        }
+
         if (mesh_surface && toggle_contours) {
             glEnable(GL_POLYGON_OFFSET_FILL);   // these two lines make sure that we 
             glPolygonOffset(-1.0f, -1.0f);      // draw on top of anything already drawn
@@ -203,6 +304,8 @@ int main(int argc, char* argv[])
             contourShader->setMat4("viewMatrix", view);
             contourShader->setMat4("modelMatrix", model);
             contourShader->setVec3("viewPos", cameraPos);
+            set_height_uniforms(*contourShader, toggle_height);
+            mesh_surface->bindSurfaceTextures(*contourShader);
             mesh_surface->draw();
             glDisable(GL_POLYGON_OFFSET_FILL);  // 
         }
@@ -215,6 +318,8 @@ int main(int argc, char* argv[])
             flatShader->setMat4("viewMatrix", view);
             flatShader->setMat4("modelMatrix", model);
             flatShader->setVec3("viewPos", cameraPos);
+            set_height_uniforms(*flatShader, toggle_height && mesh_surface);
+            flatShader->setBool("surfaceNeighbors", false);
             glDepthMask(GL_TRUE);
             stream_tubes->draw();
         }
@@ -224,6 +329,8 @@ int main(int argc, char* argv[])
         glfwPollEvents();
     }
     
+    time_series = nullptr;
+    mesh_loader = nullptr;
     glfwDestroyWindow(window);
     glfwTerminate();
     return 0;
@@ -255,9 +362,192 @@ void set_scene()
     model = glm::translate(model, TRANSLATION);
     model = model * ROTATION;
     if (mesh_data) {
-        model = glm::scale(model, glm::vec3(0.9f / static_cast<float>(mesh_data->get_radius())));
+        // a raised height field moves no vertex further than the height factor
+        double radius = mesh_data->get_radius();
+        if (toggle_height)
+            radius += std::abs(height_factor);
+        model = glm::scale(model, glm::vec3(0.9f / static_cast<float>(radius)));
         model = glm::translate(model, -glm::vec3(mesh_data->midpoint()));         
     }
+    else if (tiled_data) {
+        model = glm::scale(model, glm::vec3(0.9f / static_cast<float>(tiled_data->get_radius())));
+        model = glm::translate(model, -glm::vec3(tiled_data->midpoint()));
+    }
+}
+
+// the xy rectangle of mesh coordinates on screen
+void view_xy_bounds(glm::dvec2& min_xy, glm::dvec2& max_xy)
+{
+    // unproject the corners of the view volume back into mesh coordinates
+    glm::mat4 inverse = glm::inverse(projection * view * model);
+    min_xy = glm::dvec2(std::numeric_limits<double>::max());
+    max_xy = glm::dvec2(-std::numeric_limits<double>::max());
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec4 ndc((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f, 1.0f);
+        glm::vec4 p = inverse * ndc;
+        glm::dvec2 xy(p.x / p.w, p.y / p.w);
+        min_xy = glm::min(min_xy, xy);
+        max_xy = glm::max(max_xy, xy);
+    }
+}
+
+// draw the tiles whose xy bounds overlap the part of the mesh on screen, their
+// surfaces are built by the loader thread and uploaded a slice at a time
+void update_visible_tiles()
+{
+    glm::dvec2 min_xy, max_xy;
+    view_xy_bounds(min_xy, max_xy);
+
+    std::vector<size_t> load, release;
+    tiled_data->update_residency(min_xy, max_xy, load, release);
+    for (size_t i : release)
+        tile_surfaces.erase(i);
+    for (size_t i : load)
+        mesh_loader->request_tile(i, tiled_data->tile(i).filename);
+
+    // tiles are never updated, so their CPU copies are of no use once uploaded
+    for (MeshLoader::TileResult& result : mesh_loader->take_tiles())
+    {
+        if (!result.loaded)
+        {
+            tiled_data->tile_loaded(result.index, 0);
+            continue;
+        }
+        auto surface = std::make_unique<DrawItem>(std::move(result.surface), UPLOAD_BYTES_PER_FRAME);
+        surface->setReleaseStaging(true);
+        tiled_data->tile_loaded(result.index, surface->footprint().gpu);
+        tile_surfaces[result.index] = std::move(surface);
+    }
+    for (auto& [i, surface] : tile_surfaces)
+    {
+        if (!surface->isUploaded())
+        {
+            surface->upload(UPLOAD_BYTES_PER_FRAME);
+            break;
+        }
+    }
+}
+
+// pick up finished background loads and upload them a slice at a time, the
+// current mesh keeps being drawn until the new surface is completely uploaded
+void update_loading(GLFWwindow* window)
+{
+    MeshLoader::Result result;
+    if (mesh_loader->take_result(result) && result.attributes_only)
+    {
+        // the file has the mesh on screen with new values, nothing needs to be rebuilt
+        if (result.topology_hash != current_topology())
+        {
+            mesh_loader->request(result.filename); // the mesh changed while the file was read
+            return;
+        }
+        loaded_mesh = nullptr;
+        loaded_surface = nullptr;
+        mesh_data->set_vertex_attributes(result.vertex_values);
+        mesh_data->attributes() = result.attributes;
+        mesh_surface->updateAttributes(result.surface.attribute_data);
+        loading_title.clear();
+        show_new_dataset(window, result.filename.c_str(), true);
+        start_time_series(result.filename);
+        return;
+    }
+    else if (result.mesh)
+    {
+        loaded_filename = result.filename;
+        loaded_mesh = std::move(result.mesh);
+        loaded_surface = std::make_unique<DrawItem>(std::move(result.surface), UPLOAD_BYTES_PER_FRAME);
+    }
+    else if (loaded_surface)
+    {
+        loaded_surface->upload(UPLOAD_BYTES_PER_FRAME);
+    }
+
+    if (loaded_surface && loaded_surface->isUploaded())
+    {
+        tiled_data = nullptr;
+        tile_surfaces.clear();
+        mesh_loader->clear_tiles();
+        mesh_data = std::move(loaded_mesh);
+        mesh_surface = std::move(loaded_surface);
+        mesh_surface->footprint().print(std::cout, "Surface");
+        loading_title.clear();
+        show_new_dataset(window, loaded_filename.c_str());
+        start_time_series(loaded_filename);
+        return;
+    }
+
+    // show loading progress in the window title
+    std::string filename, stage;
+    double fraction = 0.0;
+    std::string title;
+    if (mesh_loader->progress(filename, stage, fraction))
+        title = "Scientific Visualization - loading " + filename + " (" + stage + ", " +
+            std::to_string(static_cast<int>(fraction * 100.0)) + "%)";
+    else if (loaded_surface)
+        title = "Scientific Visualization - uploading " + loaded_filename;
+    if (title != loading_title)
+        glfwSetWindowTitle(window, title.empty() ? window_title.c_str() : title.c_str());
+    loading_title = title;
+}
+
+// the topology hash of the mesh on screen, a dropped file with the same hash only replaces its values
+uint64_t current_topology()
+{
+    return (mesh_data && mesh_surface) ? mesh_data->topology_hash() : 0;
+}
+
+void open_time_series(const std::vector<std::string>& filenames)
+{
+    if (filenames.empty())
+    {
+        std::cout << "No files found for the time series" << std::endl;
+        return;
+    }
+    pending_series = filenames;
+    mesh_loader->request(filenames[0], current_topology());
+}
+
+// start decoding the rest of a series once its first frame is up, any other file ends the series
+void start_time_series(const std::string& filename)
+{
+    time_series = nullptr;
+    series_frame = nullptr;
+    if (!pending_series.empty() && pending_series[0] == filename)
+        time_series = std::make_unique<TimeSeries>(pending_series, mesh_data->num_vertices());
+    pending_series.clear();
+}
+
+// show the next frame when it is due and decoded, only the surface attribute buffer is re-uploaded
+void update_time_series(GLFWwindow* window)
+{
+    if (!time_series || !mesh_surface)
+        return;
+
+    std::shared_ptr<const TimeSeries::Frame> frame = time_series->update(glfwGetTime());
+    if (!frame)
+        return;
+
+    mesh_surface->updateAttributes(frame->attributes);
+    series_frame = frame;
+
+    // the mesh itself only follows along while paused, it is too slow to update at playback rate
+    if (!time_series->playing())
+        mesh_data->set_vertex_attributes(frame->values);
+
+    std::string title = window_title + " [frame " + std::to_string(frame->index + 1) + "/" +
+        std::to_string(time_series->num_frames()) + "]";
+    glfwSetWindowTitle(window, title.c_str());
+}
+
+// stop playback and bring the mesh values in line with the frame on screen
+void pause_time_series()
+{
+    if (!time_series || !time_series->playing())
+        return;
+    time_series->set_playing(false);
+    if (series_frame && mesh_data)
+        mesh_data->set_vertex_attributes(series_frame->values);
 }
 
 void load_shaders(){
@@ -319,6 +609,8 @@ void update_shaders() {
     double max_scalar = 1.0;
     if (mesh_data)
         mesh_data->get_min_max_scalar(min_scalar, max_scalar);
+    else if (tiled_data)
+        tiled_data->get_min_max_scalar(min_scalar, max_scalar);
     surfaceShader->use();
     surfaceShader->setFloat("minScalar", static_cast<float>(min_scalar));
     surfaceShader->setFloat("maxScalar", static_cast<float>(max_scalar));
@@ -329,6 +621,8 @@ void update_shaders() {
    
     if (mesh_data)
         mesh_data->get_min_max_coords(min_x, max_x, min_y, max_y, min_z, max_z);
+    else if (tiled_data)
+        tiled_data->get_min_max_coords(min_x, max_x, min_y, max_y, min_z, max_z);
     surfaceShader->setFloat("minX", static_cast<float>(min_x));
     surfaceShader->setFloat("maxX", static_cast<float>(max_x));
     surfaceShader->setFloat("minY", static_cast<float>(min_y));
@@ -336,6 +630,15 @@ void update_shaders() {
 
 }
 
+// the height field is displaced in the vertex shaders, so showing or scaling it only
+// changes these uniforms
+void set_height_uniforms(const Shader& shader, bool shown)
+{
+    shader.setFloat("heightFactor", shown ? height_factor : 0.0f);
+    shader.setFloat("heightMinScalar", height_scalar_range.x);
+    shader.setFloat("heightMaxScalar", height_scalar_range.y);
+}
+
 void load_textures() {
     // generate white/black noise texture
     // settings for the texture
@@ -406,8 +709,18 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 // to be called when a key is pressed or released
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) 
 {
-    if (action != GLFW_PRESS)
+    // the arrow keys repeat so holding them scrubs through a time series, and the
+    // bracket keys so holding them sweeps the height factor
+    if (action == GLFW_RELEASE)
+        return;
+    if (action == GLFW_REPEAT && key != GLFW_KEY_LEFT && key != GLFW_KEY_RIGHT &&
+        key != GLFW_KEY_LEFT_BRACKET && key != GLFW_KEY_RIGHT_BRACKET)
         return;
+
+    // contours and streamlines are computed from the mesh values of the frame on screen,
+    // heights are displaced by the shaders and follow the frames as they play
+    if (key == GLFW_KEY_T || key == GLFW_KEY_S)
+        pause_time_series();
     
     switch (key) {
         case GLFW_KEY_ESCAPE:
@@ -438,7 +751,7 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         case GLFW_KEY_S:
             // toggle on the streamline drawing
             draw_streamlines = !draw_streamlines;
-            if (draw_streamlines && mesh_data)
+            if (draw_streamlines && (mesh_data || tiled_data))
             {
                 // get a streamine step size and number of steps from the user
                 std::cout << "Enter a streamline step size (0.0 to 1.0): ";
@@ -449,15 +762,25 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
                 std::cin >> num_steps;
 
                 // scale the step size based on the mesh grid spacing
-                double grid_spacing = mesh_data->get_grid_spacing();
+                double grid_spacing = mesh_data ? mesh_data->get_grid_spacing() : tiled_data->get_grid_spacing();
                 step_size = step_size * grid_spacing;
 
                 // set the tube radius based on the mesh grid spacing as well
                 float tube_radius = static_cast<float>(grid_spacing) * 0.02f;
 
-                // generate streamlines and create drawable tubes
-                stream_data = std::make_unique<QuadMesh>(*mesh_data, step_size, num_steps);
+                // generate streamlines and create drawable tubes, a tiled mesh is
+                // seeded over the part on screen and loads the tiles the lines cross
+                if (mesh_data)
+                    stream_data = std::make_unique<QuadMesh>(*mesh_data, step_size, num_steps);
+                else
+                {
+                    glm::dvec2 min_xy, max_xy;
+                    view_xy_bounds(min_xy, max_xy);
+                    stream_data = tiled_data->compute_xy_streamlines(min_xy, max_xy,
+                        TILED_STREAMLINE_SEEDS, TILED_STREAMLINE_SEEDS, step_size, num_steps);
+                }
                 stream_tubes = std::make_unique<DrawItem>(*stream_data, DrawItem::DrawMode::Wireframe, 4, tube_radius);
+                stream_tubes->setReleaseStaging(true);
             }
             else
             {
@@ -467,31 +790,56 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
             }
             break;
         case GLFW_KEY_H:
-            // set the mesh vertex heights based on their scalar values
-            if (!mesh_data) // if there is no mesh data, do nothing
+            // raise the surface by its scalar values, the vertex shaders displace the vertices
+            if (!mesh_data || !mesh_surface) // if there is no mesh data, do nothing
                 break;
             toggle_height = !toggle_height;
             if (toggle_height)
             {
-                // get a height factor from the user and use it to set the vertex heights for the mesh_data object
+                // get a height factor from the user, the scalar range on screen now is the range of heights
                 std::cout << "Enter a height factor (e.g. 0.1 to 10.0): ";
-                float height_factor;
                 std::cin >> height_factor;
-                mesh_data->set_height_from_scalar(height_factor);
-            }
-            else
-            {
-                // reset the vertex positions for the mesh_data object
-                mesh_data->reset_vertex_positions();
+                double min_scalar, max_scalar;
+                mesh_data->get_min_max_scalar(min_scalar, max_scalar);
+                height_scalar_range = glm::vec2(min_scalar, max_scalar);
             }
-            // reconstruct the drawable surface
-            mesh_surface = std::make_unique<DrawItem>(*mesh_data, DrawItem::DrawMode::Surface);
+            break;
+        case GLFW_KEY_LEFT_BRACKET:
+        case GLFW_KEY_RIGHT_BRACKET:
+            // scale the height field while it is shown, only a uniform changes
+            if (toggle_height)
+                height_factor *= (key == GLFW_KEY_RIGHT_BRACKET ? 1.25f : 0.8f);
             break;
         case GLFW_KEY_C:
             // cycle through color schemes
             color_scheme = (color_scheme + 1) % 6;
             update_shaders();
             break;
+        case GLFW_KEY_SPACE:
+            // play or pause a time series
+            if (!time_series)
+                break;
+            if (time_series->playing())
+                pause_time_series();
+            else
+                time_series->set_playing(true);
+            break;
+        case GLFW_KEY_LEFT:
+        case GLFW_KEY_RIGHT:
+            // step through a time series one frame at a time
+            if (!time_series)
+                break;
+            pause_time_series();
+            time_series->seek(time_series->position() + (key == GLFW_KEY_RIGHT ? 1 : time_series->num_frames() - 1));
+            break;
+        case GLFW_KEY_UP:
+        case GLFW_KEY_DOWN:
+            // change the playback rate of a time series
+            if (!time_series)
+                break;
+            time_series->set_frame_rate(time_series->frame_rate() * (key == GLFW_KEY_UP ? 1.25 : 0.8));
+            std::cout << "Time series playback at " << time_series->frame_rate() << " frames per second" << std::endl;
+            break;
     default:
         break;
     }
@@ -564,35 +912,76 @@ void drop_callback(GLFWwindow* window, int count, const char** paths){
         return;
     }
 
+    // several files dropped together are played back as a time series
+    if (count > 1)
+    {
+        std::vector<std::string> filenames(paths, paths + count);
+        TimeSeries::sort_filenames(filenames);
+        open_time_series(filenames);
+        return;
+    }
+
+    // .ply files are loaded in the background, see update_loading
+    std::string path = paths[0];
+    pending_series.clear();
+    if (path.size() <= 6 || path.compare(path.size() - 6, 6, ".tiles") != 0)
+    {
+        mesh_loader->request(path, current_topology());
+        return;
+    }
+
+    // a .tiles index opens the mesh out of core, its tiles load as they come into view
+    time_series = nullptr;
+    series_frame = nullptr;
+    mesh_data = nullptr;
+    mesh_surface = nullptr;
+    tile_surfaces.clear();
+    mesh_loader->clear_tiles();
+    tiled_data = std::make_unique<TiledMesh>(paths[0]);
+    show_new_dataset(window, paths[0]);
+}
+
+// reset the view and drawing state after a new dataset has replaced the old one
+// when same_mesh is set only the values changed, so the view and coloring are kept
+void show_new_dataset(GLFWwindow* window, const char* filename, bool same_mesh)
+{
     // update shaders with new scalar range
-    color_scheme = 0; // reset to solid color
+    if (!same_mesh)
+        color_scheme = 0; // reset to solid color
     update_shaders();
-    
-    // load in mesh file
-    mesh_data = std::make_unique<QuadMesh>(paths[0]);
-
-    // create a drawable surface from the mesh
-    mesh_surface = std::make_unique<DrawItem>(*mesh_data, DrawItem::DrawMode::Surface);
 
     // clear out streamline data
     stream_data = nullptr;
     stream_tubes = nullptr;
     draw_streamlines = false;
 
-    // reset transformations
-    ZOOM = 1.0;
-    ROTATION = glm::mat4(1.0f);
-    translating = false;
-    rotating = false;
     // un-toggle height feild
     toggle_height = false;
-    toggle_contours = false;
+
+    if (same_mesh && toggle_contours)
+    {
+        double min_scalar, max_scalar;
+        mesh_data->get_min_max_scalar(min_scalar, max_scalar);
+        contourShader->use();
+        contourShader->setFloat("minScalar", static_cast<float>(min_scalar));
+        contourShader->setFloat("maxScalar", static_cast<float>(max_scalar));
+    }
+
+    if (!same_mesh)
+    {
+        // reset transformations
+        ZOOM = 1.0;
+        ROTATION = glm::mat4(1.0f);
+        translating = false;
+        rotating = false;
+        toggle_contours = false;
+    }
 
 
     // update the window
-    std::string title = "Scientific Visualization - ";
-    title += paths[0];
-    glfwSetWindowTitle(window, title.c_str());
+    window_title = "Scientific Visualization - ";
+    window_title += filename;
+    glfwSetWindowTitle(window, window_title.c_str());
     glfwRequestWindowAttention(window);
 
 }
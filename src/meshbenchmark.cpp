@@ -0,0 +1,968 @@
+#include "meshbenchmark.h"
+#include "plyreader.h"
+#include "quadmesh.h"
+#include "structuredgrid.h"
+#include "parallel.h"
+#include <glm/common.hpp>
+#include <iostream>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Layout Benchmark
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+// set associative cache with LRU replacement, counts the misses of the addresses it is given
+class SimulatedCache
+{
+private:
+
+    static const size_t LINE_BYTES = 64;
+    static const size_t WAYS = 8;
+    static const size_t SETS = 32 * 1024 / (LINE_BYTES * WAYS);
+
+    std::vector<uint64_t> m_tags = std::vector<uint64_t>(SETS * WAYS, UINT64_MAX); // most recent first
+    size_t m_misses = 0;
+
+public:
+
+    void access(const void* address)
+    {
+        uint64_t line = reinterpret_cast<uintptr_t>(address) / LINE_BYTES;
+        uint64_t* set = &m_tags[(line % SETS) * WAYS];
+        size_t way = 0;
+        while (way < WAYS && set[way] != line)
+            way++;
+        if (way == WAYS)
+        {
+            m_misses++;
+            way = WAYS - 1;
+        }
+        for (; way > 0; way--)
+            set[way] = set[way - 1];
+        set[0] = line;
+    }
+
+    size_t misses() const { return m_misses; }
+};
+
+struct LayoutTimings
+{
+    double load_ms = 0.0;
+    double normals_ms = 0.0;
+    double interpolation_ms = 0.0;
+    double streamlines_ms = 0.0;
+    size_t normal_misses = 0;
+    double checksum = 0.0;
+};
+
+// the checksums end up here, which keeps the timed loops from being optimized away
+static volatile double s_checksum_sink = 0.0;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static LayoutTimings time_layout(const char* filename, MeshLayout layout)
+{
+    LayoutTimings timings;
+    QuadMesh::set_layout(layout);
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<QuadMesh> mesh = std::make_unique<QuadMesh>(filename, false);
+    timings.load_ms = elapsed_ms(start);
+    if (mesh->num_faces() == 0)
+        return timings;
+
+    // the face normals, then the vertex normals gathered around each ring
+    const int NORMAL_PASSES = 5;
+    start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < NORMAL_PASSES; pass++)
+    {
+        mesh->compute_face_normals();
+        mesh->average_vertex_normals();
+    }
+    timings.normals_ms = elapsed_ms(start) / NORMAL_PASSES;
+
+    // the same fetches as the face normal loop, through the simulated cache
+    const HalfEdgeMesh& m = mesh->half_edge_mesh();
+    SimulatedCache cache;
+    m.geometry([&](const auto& g)
+    {
+        for (size_t f = 0; f < m.num_faces(); f++)
+        {
+            for (int k = 0; k < 3; k++)
+                cache.access(&g.positions[m.half_vertex[4 * f + k]]);
+            cache.access(&g.face_normals[f]);
+        }
+    });
+    timings.normal_misses = cache.misses();
+
+    // the vector field at the centroid of every face
+    start = std::chrono::steady_clock::now();
+    for (const Face face : mesh->faces())
+        timings.checksum += face.bilinear_interpolate_xy_vector(face.centroid()).x;
+    timings.interpolation_ms = elapsed_ms(start);
+
+    // streamlines from up to 1000 faces spread over the file's face list, picked
+    // by file id so both layouts trace the same streamlines
+    const size_t num_faces = mesh->num_faces();
+    std::vector<uint32_t> face_of_id(num_faces);
+    for (const Face face : mesh->faces())
+        face_of_id[face.id()] = face.index();
+    const size_t stride = std::max<size_t>(1, num_faces / 1000);
+    const double step = 0.1 * mesh->get_grid_spacing();
+    std::vector<glm::dvec3> streamline;
+    start = std::chrono::steady_clock::now();
+    for (size_t id = 0; id < num_faces; id += stride)
+    {
+        mesh->compute_face_xy_streamline(streamline, face_of_id[id], step, 100);
+        timings.checksum += static_cast<double>(streamline.size());
+    }
+    timings.streamlines_ms = elapsed_ms(start);
+    s_checksum_sink = s_checksum_sink + timings.checksum;
+    return timings;
+}
+
+bool run_layout_benchmark(const char* filename)
+{
+    // the cache would hand back whichever layout was written last
+    const bool cache_enabled = QuadMesh::cache_enabled();
+    QuadMesh::set_cache_enabled(false);
+    LayoutTimings file_order = time_layout(filename, MeshLayout::FileOrder);
+    LayoutTimings morton = time_layout(filename, MeshLayout::Morton);
+    QuadMesh::set_layout(MeshLayout::FileOrder);
+    QuadMesh::set_cache_enabled(cache_enabled);
+    if (file_order.normal_misses == 0)
+    {
+        std::cout << "Could not benchmark " << filename << ", it has no faces" << std::endl;
+        return false;
+    }
+
+    auto row = [](const char* name, double before, double after)
+    {
+        double change = (before > 0.0) ? 100.0 * (after - before) / before : 0.0;
+        std::printf("%-28s %12.2f %12.2f %+8.1f%%\n", name, before, after, change);
+    };
+    std::cout << "Layout benchmark for " << filename << std::endl;
+    std::printf("%-28s %12s %12s %9s\n", "", "file order", "morton", "change");
+    row("load (ms)", file_order.load_ms, morton.load_ms);
+    row("normals (ms)", file_order.normals_ms, morton.normals_ms);
+    row("interpolation (ms)", file_order.interpolation_ms, morton.interpolation_ms);
+    row("streamlines (ms)", file_order.streamlines_ms, morton.streamlines_ms);
+    row("simulated L1 misses", static_cast<double>(file_order.normal_misses), static_cast<double>(morton.normal_misses));
+    return true;
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Locator Benchmark
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+// a side x side grid of unit quads in float, with the inner vertices moved by up to
+// 0.3 in x and y so the faces are irregular but still convex
+static PlyData synthetic_grid(size_t num_faces)
+{
+    const size_t side = std::max<size_t>(1, static_cast<size_t>(std::sqrt(static_cast<double>(num_faces))));
+    const size_t n = side + 1;
+    PlyData ply;
+    ply.num_vertices = n * n;
+    ply.slot_type = AttributeType::Float32;
+    ply.vertex_values.assign(ply.num_vertices * NUM_VERTEX_SLOTS, 0.0);
+    std::mt19937_64 random(1);
+    std::uniform_real_distribution<double> jitter(-0.3, 0.3);
+    for (size_t j = 0; j < n; j++)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            const bool inner = i > 0 && j > 0 && i < side && j < side;
+            double* a = &ply.vertex_values[(i + j * n) * NUM_VERTEX_SLOTS];
+            a[SLOT_X] = static_cast<double>(i) + (inner ? jitter(random) : 0.0);
+            a[SLOT_Y] = static_cast<double>(j) + (inner ? jitter(random) : 0.0);
+            a[SLOT_NZ] = 1.0;
+            a[SLOT_S] = a[SLOT_X];
+            a[SLOT_VX] = 1.0;
+        }
+    }
+    ply.face_indices.reserve(4 * side * side);
+    ply.face_ids.reserve(side * side);
+    for (size_t j = 0; j < side; j++)
+    {
+        for (size_t i = 0; i < side; i++)
+        {
+            const unsigned int v = static_cast<unsigned int>(i + j * n);
+            ply.face_indices.insert(ply.face_indices.end(), { v, v + 1, v + 1 + static_cast<unsigned int>(n), v + static_cast<unsigned int>(n) });
+            ply.face_ids.push_back(static_cast<unsigned int>(ply.face_ids.size()));
+        }
+    }
+    return ply;
+}
+
+// random points over the mesh's bounds, located with the grid and with a scan of every
+// face, the scan only for as many points as take a few seconds and timed per point
+static bool time_locator(const char* name, const QuadMesh& mesh)
+{
+    const size_t num_faces = mesh.num_faces();
+    if (num_faces == 0)
+    {
+        std::cout << "Could not benchmark " << name << ", it has no faces" << std::endl;
+        return false;
+    }
+    const MeshStatistics stats = mesh.statistics();
+    const size_t NUM_QUERIES = 1000000;
+    std::vector<glm::dvec3> points(NUM_QUERIES);
+    std::mt19937_64 random(2);
+    std::uniform_real_distribution<double> x(stats.min_position.x, stats.max_position.x);
+    std::uniform_real_distribution<double> y(stats.min_position.y, stats.max_position.y);
+    for (glm::dvec3& point : points)
+        point = glm::dvec3(x(random), y(random), 0.0);
+
+    // each index on its own, the same queries get_face_containing_xy_point makes of it
+    const HalfEdgeMesh& m = mesh.half_edge_mesh();
+    auto start = std::chrono::steady_clock::now();
+    const FaceGrid& grid = mesh.face_grid();
+    const double grid_build_ms = elapsed_ms(start);
+    std::vector<uint32_t> grid_found(NUM_QUERIES, HalfEdgeMesh::INVALID);
+    start = std::chrono::steady_clock::now();
+    for (size_t q = 0; q < NUM_QUERIES; q++)
+    {
+        std::pair<const uint32_t*, const uint32_t*> candidates = grid.candidates(points[q]);
+        for (const uint32_t* f = candidates.first; f != candidates.second; f++)
+        {
+            if (Face(&m, *f).contains_xy_point(points[q]))
+            {
+                grid_found[q] = *f;
+                break;
+            }
+        }
+    }
+    const double grid_ms = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    const FaceBVH& bvh = mesh.face_bvh();
+    const double bvh_build_ms = elapsed_ms(start);
+    std::vector<uint32_t> bvh_found(NUM_QUERIES, HalfEdgeMesh::INVALID);
+    start = std::chrono::steady_clock::now();
+    for (size_t q = 0; q < NUM_QUERIES; q++)
+    {
+        bvh.for_each_face_at(glm::dvec2(points[q]), [&](uint32_t f)
+        {
+            if (f < bvh_found[q] && Face(&m, f).contains_xy_point(points[q]))
+                bvh_found[q] = f;
+        });
+    }
+    const double bvh_ms = elapsed_ms(start);
+
+    const size_t num_scanned = std::min(NUM_QUERIES, std::max<size_t>(10, 200000000 / num_faces));
+    size_t mismatches = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t q = 0; q < num_scanned; q++)
+    {
+        Face face = mesh.scan_for_face_containing_xy_point(points[q]);
+        uint32_t f = face ? face.index() : HalfEdgeMesh::INVALID;
+        mismatches += (f != grid_found[q] || f != bvh_found[q]) ? 1 : 0;
+    }
+    const double scan_ms = elapsed_ms(start);
+    size_t hits = 0;
+    for (size_t q = 0; q < NUM_QUERIES; q++)
+    {
+        hits += (grid_found[q] != HalfEdgeMesh::INVALID) ? 1 : 0;
+        mismatches += (grid_found[q] != bvh_found[q]) ? 1 : 0;
+    }
+    s_checksum_sink = s_checksum_sink + static_cast<double>(hits);
+
+    const double grid_us = 1000.0 * grid_ms / NUM_QUERIES;
+    const double bvh_us = 1000.0 * bvh_ms / NUM_QUERIES;
+    const double scan_us = 1000.0 * scan_ms / num_scanned;
+    auto row = [](const char* label, double a, double b)
+    {
+        std::printf("%-28s %12.3f %12.3f\n", label, a, b);
+    };
+    std::cout << "Locator benchmark for " << name << ", " << num_faces << " faces, "
+              << NUM_QUERIES << " points of which " << hits << " inside a face" << std::endl;
+    std::printf("%-28s %12s %12s\n", "", "grid", "bvh");
+    row("build (ms)", grid_build_ms, bvh_build_ms);
+    row("memory (MB)", grid.memory_bytes() / (1024.0 * 1024.0), bvh.memory_bytes() / (1024.0 * 1024.0));
+    row("us per point", grid_us, bvh_us);
+    row("speedup over the scan", grid_us > 0.0 ? scan_us / grid_us : 0.0, bvh_us > 0.0 ? scan_us / bvh_us : 0.0);
+    std::printf("%-28s %12.3f   (%zu points)\n", "scan (us per point)", scan_us, num_scanned);
+    std::cout << grid.nx() << " x " << grid.ny() << " buckets, " << bvh.nodes().size() << " nodes "
+              << bvh.depth() << " deep, get_face_containing_xy_point uses the "
+              << (mesh.locates_with_face_grid() ? "grid" : "bvh") << std::endl;
+    if (mismatches > 0)
+        std::cout << "The grid, the bvh and the scan disagree on " << mismatches << " points" << std::endl;
+
+    // a path of points a quarter of an edge apart, like a probe dragged over the mesh,
+    // turning a little at each one and back at the boundary, located by walking from
+    // the last face and looked up
+    const double step = 0.25 * stats.mean_edge_length;
+    std::uniform_real_distribution<double> turn(-0.5, 0.5);
+    glm::dvec3 pos = Face(&m, 0).centroid();
+    double heading = 0.0;
+    for (glm::dvec3& point : points)
+    {
+        heading += turn(random);
+        glm::dvec3 next = pos + step * glm::dvec3(std::cos(heading), std::sin(heading), 0.0);
+        if (!mesh.get_face_containing_xy_point(next))
+        {
+            heading += 3.14159265358979;
+            next = pos;
+        }
+        pos = point = next;
+    }
+    std::vector<Face> walk_found(NUM_QUERIES);
+    size_t steps = 0, fallbacks = 0, max_steps = 0;
+    Face hint = nullptr;
+    start = std::chrono::steady_clock::now();
+    for (size_t q = 0; q < NUM_QUERIES; q++)
+    {
+        Location location = mesh.locate(points[q], hint);
+        walk_found[q] = location.face;
+        steps += location.steps;
+        max_steps = std::max<size_t>(max_steps, location.steps);
+        fallbacks += location.used_index ? 1 : 0;
+        if (location.face)
+            hint = location.face;
+    }
+    const double walk_ms = elapsed_ms(start);
+    size_t walk_mismatches = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t q = 0; q < NUM_QUERIES; q++)
+        walk_mismatches += (mesh.get_face_containing_xy_point(points[q]) != walk_found[q]) ? 1 : 0;
+    const double lookup_ms = elapsed_ms(start);
+    std::printf("%-28s %12s %12s\n", "path", "walk", "lookup");
+    row("us per point", 1000.0 * walk_ms / NUM_QUERIES, 1000.0 * lookup_ms / NUM_QUERIES);
+    std::cout << "walks cross " << static_cast<double>(steps) / NUM_QUERIES << " edges per point and at most "
+              << max_steps << ", " << fallbacks << " points looked up instead" << std::endl;
+    if (walk_mismatches > 0)
+        std::cout << "The walk and the lookup disagree on " << walk_mismatches << " points" << std::endl;
+    return mismatches == 0 && walk_mismatches == 0;
+}
+
+bool run_locator_benchmark(const char* filename, size_t synthetic_faces)
+{
+    const bool cache_enabled = QuadMesh::cache_enabled();
+    QuadMesh::set_cache_enabled(false);
+    bool ok;
+    {
+        QuadMesh mesh(filename, false);
+        ok = time_locator(filename, mesh);
+    }
+    if (synthetic_faces > 0)
+    {
+        // the file contents are only needed while the mesh is built
+        std::unique_ptr<QuadMesh> mesh;
+        {
+            PlyData ply = synthetic_grid(synthetic_faces);
+            mesh = std::make_unique<QuadMesh>("synthetic grid", ply, false);
+        }
+        ok = time_locator("synthetic grid", *mesh) && ok;
+    }
+    QuadMesh::set_cache_enabled(cache_enabled);
+    return ok;
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Sampling Benchmark
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+// side x side points over the bounds of a mesh, row by row, as resampling makes them
+static std::vector<glm::dvec3> raster_points(const MeshStatistics& stats, size_t side)
+{
+    const glm::dvec3 size = stats.max_position - stats.min_position;
+    std::vector<glm::dvec3> raster(side * side);
+    for (size_t j = 0; j < side; j++)
+    {
+        for (size_t i = 0; i < side; i++)
+        {
+            raster[i + j * side] = glm::dvec3(stats.min_position.x + size.x * (i + 0.5) / side,
+                                              stats.min_position.y + size.y * (j + 0.5) / side, 0.0);
+        }
+    }
+    return raster;
+}
+
+// the interpolation Face::bilinear_interpolate_xy_vector made before it inverted the
+// bilinear map, over the x-y box of the quad with the corners matched to the box
+// corners, which only holds for axis aligned quads; a corner left unmatched counts as 0
+template <typename Function>
+static glm::dvec3 box_interpolate(const HalfEdgeMesh& m, uint32_t f, const glm::dvec3& point, Function value)
+{
+    const uint32_t* corners = &m.half_vertex[4 * size_t(f)];
+    glm::dvec3 positions[4];
+    for (int k = 0; k < 4; k++)
+        positions[k] = m.position(corners[k]);
+    double x1 = positions[0].x, x2 = positions[0].x, y1 = positions[0].y, y2 = positions[0].y;
+    for (int k = 1; k < 4; k++)
+    {
+        x1 = std::min(x1, positions[k].x);
+        x2 = std::max(x2, positions[k].x);
+        y1 = std::min(y1, positions[k].y);
+        y2 = std::max(y2, positions[k].y);
+    }
+    glm::dvec3 v11(0.0), v12(0.0), v21(0.0), v22(0.0);
+    for (int k = 0; k < 4; k++)
+    {
+        const glm::dvec3& pos = positions[k];
+        if (pos.x == x1 && pos.y == y1) v11 = value(corners[k]);
+        else if (pos.x == x1 && pos.y == y2) v12 = value(corners[k]);
+        else if (pos.x == x2 && pos.y == y1) v21 = value(corners[k]);
+        else if (pos.x == x2 && pos.y == y2) v22 = value(corners[k]);
+    }
+    const double x = point.x, y = point.y;
+    return ((x2 - x) * (y2 - y) * v11 + (x2 - x) * (y - y1) * v12 +
+            (x - x1) * (y2 - y) * v21 + (x - x1) * (y - y1) * v22) / ((x2 - x1) * (y2 - y1));
+}
+
+// the vectors at the raster points inside faces of mesh, with the box interpolation,
+// with the inverse bilinear map worked out from the corners each time and with the map
+// from the coefficient table, timed apart from the lookup. Interpolating the corner
+// positions has to give the points back, as the map is bilinear, which measures the
+// accuracy of each way.
+static void time_interpolation(const char* name, const QuadMesh& mesh, const std::vector<glm::dvec3>& raster)
+{
+    const HalfEdgeMesh& m = mesh.half_edge_mesh();
+    const FaceInterpolation& table = mesh.face_interpolation();
+    std::vector<glm::dvec3> points;
+    std::vector<Face> faces;
+    for (const glm::dvec3& point : raster)
+    {
+        Face face = mesh.get_face_containing_xy_point(point);
+        if (face)
+        {
+            points.push_back(point);
+            faces.push_back(face);
+        }
+    }
+    const size_t n = points.size();
+    if (n == 0)
+        return;
+
+    struct Way { const char* label; double ms; double position_error; double difference; };
+    auto vector = [&](uint32_t v) { return m.vector(v); };
+    auto position = [&](uint32_t v) { return m.position(v); };
+    auto table_vector = [&](size_t i)
+    {
+        glm::dvec3 vxy = table.interpolate<glm::dvec3>(faces[i].index(), points[i], vector);
+        return glm::dvec3(vxy.x, vxy.y, 0.0);
+    };
+    auto box_vector = [&](size_t i)
+    {
+        glm::dvec3 vxy = box_interpolate(m, faces[i].index(), points[i], vector);
+        return glm::dvec3(vxy.x, vxy.y, 0.0);
+    };
+    std::vector<glm::dvec3> box(n), values(n);
+    Way ways[3] = { { "box (before)", 0.0, 0.0, 0.0 }, { "inverse bilinear", 0.0, 0.0, 0.0 }, { "table", 0.0, 0.0, 0.0 } };
+    for (int way = 0; way < 3; way++)
+    {
+        std::vector<glm::dvec3>& out = (way == 0) ? box : values;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; i++)
+            out[i] = (way == 0) ? box_vector(i) : (way == 1) ? faces[i].bilinear_interpolate_xy_vector(points[i]) : table_vector(i);
+        ways[way].ms = elapsed_ms(start);
+
+        for (size_t i = 0; i < n; i++)
+        {
+            const glm::dvec3 p = (way == 0) ? box_interpolate(m, faces[i].index(), points[i], position) :
+                table.interpolate<glm::dvec3>(faces[i].index(), points[i], position);
+            ways[way].position_error = std::max(ways[way].position_error, glm::length(glm::dvec2(p - points[i])));
+            const glm::dvec3 d = glm::abs(out[i] - box[i]);
+            ways[way].difference = std::max(ways[way].difference, std::max(d.x, std::max(d.y, d.z)));
+        }
+    }
+
+    const double edge = mesh.statistics().mean_edge_length;
+    std::cout << "Interpolation in " << name << ", " << mesh.num_faces() << " faces, " << n
+              << " points inside a face, errors in mean edge lengths" << std::endl;
+    std::printf("%-28s %14s %14s %14s\n", "", "M/s", "position error", "diff from box");
+    for (const Way& way : ways)
+    {
+        std::printf("%-28s %14.2f %14.3g %14.3g\n", way.label, n / (1000.0 * way.ms),
+                    way.position_error / edge, way.difference);
+    }
+}
+
+struct SamplingTimings
+{
+    double point_ms = 0.0;
+    double batch_ms = 0.0;
+    double max_difference = 0.0; // largest difference between the two, NaN against NaN counts as none
+};
+
+// vectors at points, one at a time with point(p) and all at once with mesh.sample
+template <typename Function>
+static SamplingTimings time_sampling(const FieldMesh& mesh, const std::vector<glm::dvec3>& points, Function point)
+{
+    SamplingTimings timings;
+    std::vector<glm::dvec3> one_by_one(points.size());
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < points.size(); i++)
+        one_by_one[i] = point(points[i]);
+    timings.point_ms = elapsed_ms(start);
+
+    std::vector<glm::dvec3> batched(points.size());
+    FieldSamples out;
+    out.vectors = batched.data();
+    start = std::chrono::steady_clock::now();
+    mesh.sample(points.data(), points.size(), out);
+    timings.batch_ms = elapsed_ms(start);
+
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        // a point found by one and not the other is an infinite difference
+        const bool outside = std::isnan(one_by_one[i].x), batch_outside = std::isnan(batched[i].x);
+        const glm::dvec3 d = glm::abs(one_by_one[i] - batched[i]);
+        const double difference = (outside != batch_outside) ? std::numeric_limits<double>::infinity() :
+            outside ? 0.0 : std::max(d.x, std::max(d.y, d.z));
+        timings.max_difference = std::max(timings.max_difference, difference);
+    }
+    return timings;
+}
+
+bool run_sampling_benchmark(const char* filename)
+{
+    PlyData ply;
+    if (!read_ply_file(filename, ply))
+    {
+        std::cout << "Could not read " << filename << std::endl;
+        return false;
+    }
+    const bool cache_enabled = QuadMesh::cache_enabled();
+    QuadMesh::set_cache_enabled(false);
+    QuadMesh mesh(filename, ply, false);
+    std::unique_ptr<FieldMesh> opened = FieldMesh::open(filename, ply, false);
+    QuadMesh::set_cache_enabled(cache_enabled);
+    if (mesh.num_faces() == 0)
+    {
+        std::cout << "Could not benchmark " << filename << ", it has no faces" << std::endl;
+        return false;
+    }
+
+    // a raster over the bounds, row by row, as resampling makes, and the same number of
+    // random points, as scattered probes make
+    const MeshStatistics stats = mesh.statistics();
+    std::vector<glm::dvec3> raster = raster_points(stats, 1000);
+    std::vector<glm::dvec3> scattered(raster.size());
+    std::mt19937_64 random(3);
+    std::uniform_real_distribution<double> x(stats.min_position.x, stats.max_position.x);
+    std::uniform_real_distribution<double> y(stats.min_position.y, stats.max_position.y);
+    for (glm::dvec3& point : scattered)
+        point = glm::dvec3(x(random), y(random), 0.0);
+
+    // the one point at a time way is a lookup and an interpolation in the face found
+    const glm::dvec3 outside(std::numeric_limits<double>::quiet_NaN());
+    auto mesh_point = [&](const glm::dvec3& p)
+    {
+        Face face = mesh.get_face_containing_xy_point(p);
+        return face ? face.bilinear_interpolate_xy_vector(p) : outside;
+    };
+    const StructuredGrid2D* grid = dynamic_cast<const StructuredGrid2D*>(opened.get());
+    auto grid_point = [&](const glm::dvec3& p)
+    {
+        size_t cell;
+        return grid->locate(p, cell) ? grid->interpolate_xy_vector(p, cell) : outside;
+    };
+
+    // the coefficient table is built on first use, outside the timings
+    auto start = std::chrono::steady_clock::now();
+    const FaceInterpolation& table = mesh.face_interpolation();
+    const double table_ms = elapsed_ms(start);
+    mesh.get_face_containing_xy_point(stats.min_position);
+
+    std::cout << "Sampling benchmark for " << filename << ", " << mesh.num_faces() << " faces, "
+              << raster.size() << " points, vectors only, on " << num_worker_threads() << " threads" << std::endl;
+    std::printf("%-28s %14s %14s %10s %12s\n", "", "point (M/s)", "batch (M/s)", "speedup", "max diff");
+    auto row = [&](const char* label, const SamplingTimings& t)
+    {
+        const double n = static_cast<double>(raster.size());
+        std::printf("%-28s %14.2f %14.2f %10.2f %12.3g\n", label, n / (1000.0 * t.point_ms),
+                    n / (1000.0 * t.batch_ms), t.batch_ms > 0.0 ? t.point_ms / t.batch_ms : 0.0, t.max_difference);
+    };
+    row("QuadMesh raster", time_sampling(mesh, raster, mesh_point));
+    row("QuadMesh scattered", time_sampling(mesh, scattered, mesh_point));
+    if (grid)
+    {
+        row("StructuredGrid2D raster", time_sampling(*grid, raster, grid_point));
+        row("StructuredGrid2D scattered", time_sampling(*grid, scattered, grid_point));
+    }
+    std::cout << "coefficient table: " << table_ms << " ms, " << table.memory_bytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+
+    // the old and new interpolation on the file, then on quads that are not axis aligned
+    time_interpolation(filename, mesh, raster);
+    PlyData irregular = synthetic_grid(1000000);
+    QuadMesh::set_cache_enabled(false);
+    QuadMesh skewed("synthetic grid", irregular, false);
+    QuadMesh::set_cache_enabled(cache_enabled);
+    time_interpolation("synthetic grid", skewed, raster_points(skewed.statistics(), 1000));
+    return true;
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// PLY Benchmark
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+// the ASCII reader read_ply_file replaced, kept as it was apart from storing into PlyData:
+// a std::istringstream for every line and a chain of name compares for every property
+static bool read_ply_istringstream(const char* filename, PlyData& ply)
+{
+    std::ifstream file(filename);
+    std::string line;
+    if (!file || !std::getline(file, line) || line != "ply" ||
+        !std::getline(file, line) || line != "format ascii 1.0")
+        return false;
+
+    size_t num_vertices = 0, num_faces = 0;
+    bool header_done = false;
+    bool reading_vertex_props = false;
+    std::vector<std::string> vertex_props;
+    while (std::getline(file, line))
+    {
+        if (line.find("element vertex") == 0)
+        {
+            std::istringstream iss(line);
+            std::string dummy;
+            iss >> dummy >> dummy >> num_vertices;
+            reading_vertex_props = true;
+        }
+        else if (line.find("property") == 0 && reading_vertex_props)
+        {
+            std::istringstream iss(line);
+            std::string dummy, type, name;
+            iss >> dummy >> type >> name;
+            vertex_props.push_back(name);
+        }
+        else if (line.find("element face") == 0)
+        {
+            std::istringstream iss(line);
+            std::string dummy;
+            iss >> dummy >> dummy >> num_faces;
+            reading_vertex_props = false;
+        }
+        else if (line == "end_header")
+        {
+            header_done = true;
+            break;
+        }
+    }
+    if (!header_done)
+        return false;
+
+    ply.num_vertices = num_vertices;
+    ply.vertex_values.assign(num_vertices * NUM_VERTEX_SLOTS, 0.0);
+    double ignored;
+    for (size_t i = 0; i < num_vertices; ++i)
+    {
+        if (!std::getline(file, line))
+            return false;
+
+        std::istringstream iss(line);
+        double* a = &ply.vertex_values[i * NUM_VERTEX_SLOTS];
+        for (const std::string& prop : vertex_props)
+        {
+            if (prop == "x") iss >> a[SLOT_X];
+            else if (prop == "y") iss >> a[SLOT_Y];
+            else if (prop == "z") iss >> a[SLOT_Z];
+            else if (prop == "nx") iss >> a[SLOT_NX];
+            else if (prop == "ny") iss >> a[SLOT_NY];
+            else if (prop == "nz") iss >> a[SLOT_NZ];
+            else if (prop == "s") iss >> a[SLOT_S];
+            else if (prop == "vx") iss >> a[SLOT_VX];
+            else if (prop == "vy") iss >> a[SLOT_VY];
+            else if (prop == "vz") iss >> a[SLOT_VZ];
+            else if (prop == "t00") iss >> ignored;
+            else if (prop == "t01") iss >> ignored;
+            else if (prop == "t10") iss >> ignored;
+            else if (prop == "t11") iss >> ignored;
+        }
+    }
+
+    for (size_t i = 0; i < num_faces; i++)
+    {
+        if (!std::getline(file, line))
+            return false;
+
+        std::istringstream iss(line);
+        int n;
+        iss >> n;
+        if (n != 4)
+            continue;
+
+        unsigned int verts[4];
+        bool valid = true;
+        for (int j = 0; j < n; j++)
+        {
+            int vid;
+            iss >> vid;
+            if (vid < 0 || static_cast<size_t>(vid) >= num_vertices)
+            {
+                valid = false;
+                break;
+            }
+            verts[j] = static_cast<unsigned int>(vid);
+        }
+        if (valid)
+        {
+            ply.face_indices.insert(ply.face_indices.end(), verts, verts + 4);
+            ply.face_ids.push_back(static_cast<unsigned int>(i));
+        }
+    }
+    return true;
+}
+
+// an ASCII grid of about num_vertices vertices with every slot property, as the
+// simulations write them, the scalar and vector vary so the values have many digits
+static bool write_synthetic_ascii_ply(const std::string& path, size_t num_vertices)
+{
+    const size_t side = std::max<size_t>(2, static_cast<size_t>(std::sqrt(static_cast<double>(num_vertices))));
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    std::fprintf(file, "ply\nformat ascii 1.0\nelement vertex %zu\n", side * side);
+    for (const char* name : { "x", "y", "z", "nx", "ny", "nz", "s", "vx", "vy", "vz" })
+        std::fprintf(file, "property float %s\n", name);
+    std::fprintf(file, "element face %zu\nproperty list uchar int vertex_indices\nend_header\n", (side - 1) * (side - 1));
+    for (size_t j = 0; j < side; j++)
+    {
+        for (size_t i = 0; i < side; i++)
+        {
+            const double x = static_cast<double>(i) / static_cast<double>(side - 1);
+            const double y = static_cast<double>(j) / static_cast<double>(side - 1);
+            std::fprintf(file, "%.7g %.7g 0 0 0 1 %.7g %.7g %.7g 0\n", x, y,
+                std::sin(7.0 * x) * std::cos(5.0 * y), std::cos(3.0 * y), -std::sin(4.0 * x));
+        }
+    }
+    for (size_t j = 0; j + 1 < side; j++)
+    {
+        for (size_t i = 0; i + 1 < side; i++)
+        {
+            const size_t v = i + j * side;
+            std::fprintf(file, "4 %zu %zu %zu %zu\n", v, v + 1, v + 1 + side, v + side);
+        }
+    }
+    return std::fclose(file) == 0;
+}
+
+// both readers on one file, the new one at its best of a few runs since it takes little
+// enough time for the first run to be mostly page faults
+static bool time_ply_readers(const char* label, const char* filename)
+{
+    PlyData old_ply;
+    auto start = std::chrono::steady_clock::now();
+    if (!read_ply_istringstream(filename, old_ply))
+    {
+        std::cout << "Could not benchmark " << filename << ", the old reader only reads ASCII quad meshes" << std::endl;
+        return false;
+    }
+    const double old_ms = elapsed_ms(start);
+
+    PlyData ply;
+    double new_ms = std::numeric_limits<double>::max();
+    for (int run = 0; run < 3; run++)
+    {
+        ply = PlyData();
+        start = std::chrono::steady_clock::now();
+        if (!read_ply_file(filename, ply))
+        {
+            std::cout << "Could not read " << filename << std::endl;
+            return false;
+        }
+        new_ms = std::min(new_ms, elapsed_ms(start));
+    }
+
+    // the same numbers either way, the old reader parses with the same correctly rounded conversion
+    double max_difference = 0.0;
+    for (size_t k = 0; k < std::min(ply.vertex_values.size(), old_ply.vertex_values.size()); k++)
+        max_difference = std::max(max_difference, std::abs(ply.vertex_values[k] - old_ply.vertex_values[k]));
+    const bool same = ply.num_vertices == old_ply.num_vertices && ply.face_indices == old_ply.face_indices &&
+        ply.vertex_values.size() == old_ply.vertex_values.size();
+
+    std::printf("%-32s %10zu %10zu %16.1f %16.1f %9.1fx %10.3g%s\n", label, ply.num_vertices, ply.face_ids.size(),
+                old_ms, new_ms, new_ms > 0.0 ? old_ms / new_ms : 0.0, max_difference, same ? "" : "  (faces differ)");
+    return same;
+}
+
+bool run_ply_benchmark(const char* filename, size_t synthetic_vertices)
+{
+    std::cout << "PLY benchmark, read_ply_file against the istringstream reader it replaced, on "
+              << num_worker_threads() << " threads" << std::endl;
+    std::printf("%-32s %10s %10s %16s %16s %10s %10s\n", "", "vertices", "faces", "istringstream ms",
+                "read_ply_file ms", "speedup", "max diff");
+    bool ok = time_ply_readers(filename, filename);
+
+    if (synthetic_vertices > 0)
+    {
+        std::error_code error;
+        const std::string path = (std::filesystem::temp_directory_path(error) /
+            ("ply_benchmark_" + std::to_string(synthetic_vertices) + ".ply")).string();
+        if (error || !write_synthetic_ascii_ply(path, synthetic_vertices))
+        {
+            std::cout << "Could not write the synthetic file " << path << std::endl;
+            std::filesystem::remove(path, error);
+            return false;
+        }
+        ok = time_ply_readers("synthetic grid", path.c_str()) && ok;
+        std::filesystem::remove(path, error);
+    }
+    return ok;
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Edge Benchmark
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+// the edge construction QuadMesh::set_up_edges replaced, kept as it was apart from
+// working on bare arrays: every half-edge without an edge yet searches the faces
+// around its first vertex for the other half-edges along it
+static void set_up_edges_by_vertex_rings(const std::vector<unsigned int>& half_vertex, size_t nv,
+    std::vector<uint32_t>& half_twin, std::vector<uint32_t>& half_edge, size_t& num_edges)
+{
+    const size_t num_halves = half_vertex.size();
+    half_twin.assign(num_halves, HalfEdgeMesh::INVALID);
+    half_edge.assign(num_halves, HalfEdgeMesh::INVALID);
+    num_edges = 0;
+
+    // the faces around each vertex in face order, as compressed rows
+    std::vector<uint32_t> vertex_face_offsets(nv + 1, 0);
+    for (uint32_t v : half_vertex)
+        vertex_face_offsets[v + 1]++;
+    for (size_t v = 0; v < nv; v++)
+        vertex_face_offsets[v + 1] += vertex_face_offsets[v];
+    std::vector<uint32_t> vertex_faces(num_halves);
+    std::vector<uint32_t> fill(vertex_face_offsets.begin(), vertex_face_offsets.end() - 1);
+    for (size_t h = 0; h < num_halves; h++)
+        vertex_faces[fill[half_vertex[h]]++] = HalfEdgeMesh::face_of(static_cast<uint32_t>(h));
+
+    std::vector<uint32_t> shared;
+    for (uint32_t h = 0; h < num_halves; h++)
+    {
+        if (half_edge[h] != HalfEdgeMesh::INVALID)
+            continue;
+
+        const uint32_t v1 = half_vertex[h];
+        const uint32_t v2 = half_vertex[HalfEdgeMesh::next(h)];
+        const uint32_t edge = static_cast<uint32_t>(num_edges++);
+        half_edge[h] = edge;
+
+        shared.clear();
+        for (uint32_t i = vertex_face_offsets[v1]; i < vertex_face_offsets[v1 + 1]; i++)
+        {
+            uint32_t other_face = vertex_faces[i];
+            if (other_face == HalfEdgeMesh::face_of(h))
+                continue;
+            for (uint32_t k = 0; k < 4; k++)
+            {
+                uint32_t other = 4 * other_face + k;
+                uint32_t a = half_vertex[other];
+                uint32_t b = half_vertex[HalfEdgeMesh::next(other)];
+                if ((a == v1 && b == v2) || (a == v2 && b == v1))
+                {
+                    half_edge[other] = edge;
+                    shared.push_back(other);
+                }
+            }
+        }
+
+        if (shared.size() == 1)
+        {
+            half_twin[h] = shared[0];
+            half_twin[shared[0]] = h;
+        }
+    }
+}
+
+// times the old construction on the faces of ply, then builds a mesh from them and times
+// its set_up_edges between the load stages around it, which must give the same edges
+static bool time_edges(const char* label, const PlyData& ply)
+{
+    std::vector<uint32_t> half_twin, half_edge;
+    size_t num_edges = 0;
+    auto start = std::chrono::steady_clock::now();
+    set_up_edges_by_vertex_rings(ply.face_indices, ply.num_vertices, half_twin, half_edge, num_edges);
+    const double old_ms = elapsed_ms(start);
+
+    double new_ms = 0.0;
+    auto progress = [&](const char* stage, double)
+    {
+        if (std::string(stage) == "building edges")
+            start = std::chrono::steady_clock::now();
+        else if (std::string(stage) == "ordering vertex rings")
+            new_ms = elapsed_ms(start);
+    };
+    std::unique_ptr<QuadMesh> mesh = std::make_unique<QuadMesh>(label, ply, false, progress);
+    const HalfEdgeMesh& m = mesh->half_edge_mesh();
+
+    const bool same = num_edges == m.num_edges() &&
+        std::equal(half_twin.begin(), half_twin.end(), m.half_twin.begin()) &&
+        std::equal(half_edge.begin(), half_edge.end(), m.half_edge.begin());
+    std::printf("%-24s %10zu %10zu %14.1f %14.1f %9.2fx%s\n", label, m.num_faces(), m.num_edges(),
+                old_ms, new_ms, new_ms > 0.0 ? old_ms / new_ms : 0.0, same ? "" : "  (edges differ)");
+    return same;
+}
+
+bool run_edge_benchmark()
+{
+    // the cache would skip building the edges, and the Morton layout would undo the shuffle
+    const bool cache_enabled = QuadMesh::cache_enabled();
+    QuadMesh::set_cache_enabled(false);
+    QuadMesh::set_layout(MeshLayout::FileOrder);
+
+    std::cout << "Edge benchmark, QuadMesh::set_up_edges against the search around vertex rings it replaced, on "
+              << num_worker_threads() << " threads" << std::endl;
+    std::printf("%-24s %10s %10s %14s %14s %10s\n", "", "faces", "edges", "rings ms", "buckets ms", "speedup");
+    bool ok = true;
+    for (size_t num_faces : { size_t(1000000), size_t(4000000), size_t(16000000) })
+    {
+        PlyData ply = synthetic_grid(num_faces);
+        const std::string size = std::to_string(num_faces / 1000000) + "M";
+        ok = time_edges((size + " ordered grid").c_str(), ply) && ok;
+
+        // the same faces in random order, so neighbouring quads are far apart in the face list
+        const size_t nf = ply.face_ids.size();
+        std::vector<uint32_t> order(nf);
+        for (size_t f = 0; f < nf; f++)
+            order[f] = static_cast<uint32_t>(f);
+        std::shuffle(order.begin(), order.end(), std::mt19937_64(2));
+        std::vector<unsigned int> face_indices(4 * nf), face_ids(nf);
+        for (size_t f = 0; f < nf; f++)
+        {
+            std::copy_n(&ply.face_indices[4 * size_t(order[f])], 4, &face_indices[4 * f]);
+            face_ids[f] = ply.face_ids[order[f]];
+        }
+        ply.face_indices.swap(face_indices);
+        ply.face_ids.swap(face_ids);
+        ok = time_edges((size + " shuffled grid").c_str(), ply) && ok;
+    }
+    QuadMesh::set_cache_enabled(cache_enabled);
+    return ok;
+}
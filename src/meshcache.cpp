@@ -0,0 +1,589 @@
+#include "meshcache.h"
+#include "mappedfile.h"
+#include "parallel.h"
+#include "plyreader.h"
+#include "quadmesh.h"
+#include "structuredgrid.h"
+#include <iostream>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <type_traits>
+
+// the user's cache directory for this program, empty if the environment names none
+static std::string default_cache_directory()
+{
+#ifdef _WIN32
+    const char* base = std::getenv("LOCALAPPDATA");
+    if (base && *base)
+        return (std::filesystem::path(base) / "SciVis" / "meshcache").string();
+#else
+    const char* base = std::getenv("XDG_CACHE_HOME");
+    if (base && *base)
+        return (std::filesystem::path(base) / "scivis").string();
+    const char* home = std::getenv("HOME");
+    if (home && *home)
+        return (std::filesystem::path(home) / ".cache" / "scivis").string();
+#endif
+    return "";
+}
+
+// initialized in this order, so the cache is off when there is no directory for it
+std::string QuadMesh::s_cache_directory = default_cache_directory();
+bool QuadMesh::s_cache_enabled = !QuadMesh::s_cache_directory.empty();
+uint64_t QuadMesh::s_cache_limit = uint64_t(8) << 30;
+
+void QuadMesh::set_cache_enabled(bool enabled) { s_cache_enabled = enabled; }
+void QuadMesh::set_cache_directory(const std::string& directory) { s_cache_directory = directory; }
+bool QuadMesh::cache_enabled() { return s_cache_enabled; }
+std::string QuadMesh::cache_directory() { return s_cache_directory; }
+void QuadMesh::set_cache_limit(uint64_t bytes) { s_cache_limit = bytes; }
+uint64_t QuadMesh::cache_limit() { return s_cache_limit; }
+std::string QuadMesh::cache_path(const char* filename, uint64_t hash) { return mesh_cache_path(filename, s_cache_directory, hash); }
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Hashing
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+static uint64_t mix(uint64_t h, uint64_t word)
+{
+    h ^= word * 0x9E3779B97F4A7C15ull;
+    h = (h << 31) | (h >> 33);
+    return h * 0xBF58476D1CE4E5B9ull;
+}
+
+static uint64_t hash_chunk(const char* data, size_t size, uint64_t seed)
+{
+    uint64_t h = mix(0x84222325CBF29CE4ull, seed);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = mix(h, word);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    h = mix(h, tail);
+    return mix(h, size);
+}
+
+uint64_t hash_bytes(const char* data, size_t size)
+{
+    // hash fixed size chunks independently so multi-GB files use every core,
+    // then fold the chunk hashes together in order
+    const size_t chunk_size = size_t(1) << 22;
+    size_t num_chunks = (size + chunk_size - 1) / chunk_size;
+    std::vector<uint64_t> chunk_hashes(num_chunks);
+    parallel_for_chunks(num_chunks, [&](size_t c)
+    {
+        size_t begin = c * chunk_size;
+        chunk_hashes[c] = hash_chunk(data + begin, std::min(chunk_size, size - begin), c);
+    });
+
+    uint64_t h = mix(0x6A09E667F3BCC908ull, size);
+    for (uint64_t chunk_hash : chunk_hashes)
+        h = mix(h, chunk_hash);
+    return h;
+}
+
+uint64_t topology_hash(const unsigned int* face_indices, size_t num_face_indices, const double* positions, size_t num_positions)
+{
+    uint64_t h = hash_bytes(reinterpret_cast<const char*>(face_indices), num_face_indices * sizeof(unsigned int));
+    return mix(h, hash_bytes(reinterpret_cast<const char*>(positions), num_positions * sizeof(double)));
+}
+
+uint64_t topology_hash(const PlyData& ply)
+{
+    std::vector<double> positions(ply.num_vertices * 3);
+    for (size_t v = 0; v < ply.num_vertices; v++)
+    {
+        const double* a = &ply.vertex_values[v * NUM_VERTEX_SLOTS];
+        positions[v * 3 + 0] = a[SLOT_X];
+        positions[v * 3 + 1] = a[SLOT_Y];
+        positions[v * 3 + 2] = a[SLOT_Z];
+    }
+    return topology_hash(ply.face_indices.data(), ply.face_indices.size(), positions.data(), positions.size());
+}
+
+std::string mesh_cache_path(const char* ply_filename, const std::string& cache_directory, uint64_t hash)
+{
+    if (cache_directory.empty())
+        return std::string(ply_filename) + ".qmcache";
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.qmcache", static_cast<unsigned long long>(hash));
+    return (std::filesystem::path(cache_directory) / name).string();
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Reading and Writing
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+static size_t padded(size_t bytes)
+{
+    return (bytes + 7) & ~size_t(7);
+}
+
+// sequential view over the arrays that follow the header in a mapped cache file
+class CacheReader
+{
+private:
+
+    const char* m_data;
+    size_t m_size;
+    size_t m_pos;
+
+public:
+
+    CacheReader(const char* data, size_t size, size_t pos) : m_data(data), m_size(size), m_pos(pos) {}
+
+    template <typename T>
+    const T* next(size_t count)
+    {
+        size_t bytes = count * sizeof(T);
+        if (count > m_size / sizeof(T) || m_pos + bytes > m_size)
+            return nullptr;
+        const T* array = reinterpret_cast<const T*>(m_data + m_pos);
+        m_pos += padded(bytes);
+        return array;
+    }
+};
+
+// from this version of the cache and built from this source file
+static bool is_current(const MeshCacheHeader& header, uint64_t source_hash, uint64_t source_size)
+{
+    return std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == MESH_CACHE_VERSION &&
+        header.header_size == sizeof(MeshCacheHeader) &&
+        header.source_hash == source_hash &&
+        header.source_size == source_size;
+}
+
+// a cache file's modification time is when it was last used, so pruning keeps the ones in use
+static void mark_cache_used(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+}
+
+bool read_mesh_cache_header(const std::string& path, uint64_t source_hash, uint64_t source_size,
+    MeshCacheHeader& header)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    return is_current(header, source_hash, source_size);
+}
+
+bool QuadMesh::read_mesh_cache(const std::string& path, uint64_t source_hash, uint64_t source_size)
+{
+    MappedFile file(path.c_str());
+    if (!file.is_open() || file.size() < sizeof(MeshCacheHeader))
+        return false;
+
+    MeshCacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (!is_current(header, source_hash, source_size) ||
+        header.kind == static_cast<uint32_t>(MeshCacheKind::Grid) ||
+        header.layout != static_cast<uint32_t>(s_layout))
+        return false; // stale, from another version, a grid or laid out differently, the caller rebuilds it
+
+    const size_t nv = header.num_vertices;
+    const size_t ne = header.num_edges;
+    const size_t nf = header.num_faces;
+    CacheReader reader(file.data(), file.size(), padded(sizeof(header)));
+    const double* vertex_values = reader.next<double>(nv * MESH_CACHE_VERTEX_VALUES);
+    const double* face_normals = reader.next<double>(nf * 3);
+    const uint32_t* face_ids = reader.next<uint32_t>(nf);
+    const uint32_t* half_vertex = reader.next<uint32_t>(nf * 4);
+    const uint32_t* half_twin = reader.next<uint32_t>(nf * 4);
+    const uint32_t* half_edge = reader.next<uint32_t>(nf * 4);
+    const uint32_t* edge_vertices = reader.next<uint32_t>(ne * 2);
+    const uint32_t* edge_half = reader.next<uint32_t>(ne);
+    const uint32_t* vertex_half = reader.next<uint32_t>(nv);
+    const bool reordered = (s_layout != MeshLayout::FileOrder);
+    const uint32_t* vertex_ids = reordered ? reader.next<uint32_t>(nv) : vertex_half;
+    if (!vertex_values || !face_normals || !face_ids || !half_vertex || !half_twin ||
+        !half_edge || !edge_vertices || !edge_half || !vertex_half || !vertex_ids)
+    {
+        std::cout << "Truncated mesh cache file: " << path << std::endl;
+        return false;
+    }
+    // every index has to land inside the array it points into, a damaged cache is
+    // rebuilt like a stale one
+    const size_t nh = nf * 4;
+    auto out_of_range = [](const uint32_t* indices, size_t count, size_t limit, bool invalid_allowed)
+    {
+        return std::any_of(indices, indices + count, [=](uint32_t i)
+        {
+            return i >= limit && !(invalid_allowed && i == HalfEdgeMesh::INVALID);
+        });
+    };
+    bool twins_match = true;
+    for (size_t h = 0; h < nh && twins_match; h++)
+    {
+        uint32_t twin = half_twin[h];
+        twins_match = twin == HalfEdgeMesh::INVALID || (twin < nh && twin != h && half_twin[twin] == h);
+    }
+    if (!twins_match ||
+        out_of_range(half_vertex, nh, nv, false) ||
+        out_of_range(half_edge, nh, ne, false) ||
+        out_of_range(edge_vertices, ne * 2, nv, false) ||
+        out_of_range(edge_half, ne, nh, true) ||
+        out_of_range(vertex_half, nv, nh, true) ||
+        (reordered && out_of_range(vertex_ids, nv, nv, false)))
+    {
+        std::cout << "Damaged mesh cache file: " << path << std::endl;
+        return false;
+    }
+
+    // the values are stored as doubles rounded to the precision the mesh was built
+    // with, so a cache built at another precision than the one wanted now is rebuilt
+    const MeshPrecision cached = header.float32 ? MeshPrecision::Float32 : MeshPrecision::Float64;
+    MeshPrecision wanted = s_precision;
+    if (s_precision == MeshPrecision::MatchFile)
+        wanted = header.source_float32 ? MeshPrecision::Float32 : MeshPrecision::Float64;
+    if (wanted != cached)
+        return false;
+    m_mesh.precision = cached;
+    m_mesh.geometry([&](auto& g)
+    {
+        using vec3 = typename std::decay_t<decltype(g)>::vec3;
+        using real = typename std::decay_t<decltype(g)>::real;
+        g.positions.resize(nv);
+        g.normals.resize(nv);
+        g.scalars.resize(nv);
+        g.vectors.resize(nv);
+        for (size_t i = 0; i < nv; i++)
+        {
+            const double* a = &vertex_values[i * MESH_CACHE_VERTEX_VALUES];
+            g.positions[i] = vec3(a[0], a[1], a[2]);
+            g.normals[i] = vec3(a[3], a[4], a[5]);
+            g.scalars[i] = static_cast<real>(a[6]);
+            g.vectors[i] = vec3(a[7], a[8], a[9]);
+        }
+        g.face_normals.resize(nf);
+        for (size_t i = 0; i < nf; i++)
+            g.face_normals[i] = vec3(face_normals[3 * i], face_normals[3 * i + 1], face_normals[3 * i + 2]);
+    });
+    m_mesh.vertex_half.assign(vertex_half, vertex_half + nv);
+    if (reordered)
+    {
+        m_mesh.vertex_ids.assign(vertex_ids, vertex_ids + nv);
+        m_mesh.id_vertices.resize(nv);
+        for (uint32_t v = 0; v < nv; v++)
+            m_mesh.id_vertices[vertex_ids[v]] = v;
+    }
+
+    m_mesh.face_ids.assign(face_ids, face_ids + nf);
+    m_mesh.half_vertex.assign(half_vertex, half_vertex + nf * 4);
+    m_mesh.half_twin.assign(half_twin, half_twin + nf * 4);
+    m_mesh.half_edge.assign(half_edge, half_edge + nf * 4);
+
+    m_mesh.edge_vertices.assign(edge_vertices, edge_vertices + ne * 2);
+    m_mesh.edge_half.assign(edge_half, edge_half + ne);
+
+    m_midpoint = glm::dvec3(header.midpoint[0], header.midpoint[1], header.midpoint[2]);
+    radius = header.radius;
+    m_topology_hash = header.topology_hash;
+    mark_cache_used(path);
+    return true;
+}
+
+template <typename T, typename Allocator>
+static void write_array(std::ofstream& out, const std::vector<T, Allocator>& array)
+{
+    static const char zeros[8] = {};
+    size_t bytes = array.size() * sizeof(T);
+    if (bytes > 0)
+        out.write(reinterpret_cast<const char*>(array.data()), bytes);
+    out.write(zeros, padded(bytes) - bytes);
+}
+
+// a name for a temporary file next to path that no other writer uses, in this process
+// or another one writing the same cache at the same time
+static std::string unique_temp_path(const std::string& path)
+{
+    static const uint64_t process_token = (uint64_t(std::random_device{}()) << 32) ^ std::random_device{}();
+    static std::atomic<uint64_t> counter(0);
+    char suffix[48];
+    std::snprintf(suffix, sizeof(suffix), ".%016llx.%llu.tmp", static_cast<unsigned long long>(process_token),
+        static_cast<unsigned long long>(counter++));
+    return path + suffix;
+}
+
+// delete the least recently used cache files in directory until it holds at most limit
+// bytes, never keep, along with temporary files a crashed writer left a day or more ago
+static void prune_cache_directory(const std::string& directory, uint64_t limit, const std::string& keep)
+{
+    struct CacheFile
+    {
+        std::filesystem::file_time_type used;
+        uint64_t size;
+        std::filesystem::path path;
+    };
+    std::vector<CacheFile> files;
+    uint64_t total = 0;
+    const auto stale = std::filesystem::file_time_type::clock::now() - std::chrono::hours(24);
+
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+    {
+        std::error_code file_error;
+        const std::filesystem::path& path = it->path();
+        const uint64_t size = it->file_size(file_error);
+        const auto used = it->last_write_time(file_error);
+        if (file_error || !it->is_regular_file(file_error))
+            continue;
+        if (path.extension() == ".tmp")
+        {
+            if (used < stale)
+                std::filesystem::remove(path, file_error);
+        }
+        else if (path.extension() == ".qmcache")
+        {
+            total += size;
+            if (path != std::filesystem::path(keep))
+                files.push_back({ used, size, path });
+        }
+    }
+    if (limit == 0 || total <= limit)
+        return;
+
+    std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.used < b.used; });
+    for (const CacheFile& file : files)
+    {
+        if (total <= limit)
+            break;
+        // another process may have deleted it already, or be reading it, which is fine
+        // where files stay readable after they are unlinked
+        if (std::filesystem::remove(file.path, error))
+            total -= file.size;
+    }
+}
+
+// write the header and then the arrays to a temporary file and move it into place,
+// so a reader never sees half a cache
+template <typename WriteArrays>
+static bool write_cache_file(const std::string& path, const MeshCacheHeader& header, WriteArrays write_arrays)
+{
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    if (!directory.empty())
+        std::filesystem::create_directories(directory, error);
+
+    const std::string temp_path = unique_temp_path(path);
+    bool written = false;
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (out)
+        {
+            static const char zeros[8] = {};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(zeros, padded(sizeof(header)) - sizeof(header));
+            write_arrays(out);
+            out.close();
+            written = !out.fail();
+        }
+    }
+
+    // a partial file is removed, it could be as large as the mesh
+    if (written)
+        std::filesystem::rename(temp_path, path, error);
+    if (!written || error)
+    {
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+
+    // caches next to the .ply files are left alone, only the cache directory has a limit
+    if (!QuadMesh::cache_directory().empty())
+        prune_cache_directory(QuadMesh::cache_directory(), QuadMesh::cache_limit(), path);
+    return true;
+}
+
+bool QuadMesh::write_mesh_cache(const MeshSource& source, bool source_float32) const
+{
+    const size_t nv = m_mesh.num_vertices();
+    const size_t nf = m_mesh.num_faces();
+    std::vector<double> vertex_values;
+    vertex_values.reserve(nv * MESH_CACHE_VERTEX_VALUES);
+    for (uint32_t i = 0; i < nv; i++)
+    {
+        glm::dvec3 p = m_mesh.position(i), n = m_mesh.normal(i), vec = m_mesh.vector(i);
+        double a[MESH_CACHE_VERTEX_VALUES] = { p.x, p.y, p.z, n.x, n.y, n.z, m_mesh.scalar(i),
+            vec.x, vec.y, vec.z };
+        vertex_values.insert(vertex_values.end(), a, a + MESH_CACHE_VERTEX_VALUES);
+    }
+
+    std::vector<double> face_normals;
+    face_normals.reserve(nf * 3);
+    for (uint32_t f = 0; f < nf; f++)
+    {
+        glm::dvec3 n = m_mesh.face_normal(f);
+        face_normals.insert(face_normals.end(), { n.x, n.y, n.z });
+    }
+
+    MeshCacheHeader header = {};
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.header_size = sizeof(MeshCacheHeader);
+    header.source_hash = source.hash;
+    header.source_size = source.size;
+    header.num_vertices = nv;
+    header.num_edges = m_mesh.num_edges();
+    header.num_faces = nf;
+    header.midpoint[0] = m_midpoint.x;
+    header.midpoint[1] = m_midpoint.y;
+    header.midpoint[2] = m_midpoint.z;
+    header.radius = radius;
+    header.topology_hash = m_topology_hash;
+    header.float32 = m_mesh.is_float32() ? 1 : 0;
+    header.source_float32 = source_float32 ? 1 : 0;
+    header.layout = static_cast<uint32_t>(layout());
+    header.kind = static_cast<uint32_t>(source.kind);
+
+    return write_cache_file(source.cache_path, header, [&](std::ofstream& out)
+    {
+        write_array(out, vertex_values);
+        write_array(out, face_normals);
+        write_array(out, m_mesh.face_ids);
+        write_array(out, m_mesh.half_vertex);
+        write_array(out, m_mesh.half_twin);
+        write_array(out, m_mesh.half_edge);
+        write_array(out, m_mesh.edge_vertices);
+        write_array(out, m_mesh.edge_half);
+        write_array(out, m_mesh.vertex_half);
+        write_array(out, m_mesh.vertex_ids);
+    });
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Structured Grids
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<StructuredGrid2D> StructuredGrid2D::read_cache(const std::string& path,
+    uint64_t source_hash, uint64_t source_size)
+{
+    MappedFile file(path.c_str());
+    if (!file.is_open() || file.size() < sizeof(MeshCacheHeader))
+        return nullptr;
+
+    MeshCacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (!is_current(header, source_hash, source_size) || header.kind != static_cast<uint32_t>(MeshCacheKind::Grid))
+        return nullptr;
+
+    const size_t nx = header.grid_nx;
+    const size_t ny = header.grid_ny;
+    const size_t nv = header.num_vertices;
+    if (nx < 2 || ny < 2 || nx > nv || nx * ny != nv || header.num_faces != (nx - 1) * (ny - 1))
+        return nullptr;
+    for (int k = 0; k < 4; k++)
+    {
+        // the corners go around a cell, like detect requires
+        int32_t step = header.grid_corners[k] ^ header.grid_corners[(k + 1) % 4];
+        if (header.grid_corners[k] < 0 || header.grid_corners[k] > 3 || (step != 1 && step != 2))
+            return nullptr;
+    }
+
+    const bool lattice_order = header.grid_lattice_order != 0;
+    CacheReader reader(file.data(), file.size(), padded(sizeof(header)));
+    const double* scalars = reader.next<double>(nv);
+    const double* vectors = reader.next<double>(nv * 3);
+    const uint32_t* node_vertex = lattice_order ? nullptr : reader.next<uint32_t>(nv);
+    if (!scalars || !vectors || (!lattice_order && !node_vertex))
+    {
+        std::cout << "Truncated mesh cache file: " << path << std::endl;
+        return nullptr;
+    }
+
+    std::unique_ptr<StructuredGrid2D> grid(new StructuredGrid2D());
+    if (!lattice_order)
+    {
+        // every vertex has to be on exactly one node
+        grid->m_node_vertex.assign(node_vertex, node_vertex + nv);
+        grid->m_vertex_node.assign(nv, UINT32_MAX);
+        for (uint32_t node = 0; node < nv; node++)
+        {
+            uint32_t v = node_vertex[node];
+            if (v >= nv || grid->m_vertex_node[v] != UINT32_MAX)
+                return nullptr;
+            grid->m_vertex_node[v] = node;
+        }
+    }
+    grid->m_origin = glm::dvec3(header.grid_origin[0], header.grid_origin[1], header.grid_origin[2]);
+    grid->m_spacing = glm::dvec2(header.grid_spacing[0], header.grid_spacing[1]);
+    grid->m_nx = nx;
+    grid->m_ny = ny;
+    std::copy(header.grid_corners, header.grid_corners + 4, grid->m_corners);
+    grid->set_normal_from_corners();
+    grid->m_scalars.assign(scalars, scalars + nv);
+    grid->m_vectors.resize(nv);
+    for (size_t v = 0; v < nv; v++)
+        grid->m_vectors[v] = glm::dvec3(vectors[3 * v], vectors[3 * v + 1], vectors[3 * v + 2]);
+    grid->m_midpoint = glm::dvec3(header.midpoint[0], header.midpoint[1], header.midpoint[2]);
+    grid->m_radius = header.radius;
+    grid->m_topology_hash = header.topology_hash;
+    mark_cache_used(path);
+    return grid;
+}
+
+bool StructuredGrid2D::write_cache(const std::string& path, uint64_t source_hash, uint64_t source_size) const
+{
+    MeshCacheHeader header = {};
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.header_size = sizeof(MeshCacheHeader);
+    header.source_hash = source_hash;
+    header.source_size = source_size;
+    header.num_vertices = num_vertices();
+    header.num_edges = num_edges();
+    header.num_faces = num_faces();
+    header.midpoint[0] = m_midpoint.x;
+    header.midpoint[1] = m_midpoint.y;
+    header.midpoint[2] = m_midpoint.z;
+    header.radius = m_radius;
+    header.topology_hash = m_topology_hash;
+    header.kind = static_cast<uint32_t>(MeshCacheKind::Grid);
+    header.grid_lattice_order = m_node_vertex.empty() ? 1 : 0;
+    header.grid_origin[0] = m_origin.x;
+    header.grid_origin[1] = m_origin.y;
+    header.grid_origin[2] = m_origin.z;
+    header.grid_spacing[0] = m_spacing.x;
+    header.grid_spacing[1] = m_spacing.y;
+    header.grid_nx = m_nx;
+    header.grid_ny = m_ny;
+    std::copy(m_corners, m_corners + 4, header.grid_corners);
+
+    std::vector<double> vectors;
+    vectors.reserve(m_vectors.size() * 3);
+    for (const glm::dvec3& vector : m_vectors)
+        vectors.insert(vectors.end(), { vector.x, vector.y, vector.z });
+    return write_cache_file(path, header, [&](std::ofstream& out)
+    {
+        write_array(out, m_scalars);
+        write_array(out, vectors);
+        write_array(out, m_node_vertex);
+    });
+}
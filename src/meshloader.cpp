@@ -0,0 +1,209 @@
+#include "meshloader.h"
+#include "meshcache.h"
+#include "plyreader.h"
+#include "quadmesh.h"
+#include <iostream>
+
+MeshLoader::MeshLoader()
+{
+    m_thread = std::thread(&MeshLoader::run, this);
+}
+
+MeshLoader::~MeshLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_pending.clear();
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void MeshLoader::request(const std::string& filename, uint64_t current_topology)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending = filename;
+        m_pending_topology = current_topology;
+    }
+    m_wake.notify_one();
+}
+
+bool MeshLoader::busy() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_pending.empty() || !m_loading.empty();
+}
+
+bool MeshLoader::progress(std::string& filename, std::string& stage, double& fraction) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_loading.empty())
+        return false;
+    filename = m_loading;
+    stage = m_stage;
+    fraction = m_progress;
+    return true;
+}
+
+bool MeshLoader::take_result(Result& result)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_result)
+        return false;
+    result = std::move(*m_result);
+    m_result = nullptr;
+    return true;
+}
+
+void MeshLoader::request_tile(size_t index, const std::string& filename)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tile_requests.emplace_back(index, filename);
+    }
+    m_wake.notify_one();
+}
+
+void MeshLoader::clear_tiles()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tile_requests.clear();
+    m_tile_results.clear();
+    m_tile_generation++;
+}
+
+std::vector<MeshLoader::TileResult> MeshLoader::take_tiles()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<TileResult> results;
+    results.swap(m_tile_results);
+    return results;
+}
+
+void MeshLoader::run()
+{
+    while (true)
+    {
+        std::string filename;
+        uint64_t current_topology = 0;
+        bool is_tile = false;
+        size_t tile = 0;
+        uint64_t tile_generation = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stop || !m_pending.empty() || !m_tile_requests.empty(); });
+            if (m_stop)
+                return;
+            if (m_pending.empty())
+            {
+                // no mesh is waiting, so load the next tile
+                is_tile = true;
+                tile = m_tile_requests.front().first;
+                filename.swap(m_tile_requests.front().second);
+                m_tile_requests.pop_front();
+                tile_generation = m_tile_generation;
+            }
+            else
+            {
+                filename.swap(m_pending);
+                current_topology = m_pending_topology;
+                m_loading = filename;
+                m_stage = "starting";
+                m_progress = 0.0;
+            }
+        }
+
+        if (is_tile)
+        {
+            TileResult result;
+            result.index = tile;
+            load_tile(filename, result);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (tile_generation == m_tile_generation)
+                m_tile_results.push_back(std::move(result));
+            continue;
+        }
+
+        std::unique_ptr<Result> result = std::make_unique<Result>();
+        load(filename, current_topology, *result);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!result->attributes_only && (!result->mesh || result->mesh->num_faces() == 0))
+            std::cout << "Could not load a quad mesh from " << filename << std::endl;
+        else
+            m_result = std::move(result); // an older result nobody took is dropped
+        m_loading.clear();
+    }
+}
+
+void MeshLoader::load_tile(const std::string& filename, TileResult& result)
+{
+    // the tile's mesh is only needed to build its surface, tiles are not cached
+    QuadMesh mesh(filename.c_str(), false, nullptr, false);
+    if (mesh.num_faces() == 0)
+    {
+        std::cout << "Could not load tile " << filename << std::endl;
+        return;
+    }
+    result.surface = DrawItem::buildPayload(mesh, DrawItem::DrawMode::Surface);
+    result.loaded = true;
+}
+
+void MeshLoader::load(const std::string& filename, uint64_t current_topology, Result& result)
+{
+    auto report = [this](const char* stage, double fraction)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stage = stage;
+        m_progress = fraction;
+    };
+    result.filename = filename;
+
+    if (current_topology == 0)
+    {
+        // build the mesh and everything the surface needs apart from the GL buffers
+        result.mesh = FieldMesh::open(filename.c_str(), true, report);
+        if (!result.mesh)
+            return;
+        report("building surface", 1.0);
+        result.surface = DrawItem::buildPayload(*result.mesh, DrawItem::DrawMode::Surface);
+        result.topology_hash = result.mesh->topology_hash();
+        return;
+    }
+
+    // compare the file's faces and positions with the mesh on screen before building anything
+    report("reading file", 0.05);
+    PlyData ply;
+    if (!read_ply_file(filename.c_str(), ply))
+        return;
+    if (topology_hash(ply) != current_topology)
+    {
+        result.mesh = FieldMesh::open(filename.c_str(), ply, true, report);
+        report("building surface", 1.0);
+        result.surface = DrawItem::buildPayload(*result.mesh, DrawItem::DrawMode::Surface);
+        result.topology_hash = result.mesh->topology_hash();
+        return;
+    }
+
+    // same grid, only the scalar and vector values are new
+    report("reading attributes", 0.5);
+    result.attributes_only = true;
+    result.topology_hash = current_topology;
+    result.attributes = ply.attributes;
+    result.vertex_values.resize(ply.num_vertices * 4);
+    result.surface.attribute_data.resize(ply.num_vertices * DrawItem::SURFACE_ATTRIBUTE_FLOATS);
+    for (size_t v = 0; v < ply.num_vertices; v++)
+    {
+        const double* a = &ply.vertex_values[v * NUM_VERTEX_SLOTS];
+        double* values = &result.vertex_values[v * 4];
+        values[0] = a[SLOT_S];
+        values[1] = a[SLOT_VX];
+        values[2] = a[SLOT_VY];
+        values[3] = a[SLOT_VZ];
+        DrawItem::surfaceAttributes(a[SLOT_S], glm::dvec3(a[SLOT_VX], a[SLOT_VY], a[SLOT_VZ]),
+            &result.surface.attribute_data[v * DrawItem::SURFACE_ATTRIBUTE_FLOATS]);
+    }
+    std::cout << "Opened quad mesh from " << filename << " (same mesh, attributes only)" << std::endl;
+}
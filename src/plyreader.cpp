@@ -0,0 +1,933 @@
+#include "plyreader.h"
+#include "mappedfile.h"
+#include "parallel.h"
+#include <iostream>
+
+#include <sstream>
+#include <charconv>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Header Parsing
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+static PlyType parse_type(const std::string& name)
+{
+    if (name == "char" || name == "int8") return PlyType::Int8;
+    if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+    if (name == "short" || name == "int16") return PlyType::Int16;
+    if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+    if (name == "int" || name == "int32") return PlyType::Int32;
+    if (name == "uint" || name == "uint32") return PlyType::UInt32;
+    if (name == "float" || name == "float32") return PlyType::Float32;
+    if (name == "double" || name == "float64") return PlyType::Float64;
+    return PlyType::Invalid;
+}
+
+size_t ply_type_size(PlyType type)
+{
+    switch (type)
+    {
+    case PlyType::Int8:
+    case PlyType::UInt8:
+        return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16:
+        return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32:
+        return 4;
+    case PlyType::Float64:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+int vertex_slot(const std::string& name)
+{
+    static const char* names[NUM_VERTEX_SLOTS] = {
+        "x", "y", "z", "nx", "ny", "nz", "s", "vx", "vy", "vz" };
+    for (int i = 0; i < NUM_VERTEX_SLOTS; i++)
+    {
+        if (name == names[i])
+            return i;
+    }
+    return SLOT_NONE; // other properties are kept as attribute columns
+}
+
+// get the next line from the buffer without the line ending, returns false at the end of the data
+static bool next_line(const char* data, size_t size, size_t& pos, std::string& line)
+{
+    if (pos >= size)
+        return false;
+    const char* start = data + pos;
+    const char* newline = static_cast<const char*>(std::memchr(start, '\n', size - pos));
+    size_t length = newline ? static_cast<size_t>(newline - start) : size - pos;
+    pos += newline ? length + 1 : length;
+    if (length > 0 && start[length - 1] == '\r')
+        length--;
+    line.assign(start, length);
+    return true;
+}
+
+bool parse_ply_header(const char* data, size_t size, PlyHeader& header)
+{
+    header = PlyHeader();
+    size_t pos = 0;
+    std::string line;
+
+    if (!next_line(data, size, pos, line) || line != "ply")
+    {
+        std::cout << "Not a valid .ply file." << std::endl;
+        return false;
+    }
+
+    if (!next_line(data, size, pos, line))
+    {
+        std::cout << "Invalid .ply header." << std::endl;
+        return false;
+    }
+    if (line == "format ascii 1.0")
+        header.format = PlyFormat::Ascii;
+    else if (line == "format binary_little_endian 1.0")
+        header.format = PlyFormat::BinaryLittleEndian;
+    else if (line == "format binary_big_endian 1.0")
+        header.format = PlyFormat::BinaryBigEndian;
+    else
+    {
+        std::cout << "Unsupported .ply format: " << line << std::endl;
+        return false;
+    }
+
+    while (next_line(data, size, pos, line))
+    {
+        std::istringstream iss(line);
+        std::string keyword;
+        iss >> keyword;
+
+        if (keyword == "element")
+        {
+            PlyElement element;
+            iss >> element.name >> element.count;
+            header.elements.push_back(element);
+        }
+        else if (keyword == "property")
+        {
+            if (header.elements.empty())
+            {
+                std::cout << "Invalid .ply header: property before element." << std::endl;
+                return false;
+            }
+
+            PlyProperty prop;
+            std::string type;
+            iss >> type;
+            if (type == "list")
+            {
+                std::string count_type, index_type;
+                iss >> count_type >> index_type >> prop.name;
+                prop.is_list = true;
+                prop.count_type = parse_type(count_type);
+                prop.type = parse_type(index_type);
+            }
+            else
+            {
+                iss >> prop.name;
+                prop.type = parse_type(type);
+            }
+
+            if (prop.type == PlyType::Invalid || (prop.is_list && prop.count_type == PlyType::Invalid))
+            {
+                std::cout << "Invalid .ply property type: " << line << std::endl;
+                return false;
+            }
+            header.elements.back().properties.push_back(prop);
+        }
+        else if (keyword == "end_header")
+        {
+            header.body_offset = pos;
+
+            // lay out the fixed size binary records and resolve the vertex slots once
+            for (PlyElement& element : header.elements)
+            {
+                size_t offset = 0;
+                bool fixed_size = true;
+                for (PlyProperty& prop : element.properties)
+                {
+                    prop.offset = offset;
+                    if (prop.is_list)
+                        fixed_size = false;
+                    else
+                        offset += ply_type_size(prop.type);
+                    if (element.name == "vertex" && !prop.is_list)
+                        prop.slot = vertex_slot(prop.name);
+                }
+                element.stride = fixed_size ? offset : 0;
+            }
+            return true;
+        }
+        // comment and obj_info lines are ignored
+    }
+
+    std::cout << "Invalid .ply header." << std::endl;
+    return false;
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Binary Decoding
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+bool host_is_little_endian()
+{
+    const uint16_t one = 1;
+    unsigned char first_byte;
+    std::memcpy(&first_byte, &one, 1);
+    return first_byte == 1;
+}
+
+// load an unaligned value from the buffer, reversing the bytes if the file endianness differs
+template <typename T>
+static T load(const char* p, bool swap)
+{
+    T value;
+    if (!swap)
+    {
+        std::memcpy(&value, p, sizeof(T));
+        return value;
+    }
+    char bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); i++)
+        bytes[i] = p[sizeof(T) - 1 - i];
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+static double load_double(const char* p, PlyType type, bool swap)
+{
+    switch (type)
+    {
+    case PlyType::Int8: return load<int8_t>(p, swap);
+    case PlyType::UInt8: return load<uint8_t>(p, swap);
+    case PlyType::Int16: return load<int16_t>(p, swap);
+    case PlyType::UInt16: return load<uint16_t>(p, swap);
+    case PlyType::Int32: return load<int32_t>(p, swap);
+    case PlyType::UInt32: return load<uint32_t>(p, swap);
+    case PlyType::Float32: return load<float>(p, swap);
+    case PlyType::Float64: return load<double>(p, swap);
+    default: return 0.0;
+    }
+}
+
+static long long load_integer(const char* p, PlyType type, bool swap)
+{
+    switch (type)
+    {
+    case PlyType::Int8: return load<int8_t>(p, swap);
+    case PlyType::UInt8: return load<uint8_t>(p, swap);
+    case PlyType::Int16: return load<int16_t>(p, swap);
+    case PlyType::UInt16: return load<uint16_t>(p, swap);
+    case PlyType::Int32: return load<int32_t>(p, swap);
+    case PlyType::UInt32: return load<uint32_t>(p, swap);
+    case PlyType::Float32: return static_cast<long long>(load<float>(p, swap));
+    case PlyType::Float64: return static_cast<long long>(load<double>(p, swap));
+    default: return 0;
+    }
+}
+
+static bool is_face_index_list(const PlyProperty& prop)
+{
+    return prop.is_list && (prop.name == "vertex_indices" || prop.name == "vertex_index");
+}
+
+static bool read_binary_body(const PlyHeader& header, const char* data, size_t size, PlyData& ply, bool read_faces)
+{
+    const bool swap = (header.format == PlyFormat::BinaryLittleEndian) != host_is_little_endian();
+    size_t pos = header.body_offset;
+
+    for (const PlyElement& element : header.elements)
+    {
+        if (element.name == "vertex")
+        {
+            if (element.stride == 0)
+            {
+                std::cout << "List properties are not supported on vertices." << std::endl;
+                return false;
+            }
+            if (element.count > (size - pos) / element.stride)
+            {
+                std::cout << "Unexpected end of file while reading vertices." << std::endl;
+                return false;
+            }
+
+            // only the properties the mesh uses are decoded, everything else is skipped by the stride
+            std::vector<const PlyProperty*> used;
+            for (const PlyProperty& prop : element.properties)
+            {
+                if (prop.slot != SLOT_NONE)
+                    used.push_back(&prop);
+            }
+
+            // records have a fixed size, so each thread decodes its own range of vertices
+            ply.num_vertices = element.count;
+            ply.vertex_values.assign(element.count * NUM_VERTEX_SLOTS, 0.0);
+            parallel_for(element.count, [&](size_t begin, size_t end)
+            {
+                const char* record = data + pos + begin * element.stride;
+                double* values = ply.vertex_values.data() + begin * NUM_VERTEX_SLOTS;
+                for (size_t i = begin; i < end; i++)
+                {
+                    for (const PlyProperty* prop : used)
+                        values[prop->slot] = load_double(record + prop->offset, prop->type, swap);
+                    record += element.stride;
+                    values += NUM_VERTEX_SLOTS;
+                }
+            }, 64 * 1024);
+            pos += element.count * element.stride;
+            if (!read_faces)
+                return true;
+        }
+        else if (element.name == "face")
+        {
+            // every record takes at least a byte, so the rest of the file bounds the count
+            const size_t reserved = std::min(element.count, size - pos);
+            ply.face_indices.reserve(reserved * 4);
+            ply.face_ids.reserve(reserved);
+            for (size_t i = 0; i < element.count; i++)
+            {
+                for (const PlyProperty& prop : element.properties)
+                {
+                    if (!prop.is_list)
+                    {
+                        if (ply_type_size(prop.type) > size - pos)
+                        {
+                            std::cout << "Unexpected end of file while reading faces." << std::endl;
+                            return false;
+                        }
+                        pos += ply_type_size(prop.type);
+                        continue;
+                    }
+
+                    size_t count_size = ply_type_size(prop.count_type);
+                    size_t index_size = ply_type_size(prop.type);
+                    if (pos + count_size > size)
+                    {
+                        std::cout << "Unexpected end of file while reading faces." << std::endl;
+                        return false;
+                    }
+                    long long n = load_integer(data + pos, prop.count_type, swap);
+                    pos += count_size;
+                    if (n < 0 || static_cast<size_t>(n) > (size - pos) / index_size)
+                    {
+                        std::cout << "Unexpected end of file while reading faces." << std::endl;
+                        return false;
+                    }
+
+                    if (is_face_index_list(prop))
+                    {
+                        if (n != 4)
+                            std::cout << "Skipping non-quad face" << i << " with " << n << " vertices." << std::endl;
+                        else
+                        {
+                            unsigned int verts[4];
+                            bool valid = true;
+                            for (int j = 0; j < 4; j++)
+                            {
+                                long long vid = load_integer(data + pos + j * index_size, prop.type, swap);
+                                if (vid < 0 || static_cast<size_t>(vid) >= ply.num_vertices)
+                                {
+                                    std::cout << "Invalid vertex index in face" << i << "." << std::endl;
+                                    valid = false;
+                                    break;
+                                }
+                                verts[j] = static_cast<unsigned int>(vid);
+                            }
+                            if (valid)
+                            {
+                                ply.face_indices.insert(ply.face_indices.end(), verts, verts + 4);
+                                ply.face_ids.push_back(static_cast<unsigned int>(i));
+                            }
+                        }
+                    }
+                    pos += static_cast<size_t>(n) * index_size;
+                }
+            }
+        }
+        else if (element.stride > 0)
+        {
+            // unknown element with fixed size records, skip over all of them at once
+            if (element.count > (size - pos) / element.stride)
+            {
+                std::cout << "Unexpected end of file while reading " << element.name << " elements." << std::endl;
+                return false;
+            }
+            pos += element.count * element.stride;
+        }
+        else
+        {
+            // unknown element with lists, walk the records to find where it ends; an
+            // element without properties takes no bytes however many records it has
+            for (size_t i = 0; i < element.count && !element.properties.empty(); i++)
+            {
+                for (const PlyProperty& prop : element.properties)
+                {
+                    if (!prop.is_list)
+                    {
+                        if (ply_type_size(prop.type) > size - pos)
+                        {
+                            std::cout << "Unexpected end of file while reading " << element.name << " elements." << std::endl;
+                            return false;
+                        }
+                        pos += ply_type_size(prop.type);
+                        continue;
+                    }
+
+                    size_t count_size = ply_type_size(prop.count_type);
+                    size_t type_size = ply_type_size(prop.type);
+                    if (pos + count_size > size)
+                    {
+                        std::cout << "Unexpected end of file while reading " << element.name << " elements." << std::endl;
+                        return false;
+                    }
+                    long long n = load_integer(data + pos, prop.count_type, swap);
+                    pos += count_size;
+                    if (n < 0 || static_cast<size_t>(n) > (size - pos) / type_size)
+                    {
+                        std::cout << "Unexpected end of file while reading " << element.name << " elements." << std::endl;
+                        return false;
+                    }
+                    pos += static_cast<size_t>(n) * type_size;
+                }
+            }
+        }
+
+        if (pos > size)
+        {
+            std::cout << "Unexpected end of file while reading " << element.name << " elements." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// ASCII Parsing
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+// ASCII values are parsed in place from the mapped file, one line at a time,
+// without building any strings or streams
+
+static const char* find_line_end(const char* p, const char* end)
+{
+    const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+    return newline ? newline : end;
+}
+
+static const char* skip_blanks(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p;
+}
+
+static const char* skip_token(const char* p, const char* end)
+{
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+        p++;
+    return p;
+}
+
+// parse one number from [p, end), returns the position after it
+// an unreadable token is skipped and leaves value untouched
+static const char* parse_double(const char* p, const char* end, double& value)
+{
+    p = skip_blanks(p, end);
+    if (p < end && *p == '+')
+        p++;
+#if defined(__cpp_lib_to_chars)
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec == std::errc())
+        return result.ptr;
+#else
+    // standard libraries without floating point from_chars, parse a bounded copy of the token
+    char token[64];
+    size_t length = static_cast<size_t>(skip_token(p, end) - p);
+    if (length > 0 && length < sizeof(token))
+    {
+        std::memcpy(token, p, length);
+        token[length] = '\0';
+        char* token_end = nullptr;
+        double parsed = std::strtod(token, &token_end);
+        if (token_end != token)
+        {
+            value = parsed;
+            return p + (token_end - token);
+        }
+    }
+#endif
+    return skip_token(p, end);
+}
+
+static const char* parse_integer(const char* p, const char* end, long long& value)
+{
+    p = skip_blanks(p, end);
+    if (p < end && *p == '+')
+        p++;
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec == std::errc())
+        return result.ptr;
+    return skip_token(p, end);
+}
+
+static const char* skip_lines(const char* p, const char* end, size_t count)
+{
+    for (size_t i = 0; i < count && p < end; i++)
+    {
+        const char* eol = find_line_end(p, end);
+        p = (eol < end) ? eol + 1 : end;
+    }
+    return p;
+}
+
+static size_t count_lines(const char* p, const char* end)
+{
+    size_t count = 0;
+    while (p < end)
+    {
+        const char* eol = find_line_end(p, end);
+        p = (eol < end) ? eol + 1 : end;
+        count++;
+    }
+    return count;
+}
+
+static void parse_vertex_lines(const char* p, const char* end, size_t count,
+    const std::vector<int>& slots, double* values)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const char* eol = find_line_end(p, end);
+        for (int slot : slots)
+        {
+            double value = 0.0;
+            p = parse_double(p, eol, value);
+            if (slot != SLOT_NONE)
+                values[slot] = value;
+        }
+        values += NUM_VERTEX_SLOTS;
+        p = (eol < end) ? eol + 1 : end;
+    }
+}
+
+// quads parsed from one chunk of the face block, stitched together in file order afterwards
+struct FaceChunk
+{
+    std::vector<unsigned int> indices;
+    std::vector<unsigned int> ids;
+    std::string messages; // warnings are printed after the chunks are joined, so they stay in order
+};
+
+static void parse_face_lines(const char* p, const char* end, size_t first_face, size_t count,
+    size_t num_vertices, FaceChunk& out)
+{
+    out.indices.reserve(count * 4);
+    out.ids.reserve(count);
+    for (size_t i = first_face; i < first_face + count; i++)
+    {
+        const char* eol = find_line_end(p, end);
+        long long n = 0;
+        p = parse_integer(p, eol, n);
+        if (n != 4)
+        {
+            out.messages += "Skipping non-quad face" + std::to_string(i) + " with " + std::to_string(n) + " vertices.\n";
+        }
+        else
+        {
+            unsigned int verts[4];
+            bool valid = true;
+            for (int j = 0; j < 4; j++)
+            {
+                long long vid = -1;
+                p = parse_integer(p, eol, vid);
+                if (vid < 0 || static_cast<size_t>(vid) >= num_vertices)
+                {
+                    out.messages += "Invalid vertex index in face" + std::to_string(i) + ".\n";
+                    valid = false;
+                    break;
+                }
+                verts[j] = static_cast<unsigned int>(vid);
+            }
+
+            if (valid)
+            {
+                out.indices.insert(out.indices.end(), verts, verts + 4);
+                out.ids.push_back(static_cast<unsigned int>(i));
+            }
+        }
+        p = (eol < end) ? eol + 1 : end;
+    }
+}
+
+// a newline aligned piece of the ASCII body and the file line it starts on
+struct LineChunk
+{
+    const char* begin;
+    const char* end;
+    size_t first_line;
+    size_t num_lines;
+};
+
+static std::vector<LineChunk> split_lines(const char* begin, const char* end)
+{
+    // small bodies are parsed on the calling thread, large ones get a few chunks per thread for balance
+    const size_t min_chunk_bytes = size_t(1) << 20;
+    size_t bytes = static_cast<size_t>(end - begin);
+    size_t num_chunks = std::min<size_t>(4 * num_worker_threads(), std::max<size_t>(1, bytes / min_chunk_bytes));
+
+    std::vector<LineChunk> chunks;
+    const char* p = begin;
+    for (size_t c = 0; c < num_chunks && p < end; c++)
+    {
+        const char* chunk_end = end;
+        if (c + 1 < num_chunks)
+        {
+            // move the boundary forward to the start of the next line
+            chunk_end = std::max(p, begin + bytes * (c + 1) / num_chunks);
+            chunk_end = find_line_end(chunk_end, end);
+            if (chunk_end < end)
+                chunk_end++;
+        }
+        chunks.push_back({ p, chunk_end, 0, 0 });
+        p = chunk_end;
+    }
+
+    parallel_for_chunks(chunks.size(), [&](size_t c)
+    {
+        chunks[c].num_lines = count_lines(chunks[c].begin, chunks[c].end);
+    });
+
+    size_t first_line = 0;
+    for (LineChunk& chunk : chunks)
+    {
+        chunk.first_line = first_line;
+        first_line += chunk.num_lines;
+    }
+    return chunks;
+}
+
+// calls fn(chunk, first_line_ptr, chunk_end, first_index, count) in parallel for the lines of
+// [first, first + count) that fall inside each chunk, first_index is relative to first
+template <typename Function>
+static void for_each_chunk(const std::vector<LineChunk>& chunks, size_t first, size_t count, Function fn)
+{
+    parallel_for_chunks(chunks.size(), [&](size_t c)
+    {
+        const LineChunk& chunk = chunks[c];
+        size_t lo = std::max(first, chunk.first_line);
+        size_t hi = std::min(first + count, chunk.first_line + chunk.num_lines);
+        if (lo >= hi)
+            return;
+        const char* p = skip_lines(chunk.begin, chunk.end, lo - chunk.first_line);
+        fn(c, p, chunk.end, lo - first, hi - lo);
+    });
+}
+
+static bool read_ascii_body(const PlyHeader& header, const char* data, size_t size, PlyData& ply, bool read_faces)
+{
+    // count the lines in each chunk of the body up front, so every element knows
+    // which chunks its lines fall in and they can all be parsed independently
+    std::vector<LineChunk> chunks = split_lines(data + header.body_offset, data + size);
+    size_t total_lines = chunks.empty() ? 0 : chunks.back().first_line + chunks.back().num_lines;
+
+    size_t line = 0;
+    for (const PlyElement& element : header.elements)
+    {
+        if (element.name == "vertex")
+        {
+            if (line + element.count > total_lines)
+            {
+                std::cout << "Unexpected end of file while reading vertices." << std::endl;
+                return false;
+            }
+
+            // destination slot for each column on a vertex line, SLOT_NONE columns are skipped
+            std::vector<int> slots;
+            for (const PlyProperty& prop : element.properties)
+                slots.push_back(prop.slot);
+
+            ply.num_vertices = element.count;
+            ply.vertex_values.assign(element.count * NUM_VERTEX_SLOTS, 0.0);
+            for_each_chunk(chunks, line, element.count, [&](size_t, const char* p, const char* end, size_t first, size_t count)
+            {
+                parse_vertex_lines(p, end, count, slots, &ply.vertex_values[first * NUM_VERTEX_SLOTS]);
+            });
+            if (!read_faces)
+                return true;
+        }
+        else if (element.name == "face")
+        {
+            std::vector<FaceChunk> faces(chunks.size());
+            for_each_chunk(chunks, line, element.count, [&](size_t c, const char* p, const char* end, size_t first, size_t count)
+            {
+                parse_face_lines(p, end, first, count, ply.num_vertices, faces[c]);
+            });
+
+            // stitch the chunks back together in file order
+            size_t num_quads = 0;
+            for (const FaceChunk& chunk : faces)
+                num_quads += chunk.ids.size();
+            ply.face_indices.reserve(num_quads * 4);
+            ply.face_ids.reserve(num_quads);
+            for (const FaceChunk& chunk : faces)
+            {
+                std::cout << chunk.messages;
+                ply.face_indices.insert(ply.face_indices.end(), chunk.indices.begin(), chunk.indices.end());
+                ply.face_ids.insert(ply.face_ids.end(), chunk.ids.begin(), chunk.ids.end());
+            }
+
+            if (line + element.count > total_lines)
+            {
+                std::cout << "Unexpected end of file while reading faces." << std::endl;
+                return false;
+            }
+        }
+        // other elements are skipped, one line per record
+        line += element.count;
+    }
+    return true;
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Attribute Columns
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+// integers wider than 16 bits do not fit a float exactly, so they are kept as doubles
+static AttributeType column_type(PlyType type)
+{
+    switch (type)
+    {
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float64:
+        return AttributeType::Float64;
+    default:
+        return AttributeType::Float32;
+    }
+}
+
+// the narrowest column type that holds every slot property of the vertex element
+static AttributeType slot_type(const PlyHeader& header)
+{
+    for (const PlyElement& element : header.elements)
+    {
+        if (element.name != "vertex")
+            continue;
+        for (const PlyProperty& prop : element.properties)
+        {
+            if (prop.slot != SLOT_NONE && column_type(prop.type) == AttributeType::Float64)
+                return AttributeType::Float64;
+        }
+        return AttributeType::Float32;
+    }
+    return AttributeType::Float64;
+}
+
+// the value in column `token` of each vertex line
+static void parse_column_lines(const char* p, const char* end, size_t count, size_t token, double* values)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const char* eol = find_line_end(p, end);
+        for (size_t k = 0; k < token; k++)
+            p = skip_token(skip_blanks(p, eol), eol);
+        parse_double(p, eol, values[i]);
+        p = (eol < end) ? eol + 1 : end;
+    }
+}
+
+// the file attribute columns were found in, reopened when a column is first used so
+// no mapping is held in between, a file that changed since is not decoded
+struct ColumnSource
+{
+    std::string filename;
+    size_t size = 0;
+    std::filesystem::file_time_type modified;
+};
+
+static bool column_source(const char* filename, size_t size, ColumnSource& source)
+{
+    std::error_code error;
+    source.filename = filename;
+    source.size = size;
+    source.modified = std::filesystem::last_write_time(filename, error);
+    return !error;
+}
+
+static bool source_unchanged(const ColumnSource& source, const MappedFile& file)
+{
+    std::error_code error;
+    std::filesystem::file_time_type modified = std::filesystem::last_write_time(source.filename, error);
+    if (file.is_open() && file.size() == source.size && !error && modified == source.modified)
+        return true;
+    std::cout << "Attribute columns of " << source.filename << " not read, the file changed since it was opened" << std::endl;
+    return false;
+}
+
+// a column for every vertex property without a slot, reading from the file when first used
+static void add_attribute_columns(const PlyHeader& header, const ColumnSource& source,
+    AttributeTable& attributes)
+{
+    const bool swap = (header.format == PlyFormat::BinaryLittleEndian) != host_is_little_endian();
+    size_t lines_before = 0;                   // ASCII: body lines of the elements before the vertices
+    size_t bytes_before = header.body_offset;  // binary: where the vertex records start
+    for (const PlyElement& element : header.elements)
+    {
+        if (element.name != "vertex")
+        {
+            lines_before += element.count;
+            if (element.stride == 0)
+                bytes_before = SIZE_MAX; // records of unknown size, binary columns cannot be found
+            else if (bytes_before != SIZE_MAX && element.count <= (SIZE_MAX - bytes_before) / element.stride)
+                bytes_before += element.count * element.stride;
+            else
+                bytes_before = SIZE_MAX;
+            continue;
+        }
+
+        for (size_t k = 0; k < element.properties.size(); k++)
+        {
+            const PlyProperty& prop = element.properties[k];
+            if (prop.is_list || prop.slot != SLOT_NONE)
+                continue;
+
+            AttributeColumn::Decoder decoder;
+            if (header.format == PlyFormat::Ascii)
+            {
+                const size_t body_offset = header.body_offset;
+                decoder = [source, body_offset, lines_before, k](std::vector<double>& values)
+                {
+                    MappedFile file(source.filename.c_str());
+                    if (!source_unchanged(source, file))
+                        return false;
+                    const char* data = file.data();
+                    std::vector<LineChunk> chunks = split_lines(data + body_offset, data + file.size());
+                    size_t total_lines = chunks.empty() ? 0 : chunks.back().first_line + chunks.back().num_lines;
+                    if (lines_before + values.size() > total_lines)
+                        return false;
+                    for_each_chunk(chunks, lines_before, values.size(), [&](size_t, const char* p, const char* end, size_t first, size_t count)
+                    {
+                        parse_column_lines(p, end, count, k, &values[first]);
+                    });
+                    return true;
+                };
+            }
+            else
+            {
+                if (bytes_before == SIZE_MAX || element.stride == 0)
+                    continue;
+                const size_t start = bytes_before + prop.offset;
+                const size_t stride = element.stride;
+                const PlyType type = prop.type;
+                decoder = [source, start, stride, type, swap](std::vector<double>& values)
+                {
+                    if (values.empty())
+                        return true;
+                    MappedFile file(source.filename.c_str());
+                    if (!source_unchanged(source, file))
+                        return false;
+                    if (start + (values.size() - 1) * stride + ply_type_size(type) > file.size())
+                        return false;
+                    parallel_for(values.size(), [&](size_t begin, size_t end)
+                    {
+                        const char* record = file.data() + start + begin * stride;
+                        for (size_t i = begin; i < end; i++, record += stride)
+                            values[i] = load_double(record, type, swap);
+                    }, 64 * 1024);
+                    return true;
+                };
+            }
+            attributes.add(std::make_shared<AttributeColumn>(prop.name, column_type(prop.type),
+                element.count, std::move(decoder)));
+        }
+        return;
+    }
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// File Reading
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+bool read_ply_file(const char* filename, PlyData& ply, bool read_faces)
+{
+    // map the whole file into memory, the OS pages it in as we go
+    MappedFile file(filename);
+    return read_ply_file(file, filename, ply, read_faces);
+}
+
+bool read_ply_file(const MappedFile& file, const char* filename, PlyData& ply, bool read_faces)
+{
+    ply = PlyData();
+    if (!file.is_open())
+    {
+        std::cout << "Could not open .ply file: " << filename << std::endl;
+        return false;
+    }
+
+    PlyHeader header;
+    if (!parse_ply_header(file.data(), file.size(), header))
+    {
+        std::cout << "Could not read .ply file: " << filename << std::endl;
+        return false;
+    }
+
+    bool ok;
+    if (header.format == PlyFormat::Ascii)
+        ok = read_ascii_body(header, file.data(), file.size(), ply, read_faces);
+    else
+        ok = read_binary_body(header, file.data(), file.size(), ply, read_faces);
+    if (ok)
+    {
+        ply.slot_type = slot_type(header);
+        ColumnSource source;
+        if (column_source(filename, file.size(), source))
+            add_attribute_columns(header, source, ply.attributes);
+    }
+    return ok;
+}
+
+bool read_ply_attributes(const MappedFile& file, const char* filename, AttributeTable& attributes)
+{
+    attributes.clear();
+    PlyHeader header;
+    ColumnSource source;
+    if (!file.is_open() || !parse_ply_header(file.data(), file.size(), header) ||
+        !column_source(filename, file.size(), source))
+        return false;
+    add_attribute_columns(header, source, attributes);
+    return true;
+}
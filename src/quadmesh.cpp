@@ -1,10 +1,14 @@
 #include "quadmesh.h"
+#include "plyreader.h"
+#include "meshcache.h"
+#include "mappedfile.h"
+#include "parallel.h"
 #include <iostream>
 
-#include <fstream>
-#include <sstream>
 #include <map>
 #include <algorithm>
+#include <limits>
+#include <type_traits>
 
 ;///////////////////////////////////////////////////////////////////////////////
 ;///////////////////////////////////////////////////////////////////////////////
@@ -14,118 +18,44 @@
 ;///////////////////////////////////////////////////////////////////////////////
 ;///////////////////////////////////////////////////////////////////////////////
 
-Vertex::Vertex(unsigned int id, const glm::dvec3& position, const glm::dvec3& normal,
-        const double scalar, const glm::dvec3& vector, const glm::dmat2x2& tensor)
-{
-    m_id = id;
-    m_position = position;
-    m_normal = normal;
-    m_offset = glm::dvec3(0.0f);
-    m_scalar = scalar;
-    m_vector = vector;
-    m_tensor = tensor;
-    
-}
-Vertex::~Vertex() {}
-
-unsigned int Vertex::id() const { return m_id; }
-glm::dvec3 Vertex::pos() const { return m_position; }
-glm::dvec3 Vertex::normal() const { return m_normal; }
-double Vertex::scalar() const { return m_scalar; }
-glm::dvec3 Vertex::vector() const { return m_vector; }
-glm::dmat2x2 Vertex::tensor() const { return m_tensor; }
-
-void Vertex::set_pos(const glm::dvec3& p) { m_position = p; }
-void Vertex::set_normal(const glm::dvec3& n) { m_normal = n; }
-void Vertex::set_scalar(double s) { m_scalar = s; }
-void Vertex::set_vector(const glm::dvec3& v) { m_vector = v; }
-void Vertex::set_tensor(const glm::dmat2x2& t) { m_tensor = t; }
-
-void Vertex::add_edge(const std::shared_ptr<Edge> e) { m_edges.push_back(e); }
-void Vertex::add_face(const std::shared_ptr<Face> f) { m_faces.push_back(f); }
-const std::vector<std::shared_ptr<Edge>>& Vertex::edges() const { return m_edges; }
-const std::vector<std::shared_ptr<Face>>& Vertex::faces() const { return m_faces; }
-std::vector<std::shared_ptr<Edge>>& Vertex::edges() { return m_edges; }
-std::vector<std::shared_ptr<Face>>& Vertex::faces() { return m_faces; }
-size_t Vertex::num_edges() const { return m_edges.size(); }
-size_t Vertex::num_faces() const { return m_faces.size(); }
+unsigned int Vertex::id() const { return m_mesh->vertex_id(m_index); }
+glm::dvec3 Vertex::pos() const { return m_mesh->position(m_index); }
+glm::dvec3 Vertex::normal() const { return m_mesh->normal(m_index); }
+double Vertex::scalar() const { return m_mesh->scalar(m_index); }
+glm::dvec3 Vertex::vector() const { return m_mesh->vector(m_index); }
 
-void Vertex::compute_average_normal() 
+std::vector<Face> Vertex::faces() const
 {
-    glm::dvec3 sum_normals(0.0, 0.0, 0.0);
-    for (const auto& face : m_faces) 
+    std::vector<Face> result;
+    m_mesh->for_each_ring_half(m_index, [&](uint32_t h)
     {
-        sum_normals += face->normal();
-    }
-    if (!m_faces.empty()) 
-    {
-        m_normal = glm::normalize(sum_normals / static_cast<double>(m_faces.size()));
-    }
+        result.emplace_back(m_mesh, HalfEdgeMesh::face_of(h));
+    });
+    return result;
 }
 
-void Vertex::reorder_pointers()
+std::vector<Edge> Vertex::edges() const
 {
-    std::vector<std::shared_ptr<Face>> forward_faces;
-    std::vector<std::shared_ptr<Face>> backward_faces;
-    std::vector<std::shared_ptr<Edge>> forward_edges;
-    std::vector<std::shared_ptr<Edge>> backward_edges;
-
-    std::shared_ptr<Face> start_face = m_faces[0];
-    std::shared_ptr<Face> face = m_faces[0];
-    std::shared_ptr<Edge> edge = nullptr;
-	forward_faces.push_back(start_face);
-
-    // march forward around the vertex (clockwise around the faces)
-    while (face)
+    std::vector<Edge> result;
+    if (m_mesh->ring_is_open(m_index))
+        result.emplace_back(m_mesh, m_mesh->half_edge[m_mesh->vertex_half[m_index]]);
+    m_mesh->for_each_ring_half(m_index, [&](uint32_t h)
     {
-        auto it = std::find(face->vertices().begin(), face->vertices().end(), shared_from_this());
-        int idx = static_cast<int>(std::distance(face->vertices().begin(), it));
-        edge = face->edges()[(idx + 3) % 4]; // edge before this vertex in face
-        forward_edges.push_back(edge);
-        face = edge->other_face(face);
-        if (face == start_face) break; 
-        if (face) forward_faces.push_back(face);
-    }
-    
-    if (face == start_face) // already a closed loop, just copy forward lists to main lists
-    {
-        m_faces = forward_faces;
-        m_edges = forward_edges;
-		return;
-    }
-
-	// march backward around the vertex (counter-clockwise around the faces)
-    face = start_face;
-    edge = nullptr;
-    while (face)
-    {
-        auto it = std::find(face->vertices().begin(), face->vertices().end(), shared_from_this());
-        int idx = static_cast<int>(std::distance(face->vertices().begin(), it));
-        edge = face->edges()[idx]; // edge after this vertex in face
-        backward_edges.push_back(edge);
-        face = edge->other_face(face);
-		if (face == start_face) break;
-        if (face) backward_faces.push_back(face);
-    }
-
-    // combine forward and backward lists
-    std::reverse(backward_faces.begin(), backward_faces.end());
-    std::reverse(backward_edges.begin(), backward_edges.end());
-    m_faces = backward_faces;
-    m_faces.insert(m_faces.end(), forward_faces.begin(), forward_faces.end());
-    m_edges = backward_edges;
-    m_edges.insert(m_edges.end(), forward_edges.begin(), forward_edges.end());
+        result.emplace_back(m_mesh, m_mesh->half_edge[HalfEdgeMesh::prev(h)]);
+    });
+    return result;
 }
 
-void Vertex::offset_position(const glm::dvec3& offset){
-    m_offset += offset;
-    m_position += offset;
-
+size_t Vertex::num_faces() const
+{
+    size_t count = 0;
+    m_mesh->for_each_ring_half(m_index, [&](uint32_t) { count++; });
+    return count;
 }
 
-void Vertex::reset_position(){
-    m_position -= m_offset;
-    m_offset -= glm::dvec3(0.0);
+size_t Vertex::num_edges() const
+{
+    return (m_mesh->ring_is_open(m_index) ? 1 : 0) + num_faces();
 }
 
 
@@ -137,74 +67,51 @@ void Vertex::reset_position(){
 ;///////////////////////////////////////////////////////////////////////////////
 ;///////////////////////////////////////////////////////////////////////////////
 
-Edge::Edge(unsigned int id, const std::shared_ptr<Vertex> v1, const std::shared_ptr<Vertex> v2)
-{
-    m_id = id;
-    m_v1 = v1;
-    m_v2 = v2;
-}
-Edge::~Edge() {}
-
-unsigned int Edge::id() const { return m_id; }
-const std::shared_ptr<Vertex> Edge::v1() const { return m_v1; }
-const std::shared_ptr<Vertex> Edge::v2() const { return m_v2; }
-std::shared_ptr<Vertex> Edge::v1() { return m_v1; }
-std::shared_ptr<Vertex> Edge::v2() { return m_v2; }
-const std::vector<std::shared_ptr<Face>>& Edge::faces() const { return m_faces; }
-std::vector<std::shared_ptr<Face>>& Edge::faces() { return m_faces; }
-size_t Edge::num_faces() const { return m_faces.size(); }
-void Edge::add_face(const std::shared_ptr<Face> f) { m_faces.push_back(f);}
+unsigned int Edge::id() const { return m_index; }
+Vertex Edge::v1() const { return Vertex(m_mesh, m_mesh->edge_vertices[2 * m_index]); }
+Vertex Edge::v2() const { return Vertex(m_mesh, m_mesh->edge_vertices[2 * m_index + 1]); }
 
-const std::shared_ptr<Vertex> Edge::other_vertex(const std::shared_ptr<Vertex> v) const
+Vertex Edge::other_vertex(const Vertex& v) const
 {
-    if (v == m_v1) 
-        return m_v2;
-    else 
-        return m_v1;
+    if (v == v1())
+        return v2();
+    else
+        return v1();
 }
 
-std::shared_ptr<Vertex> Edge::other_vertex(const std::shared_ptr<Vertex> v) 
+std::vector<Face> Edge::faces() const
 {
-    if (v == m_v1) 
-        return m_v2;
-    else 
-        return m_v1;
+    std::vector<Face> result;
+    uint32_t h = m_mesh->edge_half[m_index];
+    if (h == HalfEdgeMesh::INVALID)
+        return result;
+    result.emplace_back(m_mesh, HalfEdgeMesh::face_of(h));
+    if (m_mesh->half_twin[h] != HalfEdgeMesh::INVALID)
+        result.emplace_back(m_mesh, HalfEdgeMesh::face_of(m_mesh->half_twin[h]));
+    return result;
 }
 
-const std::shared_ptr<Face> Edge::other_face(const std::shared_ptr<Face> f) const
+size_t Edge::num_faces() const
 {
-    std::shared_ptr<Face> result = nullptr;
-    if (m_faces.size() == 2) 
-    {
-        if (f == m_faces[0]) 
-            return m_faces[1];
-        else 
-            return m_faces[0];
-    }
-    return result;
+    uint32_t h = m_mesh->edge_half[m_index];
+    if (h == HalfEdgeMesh::INVALID)
+        return 0;
+    return (m_mesh->half_twin[h] == HalfEdgeMesh::INVALID) ? 1 : 2;
 }
 
-std::shared_ptr<Face> Edge::other_face(const std::shared_ptr<Face> f)
+Face Edge::other_face(const Face& f) const
 {
-    std::shared_ptr<Face> result = nullptr;
-    if (m_faces.size() == 2) 
-    {
-        if (f == m_faces[0]) 
-            return m_faces[1];
-        else 
-            return m_faces[0];
-    }
-    return result;
+    uint32_t h = m_mesh->edge_half[m_index];
+    if (h == HalfEdgeMesh::INVALID || m_mesh->half_twin[h] == HalfEdgeMesh::INVALID)
+        return nullptr;
+    uint32_t a = HalfEdgeMesh::face_of(h);
+    uint32_t b = HalfEdgeMesh::face_of(m_mesh->half_twin[h]);
+    return Face(m_mesh, (f.index() == a) ? b : a);
 }
 
-double Edge::length() const 
+double Edge::length() const
 {
-    if (m_v1 && m_v2) 
-    {
-        return glm::length(m_v2->pos() - m_v1->pos());
-    }
-    else
-        return 0.0;
+    return glm::length(v2().pos() - v1().pos());
 }
 
 
@@ -217,57 +124,44 @@ double Edge::length() const
 ;///////////////////////////////////////////////////////////////////////////////
 ;///////////////////////////////////////////////////////////////////////////////
 
-Face::Face(unsigned int id, const std::vector<std::shared_ptr<Vertex>>& vertices)
-{
-    m_id = id;
-    m_vertices = vertices;
-    m_normal = glm::dvec3(0.0, 0.0, 0.0);
-    m_color = glm::dvec4(1.0, 1.0, 1.0, 1.0);
+unsigned int Face::id() const { return m_mesh->face_ids[m_index]; }
+uint32_t Face::index() const { return m_index; }
+glm::dvec3 Face::normal() const { return m_mesh->face_normal(m_index); }
+size_t Face::num_vertices() const { return 4; }
+size_t Face::num_edges() const { return 4; }
 
-    // Edges should be set separately after construction
+std::array<Vertex, 4> Face::vertices() const
+{
+    const uint32_t* corners = &m_mesh->half_vertex[4 * size_t(m_index)];
+    return { Vertex(m_mesh, corners[0]), Vertex(m_mesh, corners[1]),
+             Vertex(m_mesh, corners[2]), Vertex(m_mesh, corners[3]) };
 }
-Face::~Face() {}
-
-unsigned int Face::id() const { return m_id; }
-glm::dvec3 Face::normal() const { return m_normal; }
-glm::dvec4 Face::color() const { return m_color; }
-const std::vector<std::shared_ptr<Vertex>>& Face::vertices() const { return m_vertices; }
-const std::vector<std::shared_ptr<Edge>>& Face::edges() const { return m_edges; }
-std::vector<std::shared_ptr<Vertex>>& Face::vertices() { return m_vertices; }
-std::vector<std::shared_ptr<Edge>>& Face::edges() { return m_edges; }
-size_t Face::num_vertices() const { return m_vertices.size(); }
-size_t Face::num_edges() const { return m_edges.size(); }
-
-void Face::set_color(const glm::dvec4& c) { m_color = c; }
 
-void Face::compute_normal()
+std::array<Edge, 4> Face::edges() const
 {
-    // Assumes quad vertices are ordered and co-planar
-    if (m_vertices.size() >= 3) 
-    {
-        glm::dvec3 v0 = m_vertices[0]->pos();
-        glm::dvec3 v1 = m_vertices[1]->pos();
-        glm::dvec3 v2 = m_vertices[2]->pos();
-        m_normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
-    }
+    const uint32_t* edges = &m_mesh->half_edge[4 * size_t(m_index)];
+    return { Edge(m_mesh, edges[0]), Edge(m_mesh, edges[1]),
+             Edge(m_mesh, edges[2]), Edge(m_mesh, edges[3]) };
 }
 
 const glm::dvec3 Face::centroid() const 
 {
+    const uint32_t* corners = &m_mesh->half_vertex[4 * size_t(m_index)];
     glm::dvec3 sum(0.0, 0.0, 0.0);
-    for (const auto& v : m_vertices) 
-        sum += v->pos();
-    return sum / static_cast<double>(m_vertices.size());
+    for (int k = 0; k < 4; k++)
+        sum += m_mesh->position(corners[k]);
+    return sum / 4.0;
 }
 
 bool Face::contains_xy_point(const glm::dvec3& point) const
 {
     // Project vertex coordinates to XY plane
+    const uint32_t* corners = &m_mesh->half_vertex[4 * size_t(m_index)];
     glm::dvec2 p(point.x, point.y);
-    glm::dvec2 v0(m_vertices[0]->pos().x, m_vertices[0]->pos().y);
-    glm::dvec2 v1(m_vertices[1]->pos().x, m_vertices[1]->pos().y);
-    glm::dvec2 v2(m_vertices[2]->pos().x, m_vertices[2]->pos().y);
-    glm::dvec2 v3(m_vertices[3]->pos().x, m_vertices[3]->pos().y);
+    glm::dvec2 v0(m_mesh->position(corners[0]));
+    glm::dvec2 v1(m_mesh->position(corners[1]));
+    glm::dvec2 v2(m_mesh->position(corners[2]));
+    glm::dvec2 v3(m_mesh->position(corners[3]));
 
     // use cross products to determine if the point is on one side or the other of each edge
     auto cross_differences = [](const glm::dvec2& p1, const glm::dvec2& p2, const glm::dvec2& p3) 
@@ -283,42 +177,39 @@ bool Face::contains_xy_point(const glm::dvec3& point) const
     return ((b1 == b2) && (b2 == b3) && (b3 == b4));
 }
 
-glm::dvec3 Face::bilinear_interpolate_xy_vector(const glm::dvec3& point) const
+double Face::squared_xy_distance(const glm::dvec3& point) const
 {
-    // Assumes the quad is an x-y aligned square and assumes point is inside the quad
-    double x1, x2, y1, y2;
-    glm::dvec3 v11, v12, v21, v22;
-    x1 = m_vertices[0]->pos().x;
-    x2 = m_vertices[0]->pos().x;
-    y1 = m_vertices[0]->pos().y;
-    y2 = m_vertices[0]->pos().y;
-
-    // find min and max x and y from vertices
-    for (const auto& v : m_vertices)
-    {
-        if (v->pos().x < x1) x1 = v->pos().x;
-        if (v->pos().x > x2) x2 = v->pos().x;
-        if (v->pos().y < y1) y1 = v->pos().y;
-        if (v->pos().y > y2) y2 = v->pos().y;
-    }
+    if (contains_xy_point(point))
+        return 0.0;
 
-    // find the vectors at each corner
-    for (const auto& v : m_vertices)
+    // nearest point on each edge
+    const uint32_t* corners = &m_mesh->half_vertex[4 * size_t(m_index)];
+    glm::dvec2 p(point.x, point.y);
+    double result = std::numeric_limits<double>::infinity();
+    for (int k = 0; k < 4; k++)
     {
-        if (v->pos().x == x1 && v->pos().y == y1) v11 = v->vector();
-        else if (v->pos().x == x1 && v->pos().y == y2) v12 = v->vector();
-        else if (v->pos().x == x2 && v->pos().y == y1) v21 = v->vector();
-        else if (v->pos().x == x2 && v->pos().y == y2) v22 = v->vector();
+        glm::dvec2 a(m_mesh->position(corners[k]));
+        glm::dvec2 b(m_mesh->position(corners[(k + 1) & 3]));
+        glm::dvec2 ab = b - a;
+        double length2 = glm::dot(ab, ab);
+        double t = (length2 > 0.0) ? std::clamp(glm::dot(p - a, ab) / length2, 0.0, 1.0) : 0.0;
+        glm::dvec2 d = p - (a + t * ab);
+        result = std::min(result, glm::dot(d, d));
     }
+    return result;
+}
 
-    // do the interpolation
-    double x = point.x;
-    double y = point.y;
-    glm::dvec3 vxy = ((x2 - x) * (y2-y) * v11 +
-                      (x2 - x) * (y - y1) * v12 +
-                      (x - x1) * (y2 - y) * v21 +
-                      (x - x1) * (y - y1) * v22) /
-                     ((x2 - x1) * (y2 - y1));
+glm::dvec3 Face::bilinear_interpolate_xy_vector(const glm::dvec3& point) const
+{
+    // the local coordinates of point under the bilinear map of the corners, which
+    // works for any convex quad, see FaceInterpolation
+    const uint32_t* corners = &m_mesh->half_vertex[4 * size_t(m_index)];
+    const glm::dvec2 positions[4] = { glm::dvec2(m_mesh->position(corners[0])), glm::dvec2(m_mesh->position(corners[1])),
+                                      glm::dvec2(m_mesh->position(corners[2])), glm::dvec2(m_mesh->position(corners[3])) };
+    double w[4];
+    FaceInterpolation::weights(FaceInterpolation::local_coordinates(FaceInterpolation::quad(positions), glm::dvec2(point)), w);
+    glm::dvec3 vxy = w[0] * m_mesh->vector(corners[0]) + w[1] * m_mesh->vector(corners[1]) +
+                     w[2] * m_mesh->vector(corners[2]) + w[3] * m_mesh->vector(corners[3]);
     return glm::dvec3(vxy.x, vxy.y, 0.0);
 }
 
@@ -331,247 +222,289 @@ glm::dvec3 Face::bilinear_interpolate_xy_vector(const glm::dvec3& point) const
 ;///////////////////////////////////////////////////////////////////////////////
 ;///////////////////////////////////////////////////////////////////////////////
 
+MeshPrecision QuadMesh::s_precision = MeshPrecision::MatchFile;
+MeshLayout QuadMesh::s_layout = MeshLayout::FileOrder;
+
+void QuadMesh::set_precision(MeshPrecision precision) { s_precision = precision; }
+MeshPrecision QuadMesh::precision() const { return m_mesh.precision; }
+void QuadMesh::set_layout(MeshLayout layout) { s_layout = layout; }
+MeshLayout QuadMesh::layout() const { return m_mesh.vertex_ids.empty() ? MeshLayout::FileOrder : MeshLayout::Morton; }
 
 QuadMesh::QuadMesh()
 {
     construct_simple_quad_mesh();
 }
 
-QuadMesh::QuadMesh(const char* filename)
+QuadMesh::QuadMesh(const char* filename, bool verbose, const LoadProgress& progress, bool use_cache)
+{
+    load(filename, nullptr, verbose, progress, use_cache);
+}
+
+QuadMesh::QuadMesh(const char* filename, const PlyData& ply, bool verbose, const LoadProgress& progress)
 {
-    m_vertices.clear();
-    m_edges.clear();
-    m_faces.clear();
+    load(filename, &ply, verbose, progress);
+}
 
-    // try to open the file
-    std::ifstream file(filename);
-    if (!file)
+QuadMesh::QuadMesh(const MeshSource& source, const PlyData* ply, bool verbose, const LoadProgress& progress)
+{
+    load(source, ply, verbose, progress);
+}
+
+void QuadMesh::load(const char* filename, const PlyData* ply, bool verbose, const LoadProgress& progress,
+    bool use_cache)
+{
+    // map and hash the file once, for the cache and for reading it
+    MappedFile file(filename);
+    MeshSource source;
+    source.filename = filename;
+    if (file.is_open())
     {
-        std::cout << "Could not open .ply file: " << filename << std::endl;
-        return;
+        source.file = &file;
+        if (s_cache_enabled && use_cache)
+        {
+            if (progress)
+                progress("hashing file", 0.0);
+            source.hash = hash_bytes(file.data(), file.size());
+            source.size = file.size();
+            source.cache_path = cache_path(filename, source.hash);
+        }
     }
+    load(source, ply, verbose, progress);
+}
+
+void QuadMesh::load(const MeshSource& source, const PlyData* ply, bool verbose, const LoadProgress& progress)
+{
+    m_mesh.clear();
+    m_attributes.clear();
+    invalidate_locators();
 
-    std::string line;
-    std::getline(file, line); // read first line
-    if (line != "ply")
+    const char* filename = source.filename;
+    auto report = [&](const char* stage, double fraction)
     {
-        std::cout << "Not a valid .ply file: " << filename << std::endl;
-        return;
-    }
+        if (progress)
+            progress(stage, fraction);
+    };
 
-    std::getline(file, line); // read format line
-    if (line != "format ascii 1.0")
+    // count the array allocations made while loading, other loads running at the
+    // same time are counted too
+    const MeshAllocationStats& allocation_stats = mesh_allocation_stats();
+    const size_t allocations_before = allocation_stats.allocations.load();
+    auto print_allocations = [&]()
     {
-        std::cout << "Only ASCII .ply files are supported: " << filename << std::endl;
-        return;
-    }
+        std::cout << "Mesh array allocations while loading: "
+                  << allocation_stats.allocations.load() - allocations_before
+                  << " (" << allocation_stats.bytes_in_use.load() / (1024 * 1024)
+                  << " MB of mesh arrays in use)" << std::endl;
+    };
 
-    // File is open and seems valid, start parsing
-    size_t num_vertices = 0, num_faces = 0;
-    
-    // Parse header
-    bool header_done = false;
-    bool reading_vertex_props = false;
-    std::vector<std::string> vertex_props;
-    while (std::getline(file, line)) 
+    // reuse the topology built by an earlier load if the file has not changed since
+    if (!source.cache_path.empty() && read_mesh_cache(source.cache_path, source.hash, source.size))
     {
-        if (line.find("element vertex") == 0)
+        read_ply_attributes(*source.file, filename, m_attributes);
+        report("done", 1.0);
+        if (verbose)
         {
-            std::istringstream iss(line);
-            std::string dummy;
-            iss >> dummy >> dummy >> num_vertices;
-            reading_vertex_props = true;
+            std::cout << "Opened quad mesh from " << filename << " (cached)" << std::endl;
+            print_info();
+            print_allocations();
         }
-        else if (line.find("property") == 0 && reading_vertex_props)
-        {
-            std::istringstream iss(line);
-            std::string dummy, type, name;
-            iss >> dummy >> type >> name;
-            vertex_props.push_back(name);
-        }
-        else if (line.find("element face") == 0) 
-        {
-            std::istringstream iss(line);
-            std::string dummy;
-            iss >> dummy >> dummy >> num_faces;
-            reading_vertex_props = false;
-        } 
-        else if (line == "end_header") 
-        {
-            header_done = true;
-            break;
-        }
-    }
-    if (!header_done) 
-    {
-        std::cout << "Invalid .ply header." << std::endl;
         return;
     }
 
-    // Parse the vertices
-    double x,y,z,nx,ny,nz,s,vx,vy,vz,t00,t01,t10,t11;
-    x = y = z = nx = ny = nz = s = vx = vy = vz = t00 = t01 = t10 = t11 = 0.0;
-    for (int i = 0; i < num_vertices; ++i) 
+    // read the flattened vertex and face data from the file, unless the caller already has
+    PlyData file_contents;
+    if (!ply)
     {
-        if (!std::getline(file, line))
+        report("reading file", 0.05);
+        if (!source.file)
         {
-            std::cout << "Unexpected end of file while reading vertices." << std::endl;
+            std::cout << "Could not open .ply file: " << filename << std::endl;
             return;
         }
-
-        std::istringstream iss(line);
-        for (const std::string& prop : vertex_props) 
-        {
-            if (prop == "x") iss >> x;
-            else if (prop == "y") iss >> y;
-            else if (prop == "z") iss >> z;
-            else if (prop == "nx") iss >> nx;
-            else if (prop == "ny") iss >> ny;
-			else if (prop == "nz") iss >> nz;
-            else if (prop == "s") iss >> s;
-            else if (prop == "vx") iss >> vx;
-            else if (prop == "vy") iss >> vy;
-            else if (prop == "vz") iss >> vz;
-            else if (prop == "t00") iss >> t00;
-            else if (prop == "t01") iss >> t01;
-            else if (prop == "t10") iss >> t10;
-            else if (prop == "t11") iss >> t11;
-            // ignore unknown properties
-        }
-
-        std::shared_ptr<Vertex> v = std::make_shared<Vertex>(
-			static_cast<unsigned int>(i), glm::dvec3(x, y, z), glm::dvec3(nx, ny, nz),
-            s, glm::dvec3(vx, vy, vz), glm::dmat2x2(t00, t01, t10, t11));
-        m_vertices.push_back(v);
+        if (!read_ply_file(*source.file, filename, file_contents))
+            return;
+        ply = &file_contents;
     }
-
-    // Parse faces (should all be quads)
-    for (int i = 0; i < num_faces; i++) 
+    m_attributes = ply->attributes;
+
+    // copy the vertex values into their arrays, at the precision of the file
+    // unless a precision has been set
+    report("creating vertices", 0.3);
+    m_mesh.precision = s_precision;
+    if (s_precision == MeshPrecision::MatchFile)
+        m_mesh.precision = (ply->slot_type == AttributeType::Float32) ? MeshPrecision::Float32 : MeshPrecision::Float64;
+    const size_t nv = ply->num_vertices;
+    m_mesh.geometry([&](auto& g)
     {
-        if (!std::getline(file, line))
-        {
-            std::cout << "Unexpected end of file while reading faces." << std::endl;
-            return;
-        }
-
-        std::istringstream iss(line);
-        int n;
-        iss >> n;
-        if (n != 4)
-        {
-            std::cout << "Skipping non-quad face" << i << " with " << n << " vertices." << std::endl;
-            continue;
-        }
-
-        std::vector<std::shared_ptr<Vertex>> verts;
-        bool valid = true;
-        for (int j = 0; j < n; j++)
+        using vec3 = typename std::decay_t<decltype(g)>::vec3;
+        using real = typename std::decay_t<decltype(g)>::real;
+        g.positions.resize(nv);
+        g.normals.resize(nv);
+        g.scalars.resize(nv);
+        g.vectors.resize(nv);
+        parallel_for(nv, [&](size_t begin, size_t end)
         {
-            int vid;
-            iss >> vid;
-            if (vid < 0 || vid >= m_vertices.size())
+            for (size_t i = begin; i < end; i++)
             {
-                std::cout << "Invalid vertex index in face" << i << "." << std::endl;
-                valid = false;
-                break;
+                const double* a = &ply->vertex_values[i * NUM_VERTEX_SLOTS];
+                g.positions[i] = vec3(a[SLOT_X], a[SLOT_Y], a[SLOT_Z]);
+                g.normals[i] = vec3(a[SLOT_NX], a[SLOT_NY], a[SLOT_NZ]);
+                g.scalars[i] = static_cast<real>(a[SLOT_S]);
+                g.vectors[i] = vec3(a[SLOT_VX], a[SLOT_VY], a[SLOT_VZ]);
             }
-            else
-                verts.push_back(m_vertices[vid]);
-        }
-
-        if (valid)
-            m_faces.push_back(std::make_shared<Face>(i, verts));
+        }, 16384);
+        g.face_normals.assign(ply->face_ids.size(), vec3(0));
+    });
+
+    // the quad corners are the origins of their half-edges
+    report("creating faces", 0.4);
+    m_mesh.face_ids.assign(ply->face_ids.begin(), ply->face_ids.end());
+    m_mesh.half_vertex.assign(ply->face_indices.begin(), ply->face_indices.end());
+    if (s_layout == MeshLayout::Morton)
+    {
+        report("reordering", 0.45);
+        reorder_along_curve();
     }
 
-    // done with the file
-    file.close();
-
     // set up the rest of the mesh data structures
-    vertex_to_face_pointers();
+    report("building edges", 0.55);
     set_up_edges();
+    report("ordering vertex rings", 0.7);
     reorder_vertex_pointers();
+    report("computing normals", 0.85);
     compute_face_normals();
     average_vertex_normals();
     compute_midpoint_and_radius();
+    m_topology_hash = ::topology_hash(*ply);
+
+    if (!source.cache_path.empty())
+    {
+        report("writing cache", 0.9);
+        if (!write_mesh_cache(source, ply->slot_type == AttributeType::Float32))
+            std::cout << "Could not write mesh cache file: " << source.cache_path << std::endl;
+    }
+    report("done", 1.0);
 
-    std::cout << "Opened quad mesh from " << filename << std::endl;
-    print_info();
+    if (verbose)
+    {
+        std::cout << "Opened quad mesh from " << filename << std::endl;
+        print_info();
+        print_allocations();
+    }
 }
 
-QuadMesh::QuadMesh(const QuadMesh& base_mesh, double step_size, int num_steps)
+QuadMesh::QuadMesh(const FieldMesh& base_mesh, double step_size, int num_steps)
 {
-    m_vertices.clear();
-    m_edges.clear();
-    m_faces.clear();
-
     // create a streamline through the midpoint of each face in the base mesh
     std::vector<glm::dvec3> streamline;
-    for (const auto& face : base_mesh.faces())
+    for (size_t f = 0; f < base_mesh.num_faces(); f++)
     {
         streamline.clear();
 
         // compute the streamline starting from the face centroid
-        streamline.clear();
-        base_mesh.compute_xy_streamline(
-            streamline, face->centroid(), face,
-            step_size, num_steps);
-        if (streamline.size() < 2)
-            continue;
-        
-        
-        // add the streamline points as vertices in this mesh
-        for (const glm::dvec3& point : streamline)
-        {
-            unsigned int vert_id = static_cast<unsigned int>(m_vertices.size());
-            glm::dvec3 normal(0.0, 0.0, 1.0);
-            std::shared_ptr<Vertex> v = std::make_shared<Vertex>(vert_id, point, normal);
-            m_vertices.push_back(v);
-        }
+        base_mesh.compute_face_xy_streamline(streamline, f, step_size, num_steps);
+
+        // streamlines stay in the x-y plane, the face they start in gives the side of it
+        // a height field rises to
+        unsigned int ids[4];
+        base_mesh.face_vertices(f, ids);
+        glm::dvec3 normal(0.0);
+        for (unsigned int id : ids)
+            normal += base_mesh.vertex_normal(id);
+        add_streamline(streamline, (glm::dot(normal, normal) > 0.0) ? glm::normalize(normal) : glm::dvec3(0.0, 0.0, 1.0));
+    }
 
-        // add edges between consecutive streamline points
-        for (int i = 1; i < streamline.size(); i++)
-        {
-            auto& v1 = m_vertices.at(m_vertices.size() - i);
-            auto& v2 = m_vertices.at(m_vertices.size() - i - 1);
-
-            unsigned int edge_id = static_cast<unsigned int>(m_edges.size());
-            std::shared_ptr<Edge> e = std::make_shared<Edge>(edge_id, v1, v2);
-            m_edges.push_back(e);
-            v1->add_edge(e);
-            v2->add_edge(e);
-        }
+    // the scalars under the streamlines, for the height field; a point just off the mesh
+    // where a streamline leaves it keeps the scalar of the point before
+    MeshGeometry<double>& g = m_mesh.geometry64;
+    FieldSamples samples;
+    samples.scalars = g.scalars.data();
+    base_mesh.sample(g.positions.data(), g.positions.size(), samples);
+    double last = 0.0;
+    for (double& scalar : g.scalars)
+    {
+        if (std::isnan(scalar))
+            scalar = last;
+        last = scalar;
+    }
+}
+
+QuadMesh::QuadMesh(const std::vector<std::vector<glm::dvec3>>& streamlines)
+{
+    for (const std::vector<glm::dvec3>& streamline : streamlines)
+        add_streamline(streamline);
+}
+
+void QuadMesh::add_streamline(const std::vector<glm::dvec3>& streamline, const glm::dvec3& normal)
+{
+    if (streamline.size() < 2)
+        return;
+
+    // add the streamline points as vertices in this mesh
+    uint32_t first = static_cast<uint32_t>(m_mesh.num_vertices());
+    MeshGeometry<double>& g = m_mesh.geometry64;
+    for (const glm::dvec3& point : streamline)
+    {
+        g.positions.push_back(point);
+        g.normals.push_back(normal);
+        g.scalars.push_back(0.0);
+        g.vectors.push_back(glm::dvec3(0.0));
+        m_mesh.vertex_half.push_back(HalfEdgeMesh::INVALID);
+    }
+
+    // add edges between consecutive streamline points, from the end back
+    uint32_t last = static_cast<uint32_t>(m_mesh.num_vertices()) - 1;
+    for (uint32_t v = last; v > first; v--)
+    {
+        m_mesh.edge_vertices.push_back(v);
+        m_mesh.edge_vertices.push_back(v - 1);
+        m_mesh.edge_half.push_back(HalfEdgeMesh::INVALID);
     }
 }
 
 QuadMesh::~QuadMesh() {}
 
-const std::vector<std::shared_ptr<Vertex>>& QuadMesh::vertices() const { return m_vertices; }
-const std::vector<std::shared_ptr<Edge>>& QuadMesh::edges() const { return m_edges; }
-const std::vector<std::shared_ptr<Face>>& QuadMesh::faces() const { return m_faces; }
-size_t QuadMesh::num_vertices() const { return m_vertices.size(); }
-size_t QuadMesh::num_edges() const { return m_edges.size(); }
-size_t QuadMesh::num_faces() const { return m_faces.size(); }
+ElementRange<Vertex> QuadMesh::vertices() const { return ElementRange<Vertex>(&m_mesh, m_mesh.num_vertices()); }
+ElementRange<Edge> QuadMesh::edges() const { return ElementRange<Edge>(&m_mesh, m_mesh.num_edges()); }
+ElementRange<Face> QuadMesh::faces() const { return ElementRange<Face>(&m_mesh, m_mesh.num_faces()); }
+const HalfEdgeMesh& QuadMesh::half_edge_mesh() const { return m_mesh; }
+size_t QuadMesh::num_vertices() const { return m_mesh.num_vertices(); }
+size_t QuadMesh::num_edges() const { return m_mesh.num_edges(); }
+size_t QuadMesh::num_faces() const { return m_mesh.num_faces(); }
 glm::dvec3 QuadMesh::midpoint() const { return m_midpoint; }
 double QuadMesh::get_radius() const { return radius; }
 
+glm::dvec3 QuadMesh::vertex_position(size_t v) const { return m_mesh.position(m_mesh.vertex_of_id(static_cast<uint32_t>(v))); }
+glm::dvec3 QuadMesh::vertex_normal(size_t v) const { return m_mesh.normal(m_mesh.vertex_of_id(static_cast<uint32_t>(v))); }
+double QuadMesh::vertex_scalar(size_t v) const { return m_mesh.scalar(m_mesh.vertex_of_id(static_cast<uint32_t>(v))); }
+glm::dvec3 QuadMesh::vertex_vector(size_t v) const { return m_mesh.vector(m_mesh.vertex_of_id(static_cast<uint32_t>(v))); }
+const AttributeTable& QuadMesh::attributes() const { return m_attributes; }
+AttributeTable& QuadMesh::attributes() { return m_attributes; }
+
+void QuadMesh::edge_vertices(size_t e, unsigned int ids[2]) const
+{
+    ids[0] = m_mesh.vertex_id(m_mesh.edge_vertices[2 * e]);
+    ids[1] = m_mesh.vertex_id(m_mesh.edge_vertices[2 * e + 1]);
+}
+
+void QuadMesh::face_vertices(size_t f, unsigned int ids[4]) const
+{
+    for (int k = 0; k < 4; k++)
+        ids[k] = m_mesh.vertex_id(m_mesh.half_vertex[4 * f + k]);
+}
+
 void QuadMesh::compute_midpoint_and_radius()
 {
-    if (m_vertices.empty()) 
+    if (m_mesh.num_vertices() == 0) 
     {
         m_midpoint = glm::dvec3(0.0, 0.0, 0.0);
         radius = 0.0;
         return;
     }
 
-    glm::dvec3 min_pt = m_vertices[0]->pos();
-    glm::dvec3 max_pt = m_vertices[0]->pos();
-
-    for (const auto& v : m_vertices) 
-    {
-        glm::dvec3 pos = v->pos();
-        min_pt = glm::min(min_pt, pos);
-        max_pt = glm::max(max_pt, pos);
-    }
+    MeshStatistics stats = statistics();
+    glm::dvec3 min_pt = stats.min_position;
+    glm::dvec3 max_pt = stats.max_position;
 
     m_midpoint = 0.5 * (min_pt + max_pt);
     radius = 0.5 * glm::length(max_pt - min_pt);
@@ -579,18 +512,18 @@ void QuadMesh::compute_midpoint_and_radius()
 
 void QuadMesh::construct_simple_quad_mesh()
 {
-    m_vertices.clear();
-    std::shared_ptr<Vertex> v0 = std::make_shared<Vertex>(0, glm::dvec3(-1.0, -1.0, 0.0));
-    std::shared_ptr<Vertex> v1 = std::make_shared<Vertex>(1, glm::dvec3( 1.0, -1.0, 0.0));
-    std::shared_ptr<Vertex> v2 = std::make_shared<Vertex>(2, glm::dvec3( 1.0,  1.0, 0.0));
-    std::shared_ptr<Vertex> v3 = std::make_shared<Vertex>(3, glm::dvec3(-1.0,  1.0, 0.0));
-    m_vertices = {v0, v1, v2, v3};
+    m_mesh.clear();
+    MeshGeometry<double>& g = m_mesh.geometry64;
+    g.positions = { glm::dvec3(-1.0, -1.0, 0.0), glm::dvec3( 1.0, -1.0, 0.0),
+                    glm::dvec3( 1.0,  1.0, 0.0), glm::dvec3(-1.0,  1.0, 0.0) };
+    g.normals.assign(4, glm::dvec3(0.0));
+    g.scalars.assign(4, 0.0);
+    g.vectors.assign(4, glm::dvec3(0.0));
+    g.face_normals.assign(1, glm::dvec3(0.0));
+
+    m_mesh.face_ids = { 0 };
+    m_mesh.half_vertex = { 0, 1, 2, 3 };
 
-    m_faces.clear();
-    m_faces.push_back(std::make_shared<Face>(0, m_vertices));
-
-    m_edges.clear();
-    vertex_to_face_pointers();
     set_up_edges();
     reorder_vertex_pointers();
     compute_face_normals();
@@ -598,202 +531,738 @@ void QuadMesh::construct_simple_quad_mesh()
     compute_midpoint_and_radius();
 }
 
-void QuadMesh::vertex_to_face_pointers()
+// spreads the low 21 bits of x out to every third bit
+static uint64_t spread_bits(uint64_t x)
+{
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffull;
+    x = (x | x << 16) & 0x1f0000ff0000ffull;
+    x = (x | x << 8) & 0x100f00f00f00f00full;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+    x = (x | x << 2) & 0x1249249249249249ull;
+    return x;
+}
+
+// position along a Z-order curve through the box from lo with the given extent
+static uint64_t morton_code(const glm::dvec3& p, const glm::dvec3& lo, const glm::dvec3& scale)
+{
+    glm::dvec3 q = glm::clamp((p - lo) * scale, 0.0, double(0x1fffff));
+    return spread_bits(uint64_t(q.x)) | spread_bits(uint64_t(q.y)) << 1 | spread_bits(uint64_t(q.z)) << 2;
+}
+
+void QuadMesh::reorder_along_curve()
 {
-    // clear all vertex to face pointers
-    for (std::shared_ptr<Vertex>& v : m_vertices) 
-        v->faces().clear();
+    // runs on the freshly copied file arrays, before any topology is built
+    const uint32_t nv = static_cast<uint32_t>(m_mesh.num_vertices());
+    const uint32_t nf = static_cast<uint32_t>(m_mesh.num_faces());
+    if (nv == 0)
+        return;
+
+    glm::dvec3 lo = m_mesh.position(0), hi = lo;
+    for (uint32_t v = 1; v < nv; v++)
+    {
+        lo = glm::min(lo, m_mesh.position(v));
+        hi = glm::max(hi, m_mesh.position(v));
+    }
+    glm::dvec3 extent = hi - lo;
+    glm::dvec3 scale(0.0);
+    for (int k = 0; k < 3; k++)
+        scale[k] = (extent[k] > 0.0) ? double(0x1fffff) / extent[k] : 0.0;
+
+    // sort the vertices by the code of their position, keyed as (code, file index)
+    // so vertices in the same cell keep their file order
+    std::vector<std::pair<uint64_t, uint32_t>> keys(nv);
+    parallel_for(nv, [&](size_t begin, size_t end)
+    {
+        for (uint32_t v = static_cast<uint32_t>(begin); v < end; v++)
+            keys[v] = { morton_code(m_mesh.position(v), lo, scale), v };
+    }, 16384);
+    std::sort(keys.begin(), keys.end());
+
+    m_mesh.vertex_ids.resize(nv);
+    m_mesh.id_vertices.resize(nv);
+    for (uint32_t v = 0; v < nv; v++)
+    {
+        m_mesh.vertex_ids[v] = keys[v].second;
+        m_mesh.id_vertices[keys[v].second] = v;
+    }
+    m_mesh.geometry([&](auto& g)
+    {
+        auto permute = [&](auto& array)
+        {
+            std::decay_t<decltype(array)> sorted(array.size());
+            for (uint32_t v = 0; v < nv; v++)
+                sorted[v] = array[m_mesh.vertex_ids[v]];
+            array.swap(sorted);
+        };
+        permute(g.positions);
+        permute(g.normals);
+        permute(g.scalars);
+        permute(g.vectors);
+    });
+    for (uint32_t& v : m_mesh.half_vertex)
+        v = m_mesh.id_vertices[v];
+
+    // then the faces by their lowest corner, whose index is now a place along the curve
+    std::vector<std::pair<uint32_t, uint32_t>> face_keys(nf);
+    for (uint32_t f = 0; f < nf; f++)
+    {
+        const uint32_t* corners = &m_mesh.half_vertex[4 * size_t(f)];
+        face_keys[f] = { std::min(std::min(corners[0], corners[1]), std::min(corners[2], corners[3])), f };
+    }
+    std::sort(face_keys.begin(), face_keys.end());
 
-    // set up vertex to face pointers
-    for (std::shared_ptr<Face>& f : m_faces) 
+    MeshArray<uint32_t> face_ids(nf), half_vertex(4 * size_t(nf));
+    for (uint32_t f = 0; f < nf; f++)
     {
-        for (std::shared_ptr<Vertex>& v : f->vertices()) 
-            v->add_face(f);
+        const uint32_t old = face_keys[f].second;
+        face_ids[f] = m_mesh.face_ids[old];
+        std::copy_n(&m_mesh.half_vertex[4 * size_t(old)], 4, &half_vertex[4 * size_t(f)]);
     }
+    m_mesh.face_ids.swap(face_ids);
+    m_mesh.half_vertex.swap(half_vertex);
 }
 
 void QuadMesh::set_up_edges()
 {
-    // set null edge pointers for all faces
-    m_edges.clear();
-    for(std::shared_ptr<Face>& f : m_faces)
-        f->edges() = std::vector<std::shared_ptr<Edge>>(4, nullptr);
+    const size_t nv = m_mesh.num_vertices();
+    const uint32_t num_halves = static_cast<uint32_t>(m_mesh.half_vertex.size());
+    m_mesh.half_twin.assign(num_halves, HalfEdgeMesh::INVALID);
+    m_mesh.half_edge.resize(num_halves);
 
-    // clear all vertex to edge pointers
-    for (std::shared_ptr<Vertex>& v : m_vertices) 
-        v->edges().clear();
+    auto low_vertex = [&](uint32_t h)
+    {
+        return std::min(m_mesh.half_vertex[h], m_mesh.half_vertex[HalfEdgeMesh::next(h)]);
+    };
+    auto high_vertex = [&](uint32_t h)
+    {
+        return std::max(m_mesh.half_vertex[h], m_mesh.half_vertex[HalfEdgeMesh::next(h)]);
+    };
 
-    // loop through all quads
-    for (std::shared_ptr<Face>& face : m_faces)
+    // bucket the half-edges by their lower vertex with a counting sort: each range of
+    // half-edges counts its own per vertex, the counts become offsets within the buckets,
+    // and each range scatters its half-edges from its offsets, so every bucket keeps its
+    // half-edges in order. The counts take an array of vertices per range, so there are
+    // at most twice as many ranges as half-edges per vertex, which keeps them no larger
+    // than the buckets
+    const size_t max_ranges = std::max<size_t>(1, 2 * size_t(num_halves) / std::max<size_t>(1, nv));
+    const size_t num_ranges = std::min<size_t>({ size_t(num_worker_threads()), max_ranges,
+                                                 std::max<size_t>(1, num_halves / 65536) });
+    auto range_begin = [&](size_t r) { return static_cast<uint32_t>(num_halves * r / num_ranges); };
+    auto range_of = [&](uint32_t h) { return (num_ranges * (size_t(h) + 1) - 1) / num_halves; };
+    std::vector<uint32_t> range_counts(num_ranges * nv, 0);
+    parallel_for_chunks(num_ranges, [&](size_t r)
     {
-        // loop through consecutive vertex pairs in the quad
-        std::vector<std::shared_ptr<Vertex>>& verts = face->vertices();
-        for (int i = 0; i < 4; i++)
+        uint32_t* counts = range_counts.data() + r * nv;
+        for (uint32_t h = range_begin(r); h < range_begin(r + 1); h++)
+            counts[low_vertex(h)]++;
+    });
+    std::vector<uint32_t> bucket_offsets(nv + 1, 0);
+    parallel_for(nv, [&](size_t begin, size_t end)
+    {
+        for (size_t v = begin; v < end; v++)
         {
-            // check if the edge already exists
-            if (face->edges()[i] != nullptr)
-                continue;
+            uint32_t total = 0;
+            for (size_t r = 0; r < num_ranges; r++)
+            {
+                const uint32_t count = range_counts[r * nv + v];
+                range_counts[r * nv + v] = total;
+                total += count;
+            }
+            bucket_offsets[v + 1] = total;
+        }
+    }, 65536);
+    for (size_t v = 0; v < nv; v++)
+        bucket_offsets[v + 1] += bucket_offsets[v];
+    std::vector<uint64_t> buckets(num_halves);
+    parallel_for_chunks(num_ranges, [&](size_t r)
+    {
+        uint32_t* fill = range_counts.data() + r * nv;
+        for (uint32_t h = range_begin(r); h < range_begin(r + 1); h++)
+        {
+            const uint32_t v = low_vertex(h);
+            buckets[bucket_offsets[v] + fill[v]++] = (uint64_t(high_vertex(h)) << 32) | h;
+        }
+    });
+    range_counts = std::vector<uint32_t>();
+
+    // each entry is the higher vertex and then the half-edge, so sorting a bucket groups
+    // the half-edges along each edge in half-edge order; the first of them owns the edge,
+    // and only an edge between exactly two quads has a face on the other side. Until the
+    // edges are numbered each half-edge keeps its owner in half_edge, and each chunk counts
+    // the owners it finds in every range of half-edges
+    const size_t num_chunks = std::min<size_t>(num_worker_threads(), std::max<size_t>(1, nv / 4096));
+    std::vector<uint32_t> chunk_range_edges(num_chunks * num_ranges, 0);
+    std::vector<size_t> non_manifold(num_chunks, 0);
+    std::vector<uint32_t> first_non_manifold(num_chunks, HalfEdgeMesh::INVALID);
+    parallel_for_chunks(num_chunks, [&](size_t chunk)
+    {
+        const size_t begin = nv * chunk / num_chunks;
+        const size_t end = nv * (chunk + 1) / num_chunks;
+        uint32_t* range_owners = chunk_range_edges.data() + chunk * num_ranges;
+        for (size_t v = begin; v < end; v++)
+        {
+            uint64_t* first = buckets.data() + bucket_offsets[v];
+            uint64_t* last = buckets.data() + bucket_offsets[v + 1];
 
-            // create the edge for this vertex pair
-            std::shared_ptr<Vertex> v1 = verts[i];
-            std::shared_ptr<Vertex> v2 = verts[(i + 1) % 4];
-            std::shared_ptr<Edge> edge = std::make_shared<Edge>(static_cast<unsigned int>(m_edges.size()), v1, v2);
-            v1->add_edge(edge);
-            v2->add_edge(edge);
-			m_edges.push_back(edge);
-            face->edges()[i] = edge;
-            edge->add_face(face);
-
-            // find any other quads sharing this edge by searching around v1
-            // this prevents duplicate edges from being created
-            for (std::shared_ptr<Face>& other_face : v1->faces())
+            // a vertex of a quad mesh is the lower end of a few edges, too few for std::sort
+            if (last - first <= 16)
             {
-                if (face == other_face)
-                        continue;
-                std::vector<std::shared_ptr<Vertex>>& other_verts = other_face->vertices();
-                for (int k = 0; k < 4; k++)
+                for (uint64_t* i = first + 1; i < last; i++)
                 {
-                    if ((other_verts[k] == v1 && other_verts[(k + 1) % 4] == v2) ||
-                        (other_verts[k] == v2 && other_verts[(k + 1) % 4] == v1))
-                    {
-                        other_face->edges()[k] = edge;
-                        edge->add_face(other_face);
-                    }
+                    const uint64_t key = *i;
+                    uint64_t* k = i;
+                    for (; k > first && k[-1] > key; k--)
+                        *k = k[-1];
+                    *k = key;
+                }
+            }
+            else
+                std::sort(first, last);
+
+            for (const uint64_t* run = first; run != last; )
+            {
+                const uint64_t* run_end = run + 1;
+                while (run_end != last && (*run_end >> 32) == (*run >> 32))
+                    run_end++;
+                const uint32_t run_owner = static_cast<uint32_t>(*run);
+                for (const uint64_t* h = run; h != run_end; h++)
+                    m_mesh.half_edge[static_cast<uint32_t>(*h)] = run_owner;
+                range_owners[range_of(run_owner)]++;
+                if (run_end - run == 2)
+                {
+                    m_mesh.half_twin[run_owner] = static_cast<uint32_t>(run[1]);
+                    m_mesh.half_twin[static_cast<uint32_t>(run[1])] = run_owner;
+                }
+                else if (run_end - run > 2)
+                {
+                    if (non_manifold[chunk]++ == 0)
+                        first_non_manifold[chunk] = run_owner;
                 }
+                run = run_end;
             }
         }
+    });
+    buckets = std::vector<uint64_t>();
+    bucket_offsets = std::vector<uint32_t>();
+
+    // number the edges in the order their owners appear in the face list, each range
+    // from the number of owners before it; an owner comes before the other half-edges
+    // along its edge, so they take its number right away if it is in the same range,
+    // and once every range is numbered otherwise
+    std::vector<uint32_t> range_edges(num_ranges + 1, 0);
+    for (size_t r = 0; r < num_ranges; r++)
+    {
+        range_edges[r + 1] = range_edges[r];
+        for (size_t chunk = 0; chunk < num_chunks; chunk++)
+            range_edges[r + 1] += chunk_range_edges[chunk * num_ranges + r];
+    }
+
+    m_mesh.edge_vertices.resize(2 * size_t(range_edges[num_ranges]));
+    m_mesh.edge_half.resize(range_edges[num_ranges]);
+    std::vector<std::vector<uint32_t>> later(num_ranges);
+    parallel_for_chunks(num_ranges, [&](size_t r)
+    {
+        uint32_t edge = range_edges[r];
+        for (uint32_t h = range_begin(r); h < range_begin(r + 1); h++)
+        {
+            const uint32_t owner = m_mesh.half_edge[h];
+            if (owner == h)
+            {
+                m_mesh.half_edge[h] = edge;
+                m_mesh.edge_vertices[2 * size_t(edge)] = m_mesh.half_vertex[h];
+                m_mesh.edge_vertices[2 * size_t(edge) + 1] = m_mesh.half_vertex[HalfEdgeMesh::next(h)];
+                m_mesh.edge_half[edge] = h;
+                edge++;
+            }
+            else if (owner >= range_begin(r))
+                m_mesh.half_edge[h] = m_mesh.half_edge[owner];
+            else
+                later[r].push_back(h);
+        }
+    });
+    parallel_for_chunks(num_ranges, [&](size_t r)
+    {
+        for (uint32_t h : later[r])
+            m_mesh.half_edge[h] = m_mesh.half_edge[m_mesh.half_edge[h]];
+    });
+
+    size_t total = 0;
+    uint32_t example = HalfEdgeMesh::INVALID;
+    for (size_t i = 0; i < non_manifold.size(); i++)
+    {
+        total += non_manifold[i];
+        if (example == HalfEdgeMesh::INVALID)
+            example = first_non_manifold[i];
+    }
+    if (total > 0)
+    {
+        std::cout << "Warning: " << total << " non-manifold edges are shared by more than two quads"
+                  << " (e.g. vertices " << m_mesh.vertex_id(m_mesh.half_vertex[example]) << " and "
+                  << m_mesh.vertex_id(m_mesh.half_vertex[HalfEdgeMesh::next(example)])
+                  << "), they are treated as boundary edges" << std::endl;
     }
 }
 
 void QuadMesh::reorder_vertex_pointers()
 {
-    // reorder the faces and edges around each vertex so they are in a consistent order
-    for (std::shared_ptr<Vertex>& vertex : m_vertices)
-        vertex->reorder_pointers();
+    // start the ring of each vertex at the first face it is a corner of
+    const size_t nv = m_mesh.num_vertices();
+    m_mesh.vertex_half.assign(nv, HalfEdgeMesh::INVALID);
+    for (uint32_t h = 0; h < m_mesh.half_vertex.size(); h++)
+    {
+        uint32_t& start = m_mesh.vertex_half[m_mesh.half_vertex[h]];
+        if (start == HalfEdgeMesh::INVALID)
+            start = h;
+    }
+
+    // march backward around each vertex (counter-clockwise around the faces) from
+    // there, an open ring then starts at the face after its boundary edge, a
+    // closed ring stays where it is; each vertex only writes its own start
+    parallel_for(nv, [&](size_t begin, size_t end)
+    {
+        for (uint32_t v = static_cast<uint32_t>(begin); v < end; v++)
+        {
+            const uint32_t start = m_mesh.vertex_half[v];
+            if (start == HalfEdgeMesh::INVALID)
+                continue;
+            uint32_t h = start;
+            for (size_t steps = 0; steps <= m_mesh.num_faces(); steps++)
+            {
+                uint32_t t = m_mesh.half_twin[h]; // edge after this vertex in the face
+                if (t == HalfEdgeMesh::INVALID)
+                {
+                    m_mesh.vertex_half[v] = h;
+                    break;
+                }
+                h = m_mesh.leaving(t, v);
+                if (HalfEdgeMesh::face_of(h) == HalfEdgeMesh::face_of(start))
+                    break;
+            }
+        }
+    }, 4096);
 }
 
 void QuadMesh::compute_face_normals()
 {
-    for (auto& face : m_faces) 
-        face->compute_normal();
+    // Assumes quad vertices are ordered and co-planar
+    m_mesh.geometry([&](auto& g)
+    {
+        parallel_for(m_mesh.num_faces(), [&](size_t begin, size_t end)
+        {
+            for (size_t f = begin; f < end; f++)
+            {
+                const uint32_t* corners = &m_mesh.half_vertex[4 * f];
+                const auto& v0 = g.positions[corners[0]];
+                const auto& v1 = g.positions[corners[1]];
+                const auto& v2 = g.positions[corners[2]];
+                g.face_normals[f] = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+            }
+        }, 16384);
+    });
 }
 
 void QuadMesh::average_vertex_normals()
 {
-    for (auto& vertex : m_vertices) 
-        vertex->compute_average_normal();
+    // gather the face normals around each vertex rather than scattering each face
+    // into its corners, so every vertex is written by one thread only
+    m_mesh.geometry([&](auto& g)
+    {
+        using vec3 = typename std::decay_t<decltype(g)>::vec3;
+        using real = typename std::decay_t<decltype(g)>::real;
+        parallel_for(m_mesh.num_vertices(), [&](size_t begin, size_t end)
+        {
+            for (uint32_t v = static_cast<uint32_t>(begin); v < end; v++)
+            {
+                vec3 sum_normals(0);
+                size_t count = 0;
+                m_mesh.for_each_ring_half(v, [&](uint32_t h)
+                {
+                    sum_normals += g.face_normals[HalfEdgeMesh::face_of(h)];
+                    count++;
+                });
+                if (count > 0)
+                    g.normals[v] = glm::normalize(sum_normals / static_cast<real>(count));
+            }
+        }, 4096);
+    });
 }
 
+uint64_t QuadMesh::topology_hash() const { return m_topology_hash; }
+
 void QuadMesh::print_info() const
 {
     std::cout << "Number of vertices: " << num_vertices() << std::endl;
     std::cout << "Number of edges: " << num_edges() << std::endl;
     std::cout << "Number of faces: " << num_faces() << std::endl;
+    std::cout << "Precision: " << (m_mesh.is_float32() ? "float32" : "float64") << std::endl;
+    footprint().print(std::cout, "Mesh");
+}
+
+MemoryFootprint QuadMesh::footprint() const
+{
+    MemoryFootprint footprint = m_attributes.footprint();
+    m_mesh.geometry([&](const auto& g)
+    {
+        footprint.positions += capacity_bytes(g.positions) + capacity_bytes(g.normals) + capacity_bytes(g.face_normals);
+        footprint.attributes += capacity_bytes(g.scalars) + capacity_bytes(g.vectors);
+    });
+    footprint.adjacency = capacity_bytes(m_mesh.vertex_half) + capacity_bytes(m_mesh.vertex_ids) +
+        capacity_bytes(m_mesh.id_vertices) + capacity_bytes(m_mesh.face_ids) +
+        capacity_bytes(m_mesh.half_vertex) + capacity_bytes(m_mesh.half_twin) + capacity_bytes(m_mesh.half_edge) +
+        capacity_bytes(m_mesh.edge_vertices) + capacity_bytes(m_mesh.edge_half);
+    {
+        std::lock_guard<std::mutex> lock(m_locator_mutex);
+        if (m_face_grid)
+            footprint.adjacency += m_face_grid->memory_bytes();
+        if (m_face_bvh)
+            footprint.adjacency += m_face_bvh->memory_bytes();
+        if (m_face_interpolation)
+            footprint.adjacency += m_face_interpolation->memory_bytes();
+    }
+    footprint.control_blocks += sizeof(QuadMesh);
+    return footprint;
 }
 
 void QuadMesh::get_min_max_scalar(double& min_scalar, double& max_scalar) const{
-    // check to make sure we have vertices
-    if (m_vertices.empty()){
-        min_scalar = 0;
-        max_scalar = 0;
+    MeshStatistics stats = statistics();
+    min_scalar = stats.min_scalar;
+    max_scalar = stats.max_scalar;
+}
+
+void QuadMesh::set_vertex_attributes(const std::vector<double>& values)
+{
+    // values holds the scalar then the vector of each vertex, in file order
+    if (values.size() != m_mesh.num_vertices() * 4)
         return;
-    }    
-    
-    // initialize min and max values
-    min_scalar = m_vertices[0]->scalar(); 
-    max_scalar = m_vertices[0]->scalar();
 
-    // loop through all vertices
-    for (const auto& vert : m_vertices){
-        double s = vert->scalar();
-        if (s < min_scalar) min_scalar = s;
-        if (s > max_scalar) max_scalar = s;
-    }
+    m_mesh.geometry([&](auto& g)
+    {
+        using vec3 = typename std::decay_t<decltype(g)>::vec3;
+        using real = typename std::decay_t<decltype(g)>::real;
+        for (uint32_t v = 0; v < g.scalars.size(); v++) {
+            const double* a = &values[4 * size_t(m_mesh.vertex_id(v))];
+            g.scalars[v] = static_cast<real>(a[0]);
+            g.vectors[v] = vec3(a[1], a[2], a[3]);
+        }
+    });
+    invalidate_statistics(true, false);
+}
+
+void QuadMesh::get_min_max_coords(double& min_x, double& max_x, double& min_y,
+     double& max_y, double& min_z, double& max_z) const
+{ 
+    MeshStatistics stats = statistics();
+    min_x = stats.min_position.x;
+    max_x = stats.max_position.x;
+    min_y = stats.min_position.y;
+    max_y = stats.max_position.y;
+    min_z = stats.min_position.z;
+    max_z = stats.max_position.z;
 }
 
-void QuadMesh::set_height_from_scalar(double factor){
-    double min_scalar, max_scalar;
-    get_min_max_scalar(min_scalar, max_scalar);
+double QuadMesh::get_grid_spacing() const
+{
+    return statistics().mean_edge_length;
+}   
 
-    // nothing interesting to show
-    if (min_scalar == max_scalar) {
-        return;
-    }
+MeshStatistics QuadMesh::statistics() const
+{
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+    if (!m_scalar_statistics_valid)
+        compute_scalar_statistics();
+    if (!m_position_statistics_valid)
+        compute_position_statistics();
+    return m_statistics;
+}
+
+void QuadMesh::invalidate_statistics(bool scalars, bool positions)
+{
+    std::lock_guard<std::mutex> lock(m_statistics_mutex);
+    if (scalars)
+        m_scalar_statistics_valid = false;
+    if (positions)
+        m_position_statistics_valid = false;
+}
+
+const FaceGrid& QuadMesh::face_grid() const
+{
+    std::lock_guard<std::mutex> lock(m_locator_mutex);
+    if (!m_face_grid)
+        m_face_grid = std::make_unique<FaceGrid>(m_mesh);
+    return *m_face_grid;
+}
+
+const FaceBVH& QuadMesh::face_bvh() const
+{
+    std::lock_guard<std::mutex> lock(m_locator_mutex);
+    if (!m_face_bvh)
+        m_face_bvh = std::make_unique<FaceBVH>(m_mesh);
+    return *m_face_bvh;
+}
+
+const FaceInterpolation& QuadMesh::face_interpolation() const
+{
+    std::lock_guard<std::mutex> lock(m_locator_mutex);
+    if (!m_face_interpolation)
+        m_face_interpolation = std::make_unique<FaceInterpolation>(m_mesh);
+    return *m_face_interpolation;
+}
+
+const FaceInterpolation* QuadMesh::built_face_interpolation() const
+{
+    std::lock_guard<std::mutex> lock(m_locator_mutex);
+    return m_face_interpolation.get();
+}
+
+bool QuadMesh::locates_with_face_grid() const
+{
+    // a bucket sized for the mean face fills up where the faces are much smaller than
+    // that, past a few dozen faces to check the hierarchy is quicker
+    return face_grid().mean_candidates() <= 32.0;
+}
 
-    for (auto& vert : m_vertices) {
-        // get the normalized scalar value
-        double scalar = vert->scalar();
-        double normalized_scalar = (scalar - min_scalar) / (max_scalar - min_scalar);
+void QuadMesh::invalidate_locators()
+{
+    std::lock_guard<std::mutex> lock(m_locator_mutex);
+    m_face_grid = nullptr;
+    m_face_bvh = nullptr;
+    m_face_interpolation = nullptr;
+}
+
+void QuadMesh::compute_scalar_statistics() const
+{
+    // one pass per chunk for the range and the sums, taken around the first value
+    // so the variance does not lose its digits to a large mean
+    struct Partial { double min, max, sum, sum_squares; };
+    const size_t nv = m_mesh.num_vertices();
+    const size_t num_chunks = std::min<size_t>(num_worker_threads(), std::max<size_t>(1, nv / 65536));
+    const double shift = (nv > 0) ? m_mesh.scalar(0) : 0.0;
+    std::vector<Partial> partials(num_chunks, Partial{ shift, shift, 0.0, 0.0 });
+    m_mesh.geometry([&](const auto& g)
+    {
+        parallel_for_chunks(num_chunks, [&](size_t chunk)
+        {
+            Partial p = partials[chunk];
+            for (size_t v = nv * chunk / num_chunks; v < nv * (chunk + 1) / num_chunks; v++)
+            {
+                double s = g.scalars[v];
+                double d = s - shift;
+                p.min = std::min(p.min, s);
+                p.max = std::max(p.max, s);
+                p.sum += d;
+                p.sum_squares += d * d;
+            }
+            partials[chunk] = p;
+        });
+    });
+
+    MeshStatistics& stats = m_statistics;
+    stats.min_scalar = stats.max_scalar = shift;
+    stats.mean_scalar = stats.scalar_variance = 0.0;
+    if (nv > 0)
+    {
+        double sum = 0.0, sum_squares = 0.0;
+        for (const Partial& p : partials)
+        {
+            stats.min_scalar = std::min(stats.min_scalar, p.min);
+            stats.max_scalar = std::max(stats.max_scalar, p.max);
+            sum += p.sum;
+            sum_squares += p.sum_squares;
+        }
+        double mean = sum / static_cast<double>(nv);
+        stats.mean_scalar = shift + mean;
+        stats.scalar_variance = std::max(0.0, sum_squares / static_cast<double>(nv) - mean * mean);
+    }
+    m_scalar_statistics_valid = true;
+}
 
-        // offset the vertex postion in the direction of the vertex normal
-        glm::dvec3 offset = factor * normalized_scalar * vert->normal();
-        vert->offset_position(offset);
+void QuadMesh::compute_position_statistics() const
+{
+    // the bounds in one pass over the vertices, the edge lengths in one over the edges
+    struct Partial { glm::dvec3 min, max; double min_length, max_length, sum_length; };
+    const size_t nv = m_mesh.num_vertices();
+    const size_t ne = m_mesh.num_edges();
+    const size_t num_chunks = std::min<size_t>(num_worker_threads(), std::max<size_t>(1, (nv + ne) / 65536));
+    const glm::dvec3 first = (nv > 0) ? m_mesh.position(0) : glm::dvec3(0.0);
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<Partial> partials(num_chunks, Partial{ first, first, inf, 0.0, 0.0 });
+    m_mesh.geometry([&](const auto& g)
+    {
+        parallel_for_chunks(num_chunks, [&](size_t chunk)
+        {
+            Partial p = partials[chunk];
+            for (size_t v = nv * chunk / num_chunks; v < nv * (chunk + 1) / num_chunks; v++)
+            {
+                glm::dvec3 pos(g.positions[v]);
+                p.min = glm::min(p.min, pos);
+                p.max = glm::max(p.max, pos);
+            }
+            for (size_t e = ne * chunk / num_chunks; e < ne * (chunk + 1) / num_chunks; e++)
+            {
+                glm::dvec3 v1(g.positions[m_mesh.edge_vertices[2 * e]]);
+                glm::dvec3 v2(g.positions[m_mesh.edge_vertices[2 * e + 1]]);
+                double length = glm::length(v2 - v1);
+                p.min_length = std::min(p.min_length, length);
+                p.max_length = std::max(p.max_length, length);
+                p.sum_length += length;
+            }
+            partials[chunk] = p;
+        });
+    });
+
+    MeshStatistics& stats = m_statistics;
+    stats.min_position = stats.max_position = first;
+    double min_length = inf, max_length = 0.0, sum_length = 0.0;
+    for (const Partial& p : partials)
+    {
+        stats.min_position = glm::min(stats.min_position, p.min);
+        stats.max_position = glm::max(stats.max_position, p.max);
+        min_length = std::min(min_length, p.min_length);
+        max_length = std::max(max_length, p.max_length);
+        sum_length += p.sum_length;
     }
+    stats.min_edge_length = (ne > 0) ? min_length : 0.0;
+    stats.max_edge_length = max_length;
+    stats.mean_edge_length = (ne > 0) ? sum_length / static_cast<double>(ne) : 0.0;
+    m_position_statistics_valid = true;
+}
 
-    // recompute normals
-    compute_face_normals();
-    average_vertex_normals();
-    compute_midpoint_and_radius();
-    
+QuadMesh::FaceLookup QuadMesh::face_lookup() const
+{
+    FaceLookup lookup;
+    if (locates_with_face_grid())
+        lookup.grid = &face_grid();
+    else
+        lookup.bvh = &face_bvh();
+    return lookup;
 }
 
-void QuadMesh::reset_vertex_positions(){
-        
-    // remove the offsets from al all vertices
-    for (auto& vert : m_vertices){
-        vert->reset_position();
+Face QuadMesh::get_face_containing_xy_point(const glm::dvec3& point) const
+{
+    return find_face(face_lookup(), point);
+}
+
+Face QuadMesh::find_face(const FaceLookup& lookup, const glm::dvec3& point) const
+{
+    // only the faces whose box overlaps the point's bucket can contain it
+    if (lookup.grid)
+    {
+        std::pair<const uint32_t*, const uint32_t*> candidates = lookup.grid->candidates(point);
+        for (const uint32_t* f = candidates.first; f != candidates.second; f++)
+        {
+            Face face(&m_mesh, *f);
+            if (face->contains_xy_point(point))
+                return face;
+        }
+        return nullptr;
     }
 
-    // recompute normals and bounding sphere for the modified mesh
-    compute_face_normals();
-    average_vertex_normals();
-    compute_midpoint_and_radius();
+    // or whose box contains the point, which come in no particular order
+    uint32_t result = HalfEdgeMesh::INVALID;
+    lookup.bvh->for_each_face_at(glm::dvec2(point), [&](uint32_t f)
+    {
+        if (f < result && Face(&m_mesh, f).contains_xy_point(point))
+            result = f;
+    });
+    return (result != HalfEdgeMesh::INVALID) ? Face(&m_mesh, result) : nullptr;
 }
 
-void QuadMesh::get_min_max_coords(double& min_x, double& max_x, double& min_y,
-     double& max_y, double& min_z, double& max_z) const
-{ 
-    // check to make sure we have vertices
-    if (m_vertices.empty()){
-        min_x, min_y, min_z = 0.0;
-        max_x, max_y, max_z = 0.0;
-        return;
-    }    
-     
-    // initialize min and max values
-    min_x = m_vertices[0]->pos().x; 
-    max_x = m_vertices[0]->pos().x;
-    min_y = m_vertices[0]->pos().y; 
-    max_y = m_vertices[0]->pos().y;
-    min_z = m_vertices[0]->pos().z; 
-    max_z = m_vertices[0]->pos().z;
-    
-    
-    // loop through all vertices
-    for (const auto& vert : m_vertices){
-     glm::dvec3 pos = vert->pos();
-     if (pos.x < min_x) min_x = pos.x;
-     if (pos.x > max_x) max_x = pos.x;
-     if (pos.y < min_y) min_y = pos.y;
-     if (pos.y > max_y) max_y = pos.y;
-     if (pos.z < min_z) min_z = pos.z;
-     if (pos.z > max_z) max_z = pos.z;
+Location QuadMesh::locate(const glm::dvec3& point, const Face& hint) const
+{
+    Location location;
+    if (!walk_to(point, hint, location))
+    {
+        location.face = get_face_containing_xy_point(point);
+        location.used_index = true;
     }
+    return location;
 }
 
-double QuadMesh::get_grid_spacing() const
+bool QuadMesh::walk_to(const glm::dvec3& point, const Face& hint, Location& location) const
 {
-    if (m_edges.empty()) 
-        return 0.0;
-    return m_edges[0]->length();
-}   
+    // far enough for any point near the hint, a point further away is quicker to look up
+    const uint32_t MAX_WALK_STEPS = 64;
 
-const std::shared_ptr<Face> QuadMesh::get_face_containing_xy_point(const glm::dvec3& point) const
+    Face face = hint;
+    Face previous = nullptr;
+    while (face && location.steps <= MAX_WALK_STEPS)
+    {
+        if (face->contains_xy_point(point))
+        {
+            location.face = face;
+            return true;
+        }
+        // the same half-plane tests as contains_xy_point, signed so inside is positive
+        // whichever way the quad winds
+        const uint32_t* corners = &m_mesh.half_vertex[4 * size_t(face.index())];
+        glm::dvec2 p(point.x, point.y);
+        glm::dvec2 v[4];
+        for (int k = 0; k < 4; k++)
+            v[k] = glm::dvec2(m_mesh.position(corners[k]));
+        double area = 0.0;
+        for (int k = 0; k < 4; k++)
+            area += v[k].x * v[(k + 1) & 3].y - v[(k + 1) & 3].x * v[k].y;
+        const double winding = (area < 0.0) ? -1.0 : 1.0;
+
+        // cross the edge the point is furthest outside of, not back the way we came
+        const std::array<Edge, 4> edges = face->edges();
+        Face next = nullptr;
+        double worst = 0.0;
+        for (int k = 0; k < 4; k++)
+        {
+            glm::dvec2 a = v[k], b = v[(k + 1) & 3];
+            double length = glm::length(b - a);
+            if (length == 0.0)
+                continue;
+            double side = winding * ((p.x - b.x) * (a.y - b.y) - (a.x - b.x) * (p.y - b.y)) / length;
+            if (side >= worst)
+                continue;
+            Face across = edges[k]->other_face(face);
+            if (across && across == previous)
+                continue;
+            worst = side;
+            next = across;
+        }
+        if (!next)
+            break; // off the boundary, or on an edge
+        previous = face;
+        face = next;
+        location.steps++;
+    }
+
+    return false;
+}
+
+Face QuadMesh::get_nearest_xy_face(const glm::dvec3& point, double max_distance) const
 {
-    std::shared_ptr<Face> result = nullptr;
+    uint32_t f = face_bvh().nearest_face(glm::dvec2(point), [&](uint32_t face)
+    {
+        return Face(&m_mesh, face).squared_xy_distance(point);
+    }, max_distance);
+    return (f != HalfEdgeMesh::INVALID) ? Face(&m_mesh, f) : nullptr;
+}
+
+void QuadMesh::get_faces_overlapping_xy_box(const glm::dvec3& min, const glm::dvec3& max, std::vector<Face>& faces) const
+{
+    std::vector<uint32_t> indices;
+    face_bvh().for_each_face_overlapping(glm::dvec2(min), glm::dvec2(max), [&](uint32_t f)
+    {
+        indices.push_back(f);
+    });
+    std::sort(indices.begin(), indices.end());
+    faces.clear();
+    faces.reserve(indices.size());
+    for (uint32_t f : indices)
+        faces.emplace_back(&m_mesh, f);
+}
+
+Face QuadMesh::scan_for_face_containing_xy_point(const glm::dvec3& point) const
+{
+    Face result = nullptr;
 
     // loop through all faces to find one that contains the point
-    for (const std::shared_ptr<Face>& face : m_faces)
+    for (const Face face : faces())
     {
         if (face->contains_xy_point(point))
         {
@@ -807,11 +1276,28 @@ const std::shared_ptr<Face> QuadMesh::get_face_containing_xy_point(const glm::dv
 }
 
 glm::dvec3 QuadMesh::take_xy_streamline_step(const glm::dvec3& current_pos,
-    const std::shared_ptr<Face>& current_face,std::shared_ptr<Face>& next_face,
-    double step_size, int direction) const
+    const Face& current_face, Face& next_face,
+    double step_size, int direction, const FaceInterpolation* table) const
 {
-    // sample the vector field at the current position within the current face
-    glm::dvec3 vector = current_face->bilinear_interpolate_xy_vector(current_pos);
+    // sample the vector field at the current position within the current face, a streamline
+    // visits too few faces to be worth building the table for
+    const uint32_t f = current_face.index();
+    glm::dvec3 vector;
+    if (table)
+        vector = table->interpolate<glm::dvec3>(f, current_pos, [&](uint32_t v) { return m_mesh.vector(v); });
+    else
+    {
+        const uint32_t* corners = &m_mesh.half_vertex[4 * size_t(f)];
+        glm::dvec2 positions[4];
+        for (int k = 0; k < 4; k++)
+            positions[k] = glm::dvec2(m_mesh.position(corners[k]));
+        double w[4];
+        FaceInterpolation::weights(FaceInterpolation::local_coordinates(FaceInterpolation::quad(positions),
+            glm::dvec2(current_pos)), w);
+        vector = w[0] * m_mesh.vector(corners[0]) + w[1] * m_mesh.vector(corners[1]) +
+                 w[2] * m_mesh.vector(corners[2]) + w[3] * m_mesh.vector(corners[3]);
+    }
+    vector.z = 0.0;
     if (vector.x == 0.0 && vector.y == 0.0)
     {
         next_face = nullptr;
@@ -865,7 +1351,7 @@ glm::dvec3 QuadMesh::take_xy_streamline_step(const glm::dvec3& current_pos,
 }
 
 void QuadMesh::compute_xy_streamline(std::vector<glm::dvec3>& streamline,
-    const glm::dvec3& start_pos, const std::shared_ptr<Face>& start_face,
+    const glm::dvec3& start_pos, const Face& start_face,
     double step_size, int num_steps) const
 {
     // make sure the streamline is empty
@@ -874,22 +1360,23 @@ void QuadMesh::compute_xy_streamline(std::vector<glm::dvec3>& streamline,
     streamline.push_back(start_pos);
 
     // first get the starting quad if it isn't provided
-    std::shared_ptr<Face> start_face_local = start_face;
+    Face start_face_local = start_face;
     if (!start_face_local)
     {
         start_face_local = get_face_containing_xy_point(start_pos);
         if (!start_face_local)
             return; // starting point is outside the mesh
     }
+    const FaceInterpolation* table = built_face_interpolation();
     
     // take steps backward along the vector field
     glm::dvec3 current_pos = start_pos;
-    std::shared_ptr<Face> current_face = start_face_local;
-    std::shared_ptr<Face> next_face = nullptr;
+    Face current_face = start_face_local;
+    Face next_face = nullptr;
     for (int step = 0; step < num_steps; step++)
     {
         glm::dvec3 next_pos = take_xy_streamline_step(current_pos, current_face,
-            next_face, step_size, -1);
+            next_face, step_size, -1, table);
         streamline.push_back(next_pos);
         if (!next_face){
             break; // streamline has exited the mesh
@@ -908,7 +1395,7 @@ void QuadMesh::compute_xy_streamline(std::vector<glm::dvec3>& streamline,
     for (int step = 0; step < num_steps; step++)
     {
         glm::dvec3 next_pos = take_xy_streamline_step(current_pos, current_face,
-            next_face, step_size, 1);
+            next_face, step_size, 1, table);
         streamline.push_back(next_pos);
         if (!next_face){
             break; // streamline has exited the mesh
@@ -918,3 +1405,79 @@ void QuadMesh::compute_xy_streamline(std::vector<glm::dvec3>& streamline,
     }
 }
 
+void QuadMesh::compute_face_xy_streamline(std::vector<glm::dvec3>& streamline, size_t f,
+    double step_size, int num_steps) const
+{
+    Face face(&m_mesh, static_cast<uint32_t>(f));
+    compute_xy_streamline(streamline, face.centroid(), face, step_size, num_steps);
+}
+
+void QuadMesh::sample(const glm::dvec3* points, size_t count, const FieldSamples& out) const
+{
+    const FaceInterpolation& table = face_interpolation();
+    const FaceLookup lookup = face_lookup();
+    // a point a few faces from the last one is found quicker by walking there
+    const double walk_distance = 4.0 * statistics().mean_edge_length;
+    const double walk_distance2 = walk_distance * walk_distance;
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    // the columns are in file order and decoded here, before the threads need them
+    struct Column { const float* float32; const double* float64; double* values; };
+    std::vector<Column> columns;
+    for (size_t c = 0; c < out.columns.size(); c++)
+        columns.push_back({ out.columns[c]->float32_data(), out.columns[c]->float64_data(), out.column_values[c] });
+
+    m_mesh.geometry([&](const auto& g)
+    {
+        parallel_for(count, [&](size_t begin, size_t end)
+        {
+            Face last = nullptr;
+            glm::dvec2 last_point(0.0);
+            for (size_t i = begin; i < end; i++)
+            {
+                const glm::dvec3& point = points[i];
+                const glm::dvec2 d = glm::dvec2(point) - last_point;
+                Location location;
+                Face face = walk_to(point, (glm::dot(d, d) <= walk_distance2) ? last : nullptr, location) ?
+                    location.face : find_face(lookup, point);
+                if (!face)
+                {
+                    if (out.scalars)
+                        out.scalars[i] = nan;
+                    if (out.vectors)
+                        out.vectors[i] = glm::dvec3(nan);
+                    for (Column& column : columns)
+                        column.values[i] = nan;
+                    continue;
+                }
+                last = face;
+                last_point = glm::dvec2(point);
+
+                double w[4];
+                table.weights(face.index(), point, w);
+                const uint32_t* v = table.corners(face.index());
+                if (out.scalars)
+                {
+                    out.scalars[i] = w[0] * g.scalars[v[0]] + w[1] * g.scalars[v[1]] +
+                                     w[2] * g.scalars[v[2]] + w[3] * g.scalars[v[3]];
+                }
+                if (out.vectors)
+                {
+                    glm::dvec3 vxy = w[0] * glm::dvec3(g.vectors[v[0]]) + w[1] * glm::dvec3(g.vectors[v[1]]) +
+                                     w[2] * glm::dvec3(g.vectors[v[2]]) + w[3] * glm::dvec3(g.vectors[v[3]]);
+                    out.vectors[i] = glm::dvec3(vxy.x, vxy.y, 0.0);
+                }
+                for (Column& column : columns)
+                {
+                    double sum = 0.0;
+                    for (int k = 0; k < 4; k++)
+                    {
+                        const uint32_t id = m_mesh.vertex_id(v[k]);
+                        sum += w[k] * (column.float32 ? double(column.float32[id]) : column.float64[id]);
+                    }
+                    column.values[i] = sum;
+                }
+            }
+        }, 4096);
+    });
+}
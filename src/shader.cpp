@@ -3,6 +3,43 @@
 #include <sstream>
 #include <iostream>
 
+// replace each line #include "file" in code with the contents of file, found next to
+// the shader at path, so shaders can share code that GLSL has no way to share itself
+static std::string expand_includes(const std::string& code, const char* path)
+{
+    const std::string shader_path(path);
+    const size_t slash = shader_path.find_last_of("/\\");
+    const std::string directory = (slash == std::string::npos) ? std::string() : shader_path.substr(0, slash + 1);
+
+    std::istringstream lines(code);
+    std::string expanded;
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        const size_t open = line.find('"');
+        const size_t close = (open == std::string::npos) ? open : line.find('"', open + 1);
+        if (line.compare(0, 9, "#include ") != 0 || close == std::string::npos)
+        {
+            expanded += line + "\n";
+            continue;
+        }
+
+        const std::string include_path = directory + line.substr(open + 1, close - open - 1);
+        std::ifstream include_file(include_path);
+        if (!include_file)
+        {
+            std::cout << "Error reading shader file: " << include_path << " included from " << path << std::endl;
+            continue;
+        }
+        std::stringstream include_stream;
+        include_stream << include_file.rdbuf();
+        expanded += include_stream.str();
+        if (!expanded.empty() && expanded.back() != '\n')
+            expanded += "\n";
+    }
+    return expanded;
+}
+
 Shader::Shader(const char* vertexPath, const char* fragmentPath)
 {
     // read in the vertex and fragment shader files
@@ -21,8 +58,8 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
         fShaderStream << fShaderFile.rdbuf();
         vShaderFile.close();
         fShaderFile.close();
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();     
+        vertexCode = expand_includes(vShaderStream.str(), vertexPath);
+        fragmentCode = expand_includes(fShaderStream.str(), fragmentPath);
     }
     catch (std::ifstream::failure& e)
     {
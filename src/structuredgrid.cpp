@@ -0,0 +1,579 @@
+#include "structuredgrid.h"
+#include "plyreader.h"
+#include "meshcache.h"
+#include "parallel.h"
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <iostream>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+
+// how far off its lattice node a vertex may be, as a fraction of the spacing
+static const double LATTICE_TOLERANCE = 1e-3;
+
+// offset of a cell corner stored as di + 2 * dj
+static glm::dvec2 corner_offset(int corner)
+{
+    return glm::dvec2(corner & 1, corner >> 1);
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Detecting Grids
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<StructuredGrid2D> StructuredGrid2D::detect(const PlyData& ply)
+{
+    const size_t num_vertices = ply.num_vertices;
+    const size_t num_faces = ply.face_ids.size();
+    if (num_vertices < 4 || num_faces == 0)
+        return nullptr;
+
+    // every vertex has to share one z, the bounds give the origin
+    const double* first = &ply.vertex_values[0];
+    glm::dvec2 min_xy(first[SLOT_X], first[SLOT_Y]);
+    glm::dvec2 max_xy = min_xy;
+    for (size_t v = 0; v < num_vertices; v++)
+    {
+        const double* a = &ply.vertex_values[v * NUM_VERTEX_SLOTS];
+        if (a[SLOT_Z] != first[SLOT_Z])
+            return nullptr;
+        min_xy = glm::min(min_xy, glm::dvec2(a[SLOT_X], a[SLOT_Y]));
+        max_xy = glm::max(max_xy, glm::dvec2(a[SLOT_X], a[SLOT_Y]));
+    }
+
+    // the first quad gives the spacing, which gives the number of nodes along each axis
+    glm::dvec2 spacing(0.0);
+    const double* corner0 = &ply.vertex_values[static_cast<size_t>(ply.face_indices[0]) * NUM_VERTEX_SLOTS];
+    for (int k = 1; k < 4; k++)
+    {
+        const double* a = &ply.vertex_values[static_cast<size_t>(ply.face_indices[k]) * NUM_VERTEX_SLOTS];
+        spacing.x = std::max(spacing.x, std::abs(a[SLOT_X] - corner0[SLOT_X]));
+        spacing.y = std::max(spacing.y, std::abs(a[SLOT_Y] - corner0[SLOT_Y]));
+    }
+    if (!(spacing.x > 0.0 && spacing.y > 0.0))
+        return nullptr;
+    glm::dvec2 cells = (max_xy - min_xy) / spacing;
+    if (!(cells.x < static_cast<double>(num_vertices) && cells.y < static_cast<double>(num_vertices)))
+        return nullptr;
+    const size_t nx = static_cast<size_t>(std::llround(cells.x)) + 1;
+    const size_t ny = static_cast<size_t>(std::llround(cells.y)) + 1;
+    if (nx < 2 || ny < 2 || nx * ny != num_vertices || (nx - 1) * (ny - 1) != num_faces)
+        return nullptr;
+    spacing = (max_xy - min_xy) / glm::dvec2(static_cast<double>(nx - 1), static_cast<double>(ny - 1));
+
+    // put every vertex on its node, each node has to be taken exactly once
+    std::vector<unsigned int> vertex_node(num_vertices);
+    std::vector<unsigned int> node_vertex(num_vertices, UINT_MAX);
+    bool in_lattice_order = true;
+    for (size_t v = 0; v < num_vertices; v++)
+    {
+        const double* a = &ply.vertex_values[v * NUM_VERTEX_SLOTS];
+        double fx = (a[SLOT_X] - min_xy.x) / spacing.x;
+        double fy = (a[SLOT_Y] - min_xy.y) / spacing.y;
+        double i = std::round(fx);
+        double j = std::round(fy);
+        if (std::abs(fx - i) > LATTICE_TOLERANCE || std::abs(fy - j) > LATTICE_TOLERANCE)
+            return nullptr;
+        size_t node = static_cast<size_t>(i) + static_cast<size_t>(j) * nx;
+        if (node_vertex[node] != UINT_MAX)
+            return nullptr;
+        node_vertex[node] = static_cast<unsigned int>(v);
+        vertex_node[v] = static_cast<unsigned int>(node);
+        in_lattice_order = in_lattice_order && node == v;
+    }
+
+    // every quad has to be one cell, with its corners in the same order as the first quad
+    int corners[4] = { 0, 0, 0, 0 };
+    std::vector<bool> cell_used(num_faces, false);
+    for (size_t f = 0; f < num_faces; f++)
+    {
+        const unsigned int* idx = &ply.face_indices[f * 4];
+        size_t i0 = SIZE_MAX, j0 = SIZE_MAX;
+        for (int k = 0; k < 4; k++)
+        {
+            i0 = std::min<size_t>(i0, vertex_node[idx[k]] % nx);
+            j0 = std::min<size_t>(j0, vertex_node[idx[k]] / nx);
+        }
+        if (i0 >= nx - 1 || j0 >= ny - 1)
+            return nullptr;
+
+        int face_corners[4];
+        for (int k = 0; k < 4; k++)
+        {
+            size_t di = vertex_node[idx[k]] % nx - i0;
+            size_t dj = vertex_node[idx[k]] / nx - j0;
+            if (di > 1 || dj > 1)
+                return nullptr;
+            face_corners[k] = static_cast<int>(di + 2 * dj);
+        }
+
+        if (f == 0)
+        {
+            // the corners have to go around the cell, each step changing one of i or j
+            for (int k = 0; k < 4; k++)
+            {
+                int step = face_corners[k] ^ face_corners[(k + 1) % 4];
+                if (step != 1 && step != 2)
+                    return nullptr;
+                corners[k] = face_corners[k];
+            }
+        }
+        else if (!std::equal(face_corners, face_corners + 4, corners))
+            return nullptr;
+
+        size_t cell = i0 + j0 * (nx - 1);
+        if (cell_used[cell])
+            return nullptr;
+        cell_used[cell] = true;
+    }
+
+    std::unique_ptr<StructuredGrid2D> grid(new StructuredGrid2D());
+    grid->m_origin = glm::dvec3(min_xy.x, min_xy.y, first[SLOT_Z]);
+    grid->m_spacing = spacing;
+    grid->m_nx = nx;
+    grid->m_ny = ny;
+    std::copy(corners, corners + 4, grid->m_corners);
+    grid->set_normal_from_corners();
+    if (!in_lattice_order)
+    {
+        grid->m_node_vertex = std::move(node_vertex);
+        grid->m_vertex_node = std::move(vertex_node);
+    }
+
+    grid->m_scalars.resize(num_vertices);
+    grid->m_vectors.resize(num_vertices);
+    for (size_t v = 0; v < num_vertices; v++)
+    {
+        const double* a = &ply.vertex_values[v * NUM_VERTEX_SLOTS];
+        grid->m_scalars[v] = a[SLOT_S];
+        grid->m_vectors[v] = glm::dvec3(a[SLOT_VX], a[SLOT_VY], a[SLOT_VZ]);
+    }
+    // hashed from the file values, so it matches a QuadMesh loaded from the same file
+    grid->m_topology_hash = ::topology_hash(ply);
+    grid->m_attributes = ply.attributes;
+    grid->compute_midpoint_and_radius();
+    return grid;
+}
+
+void StructuredGrid2D::set_normal_from_corners()
+{
+    glm::dvec2 e1 = corner_offset(m_corners[1]) - corner_offset(m_corners[0]);
+    glm::dvec2 e2 = corner_offset(m_corners[2]) - corner_offset(m_corners[0]);
+    m_normal_z = (e1.x * e2.y - e1.y * e2.x > 0.0) ? 1.0 : -1.0;
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Lattice Access
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+size_t StructuredGrid2D::nx() const { return m_nx; }
+size_t StructuredGrid2D::ny() const { return m_ny; }
+glm::dvec3 StructuredGrid2D::origin() const { return m_origin; }
+glm::dvec2 StructuredGrid2D::spacing() const { return m_spacing; }
+
+unsigned int StructuredGrid2D::node_vertex(size_t i, size_t j) const
+{
+    size_t node = i + j * m_nx;
+    return m_node_vertex.empty() ? static_cast<unsigned int>(node) : m_node_vertex[node];
+}
+
+size_t StructuredGrid2D::vertex_node(size_t v) const
+{
+    return m_vertex_node.empty() ? v : m_vertex_node[v];
+}
+
+bool StructuredGrid2D::locate(const glm::dvec3& point, size_t& cell) const
+{
+    double fx = (point.x - m_origin.x) / m_spacing.x;
+    double fy = (point.y - m_origin.y) / m_spacing.y;
+    if (!(fx >= 0.0 && fx <= static_cast<double>(m_nx - 1) &&
+          fy >= 0.0 && fy <= static_cast<double>(m_ny - 1)))
+        return false;
+
+    // points on the far border belong to the last cell
+    size_t i = std::min(static_cast<size_t>(fx), m_nx - 2);
+    size_t j = std::min(static_cast<size_t>(fy), m_ny - 2);
+    cell = i + j * (m_nx - 1);
+    return true;
+}
+
+size_t StructuredGrid2D::neighbor(size_t cell, Side side) const
+{
+    const size_t row = m_nx - 1;
+    size_t i = cell % row;
+    size_t j = cell / row;
+    switch (side)
+    {
+    case Side::Left:   return i == 0 ? NO_CELL : cell - 1;
+    case Side::Right:  return i + 1 == row ? NO_CELL : cell + 1;
+    case Side::Bottom: return j == 0 ? NO_CELL : cell - row;
+    case Side::Top:    return j + 2 == m_ny ? NO_CELL : cell + row;
+    }
+    return NO_CELL;
+}
+
+void StructuredGrid2D::cell_corners(const glm::dvec3& point, size_t cell, double& u, double& w,
+    unsigned int ids[4]) const
+{
+    size_t i = cell % (m_nx - 1);
+    size_t j = cell / (m_nx - 1);
+    u = (point.x - m_origin.x) / m_spacing.x - static_cast<double>(i);
+    w = (point.y - m_origin.y) / m_spacing.y - static_cast<double>(j);
+    ids[0] = node_vertex(i, j);
+    ids[1] = node_vertex(i + 1, j);
+    ids[2] = node_vertex(i, j + 1);
+    ids[3] = node_vertex(i + 1, j + 1);
+}
+
+double StructuredGrid2D::interpolate_scalar(const glm::dvec3& point, size_t cell) const
+{
+    double u, w;
+    unsigned int ids[4];
+    cell_corners(point, cell, u, w, ids);
+    return (1.0 - u) * (1.0 - w) * m_scalars[ids[0]] + u * (1.0 - w) * m_scalars[ids[1]] +
+           (1.0 - u) * w * m_scalars[ids[2]] + u * w * m_scalars[ids[3]];
+}
+
+glm::dvec3 StructuredGrid2D::interpolate_xy_vector(const glm::dvec3& point, size_t cell) const
+{
+    double u, w;
+    unsigned int ids[4];
+    cell_corners(point, cell, u, w, ids);
+    glm::dvec3 vxy = (1.0 - u) * (1.0 - w) * m_vectors[ids[0]] + u * (1.0 - w) * m_vectors[ids[1]] +
+                     (1.0 - u) * w * m_vectors[ids[2]] + u * w * m_vectors[ids[3]];
+    return glm::dvec3(vxy.x, vxy.y, 0.0);
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// FieldMesh Methods
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+size_t StructuredGrid2D::num_vertices() const { return m_nx * m_ny; }
+size_t StructuredGrid2D::num_edges() const { return (m_nx - 1) * m_ny + m_nx * (m_ny - 1); }
+size_t StructuredGrid2D::num_faces() const { return (m_nx - 1) * (m_ny - 1); }
+glm::dvec3 StructuredGrid2D::midpoint() const { return m_midpoint; }
+double StructuredGrid2D::get_radius() const { return m_radius; }
+uint64_t StructuredGrid2D::topology_hash() const { return m_topology_hash; }
+double StructuredGrid2D::vertex_scalar(size_t v) const { return m_scalars[v]; }
+glm::dvec3 StructuredGrid2D::vertex_vector(size_t v) const { return m_vectors[v]; }
+const AttributeTable& StructuredGrid2D::attributes() const { return m_attributes; }
+AttributeTable& StructuredGrid2D::attributes() { return m_attributes; }
+
+glm::dvec3 StructuredGrid2D::vertex_position(size_t v) const
+{
+    size_t node = vertex_node(v);
+    glm::dvec3 pos = m_origin + glm::dvec3(static_cast<double>(node % m_nx) * m_spacing.x,
+                                           static_cast<double>(node / m_nx) * m_spacing.y, 0.0);
+    return pos;
+}
+
+glm::dvec3 StructuredGrid2D::vertex_normal(size_t /*v*/) const
+{
+    return glm::dvec3(0.0, 0.0, m_normal_z);
+}
+
+void StructuredGrid2D::edge_vertices(size_t e, unsigned int ids[2]) const
+{
+    const size_t num_x_edges = (m_nx - 1) * m_ny;
+    if (e < num_x_edges)
+    {
+        size_t i = e % (m_nx - 1);
+        size_t j = e / (m_nx - 1);
+        ids[0] = node_vertex(i, j);
+        ids[1] = node_vertex(i + 1, j);
+    }
+    else
+    {
+        e -= num_x_edges;
+        size_t i = e % m_nx;
+        size_t j = e / m_nx;
+        ids[0] = node_vertex(i, j);
+        ids[1] = node_vertex(i, j + 1);
+    }
+}
+
+void StructuredGrid2D::face_vertices(size_t f, unsigned int ids[4]) const
+{
+    size_t i = f % (m_nx - 1);
+    size_t j = f / (m_nx - 1);
+    for (int k = 0; k < 4; k++)
+        ids[k] = node_vertex(i + (m_corners[k] & 1), j + (m_corners[k] >> 1));
+}
+
+void StructuredGrid2D::print_info() const
+{
+    std::cout << "Number of vertices: " << num_vertices() << std::endl;
+    std::cout << "Number of edges: " << num_edges() << std::endl;
+    std::cout << "Number of faces: " << num_faces() << std::endl;
+    footprint().print(std::cout, "Grid");
+}
+
+MemoryFootprint StructuredGrid2D::footprint() const
+{
+    // positions follow from the lattice and take no memory
+    MemoryFootprint footprint = m_attributes.footprint();
+    footprint.attributes += capacity_bytes(m_scalars) + capacity_bytes(m_vectors);
+    footprint.adjacency = capacity_bytes(m_node_vertex) + capacity_bytes(m_vertex_node);
+    footprint.control_blocks += sizeof(StructuredGrid2D);
+    return footprint;
+}
+
+void StructuredGrid2D::get_min_max_scalar(double& min_scalar, double& max_scalar) const
+{
+    std::lock_guard<std::mutex> lock(m_scalar_range_mutex);
+    if (!m_scalar_range_valid)
+    {
+        m_min_scalar = 0;
+        m_max_scalar = 0;
+        if (!m_scalars.empty())
+        {
+            auto range = std::minmax_element(m_scalars.begin(), m_scalars.end());
+            m_min_scalar = *range.first;
+            m_max_scalar = *range.second;
+        }
+        m_scalar_range_valid = true;
+    }
+    min_scalar = m_min_scalar;
+    max_scalar = m_max_scalar;
+}
+
+void StructuredGrid2D::get_min_max_coords(double& min_x, double& max_x, double& min_y,
+    double& max_y, double& min_z, double& max_z) const
+{
+    min_x = m_origin.x;
+    max_x = m_origin.x + static_cast<double>(m_nx - 1) * m_spacing.x;
+    min_y = m_origin.y;
+    max_y = m_origin.y + static_cast<double>(m_ny - 1) * m_spacing.y;
+    min_z = m_origin.z;
+    max_z = m_origin.z;
+}
+
+double StructuredGrid2D::get_grid_spacing() const
+{
+    return std::min(m_spacing.x, m_spacing.y);
+}
+
+void StructuredGrid2D::compute_midpoint_and_radius()
+{
+    double min_x, max_x, min_y, max_y, min_z, max_z;
+    get_min_max_coords(min_x, max_x, min_y, max_y, min_z, max_z);
+    glm::dvec3 min_pt(min_x, min_y, min_z);
+    glm::dvec3 max_pt(max_x, max_y, max_z);
+    m_midpoint = 0.5 * (min_pt + max_pt);
+    m_radius = 0.5 * glm::length(max_pt - min_pt);
+}
+
+void StructuredGrid2D::set_vertex_attributes(const std::vector<double>& values)
+{
+    // values holds the scalar then the vector of each vertex, in vertex order
+    if (values.size() != num_vertices() * 4)
+        return;
+
+    const double* a = values.data();
+    for (size_t v = 0; v < m_scalars.size(); v++)
+    {
+        m_scalars[v] = a[0];
+        m_vectors[v] = glm::dvec3(a[1], a[2], a[3]);
+        a += 4;
+    }
+
+    std::lock_guard<std::mutex> lock(m_scalar_range_mutex);
+    m_scalar_range_valid = false;
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Streamlines
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+glm::dvec3 StructuredGrid2D::take_xy_streamline_step(const glm::dvec3& current_pos, size_t current_cell,
+    size_t& next_cell, double step_size, int direction) const
+{
+    // sample the vector field at the current position within the current cell
+    glm::dvec3 vector = interpolate_xy_vector(current_pos, current_cell);
+    if (vector.x == 0.0 && vector.y == 0.0)
+    {
+        next_cell = NO_CELL;
+        return current_pos; // zero vector field, cannot step
+    }
+    glm::dvec3 step_dir = glm::normalize(vector) * static_cast<double>(direction);
+    glm::dvec3 next_pos = current_pos + step_dir * step_size;
+
+    size_t i = current_cell % (m_nx - 1);
+    size_t j = current_cell / (m_nx - 1);
+    double x0 = m_origin.x + static_cast<double>(i) * m_spacing.x;
+    double x1 = m_origin.x + static_cast<double>(i + 1) * m_spacing.x;
+    double y0 = m_origin.y + static_cast<double>(j) * m_spacing.y;
+    double y1 = m_origin.y + static_cast<double>(j + 1) * m_spacing.y;
+    if (next_pos.x >= x0 && next_pos.x <= x1 && next_pos.y >= y0 && next_pos.y <= y1)
+    {
+        next_cell = current_cell;
+        return next_pos;
+    }
+
+    // stop where the step leaves the cell and carry on in the cell across that side
+    glm::dvec3 delta = next_pos - current_pos;
+    const double infinity = std::numeric_limits<double>::infinity();
+    double tx = infinity, ty = infinity;
+    if (delta.x > 0.0) tx = (x1 - current_pos.x) / delta.x;
+    else if (delta.x < 0.0) tx = (x0 - current_pos.x) / delta.x;
+    if (delta.y > 0.0) ty = (y1 - current_pos.y) / delta.y;
+    else if (delta.y < 0.0) ty = (y0 - current_pos.y) / delta.y;
+
+    double t;
+    if (tx <= ty)
+    {
+        t = tx;
+        next_cell = neighbor(current_cell, delta.x > 0.0 ? Side::Right : Side::Left);
+    }
+    else
+    {
+        t = ty;
+        next_cell = neighbor(current_cell, delta.y > 0.0 ? Side::Top : Side::Bottom);
+    }
+    return current_pos + std::clamp(t, 0.0, 1.0) * delta;
+}
+
+void StructuredGrid2D::trace_xy_streamline(std::vector<glm::dvec3>& streamline, const glm::dvec3& start_pos,
+    size_t start_cell, double step_size, int num_steps) const
+{
+    // take steps backward along the vector field
+    glm::dvec3 current_pos = start_pos;
+    size_t current_cell = start_cell;
+    size_t next_cell = NO_CELL;
+    for (int step = 0; step < num_steps; step++)
+    {
+        glm::dvec3 next_pos = take_xy_streamline_step(current_pos, current_cell, next_cell, step_size, -1);
+        streamline.push_back(next_pos);
+        if (next_cell == NO_CELL)
+            break; // streamline has exited the grid
+        current_pos = next_pos;
+        current_cell = next_cell;
+    }
+
+    // flip the streamline around before we go forward
+    std::reverse(streamline.begin(), streamline.end());
+
+    // take steps forward along the vector field
+    current_pos = start_pos;
+    current_cell = start_cell;
+    for (int step = 0; step < num_steps; step++)
+    {
+        glm::dvec3 next_pos = take_xy_streamline_step(current_pos, current_cell, next_cell, step_size, 1);
+        streamline.push_back(next_pos);
+        if (next_cell == NO_CELL)
+            break; // streamline has exited the grid
+        current_pos = next_pos;
+        current_cell = next_cell;
+    }
+}
+
+void StructuredGrid2D::compute_xy_streamline(std::vector<glm::dvec3>& streamline, const glm::dvec3& start_pos,
+    double step_size, int num_steps) const
+{
+    streamline.clear();
+    streamline.push_back(start_pos);
+
+    size_t start_cell;
+    if (!locate(start_pos, start_cell))
+        return; // starting point is outside the grid
+    trace_xy_streamline(streamline, start_pos, start_cell, step_size, num_steps);
+}
+
+void StructuredGrid2D::compute_face_xy_streamline(std::vector<glm::dvec3>& streamline, size_t f,
+    double step_size, int num_steps) const
+{
+    unsigned int ids[4];
+    face_vertices(f, ids);
+    glm::dvec3 centroid(0.0);
+    for (unsigned int v : ids)
+        centroid += vertex_position(v);
+    centroid /= 4.0;
+
+    streamline.clear();
+    streamline.push_back(centroid);
+    trace_xy_streamline(streamline, centroid, f, step_size, num_steps);
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Sampling
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+void StructuredGrid2D::sample(const glm::dvec3* points, size_t count, const FieldSamples& out) const
+{
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+
+    // the columns are decoded here, before the threads need them
+    struct Column { const float* float32; const double* float64; double* values; };
+    std::vector<Column> columns;
+    for (size_t c = 0; c < out.columns.size(); c++)
+        columns.push_back({ out.columns[c]->float32_data(), out.columns[c]->float64_data(), out.column_values[c] });
+
+    // locate and cell_corners in one, the lattice coordinates worked out once per point
+    const double max_fx = static_cast<double>(m_nx - 1), max_fy = static_cast<double>(m_ny - 1);
+    parallel_for(count, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            const double fx = (points[i].x - m_origin.x) / m_spacing.x;
+            const double fy = (points[i].y - m_origin.y) / m_spacing.y;
+            if (!(fx >= 0.0 && fx <= max_fx && fy >= 0.0 && fy <= max_fy))
+            {
+                if (out.scalars)
+                    out.scalars[i] = nan;
+                if (out.vectors)
+                    out.vectors[i] = glm::dvec3(nan);
+                for (Column& column : columns)
+                    column.values[i] = nan;
+                continue;
+            }
+            const size_t ci = std::min(static_cast<size_t>(fx), m_nx - 2);
+            const size_t cj = std::min(static_cast<size_t>(fy), m_ny - 2);
+            const double u = fx - static_cast<double>(ci);
+            const double w = fy - static_cast<double>(cj);
+            const unsigned int ids[4] = { node_vertex(ci, cj), node_vertex(ci + 1, cj),
+                                          node_vertex(ci, cj + 1), node_vertex(ci + 1, cj + 1) };
+            const double weights[4] = { (1.0 - u) * (1.0 - w), u * (1.0 - w), (1.0 - u) * w, u * w };
+            if (out.scalars)
+            {
+                out.scalars[i] = weights[0] * m_scalars[ids[0]] + weights[1] * m_scalars[ids[1]] +
+                                 weights[2] * m_scalars[ids[2]] + weights[3] * m_scalars[ids[3]];
+            }
+            if (out.vectors)
+            {
+                glm::dvec3 vxy = weights[0] * m_vectors[ids[0]] + weights[1] * m_vectors[ids[1]] +
+                                 weights[2] * m_vectors[ids[2]] + weights[3] * m_vectors[ids[3]];
+                out.vectors[i] = glm::dvec3(vxy.x, vxy.y, 0.0);
+            }
+            for (Column& column : columns)
+            {
+                double sum = 0.0;
+                for (int k = 0; k < 4; k++)
+                    sum += weights[k] * (column.float32 ? double(column.float32[ids[k]]) : column.float64[ids[k]]);
+                column.values[i] = sum;
+            }
+        }
+    }, 4096);
+}
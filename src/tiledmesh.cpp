@@ -0,0 +1,506 @@
+#include "tiledmesh.h"
+#include "plyreader.h"
+#include "drawitem.h"
+#include <iostream>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// Building Tiles
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+// vertex slots written to each tile, normals are recomputed when a tile is loaded,
+// the attribute columns follow at their own precision
+static const int TILE_SLOTS[] = { SLOT_X, SLOT_Y, SLOT_Z, SLOT_S, SLOT_VX, SLOT_VY, SLOT_VZ };
+static const char* TILE_SLOT_NAMES[] = { "x", "y", "z", "s", "vx", "vy", "vz" };
+static const size_t NUM_TILE_SLOTS = sizeof(TILE_SLOTS) / sizeof(TILE_SLOTS[0]);
+
+static bool write_tile_file(const std::string& filename, const PlyData& ply,
+    const std::vector<uint32_t>& vertices, const std::vector<uint32_t>& faces,
+    const std::vector<uint32_t>& local_index)
+{
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    out << "ply\n";
+    out << (host_is_little_endian() ? "format binary_little_endian 1.0\n" : "format binary_big_endian 1.0\n");
+    out << "element vertex " << vertices.size() << "\n";
+    for (const char* name : TILE_SLOT_NAMES)
+        out << "property float64 " << name << "\n";
+    size_t record_size = NUM_TILE_SLOTS * sizeof(double);
+    for (const std::shared_ptr<AttributeColumn>& column : ply.attributes.columns())
+    {
+        bool single = column->type() == AttributeType::Float32;
+        out << (single ? "property float32 " : "property float64 ") << column->name() << "\n";
+        record_size += single ? sizeof(float) : sizeof(double);
+    }
+    out << "element face " << faces.size() << "\n";
+    out << "property list uint8 uint32 vertex_indices\n";
+    out << "end_header\n";
+
+    std::vector<char> record(record_size);
+    for (uint32_t v : vertices)
+    {
+        const double* a = &ply.vertex_values[static_cast<size_t>(v) * NUM_VERTEX_SLOTS];
+        char* p = record.data();
+        for (size_t k = 0; k < NUM_TILE_SLOTS; k++, p += sizeof(double))
+            std::memcpy(p, &a[TILE_SLOTS[k]], sizeof(double));
+        for (const std::shared_ptr<AttributeColumn>& column : ply.attributes.columns())
+        {
+            if (const float* values = column->float32_data())
+            {
+                std::memcpy(p, &values[v], sizeof(float));
+                p += sizeof(float);
+            }
+            else
+            {
+                std::memcpy(p, &column->float64_data()[v], sizeof(double));
+                p += sizeof(double);
+            }
+        }
+        out.write(record.data(), record.size());
+    }
+
+    for (uint32_t f : faces)
+    {
+        const unsigned char n = 4;
+        uint32_t idx[4];
+        for (int j = 0; j < 4; j++)
+            idx[j] = local_index[ply.face_indices[static_cast<size_t>(f) * 4 + j]];
+        out.write(reinterpret_cast<const char*>(&n), 1);
+        out.write(reinterpret_cast<const char*>(idx), sizeof(idx));
+    }
+    return static_cast<bool>(out);
+}
+
+bool TiledMesh::build_tiles(const char* ply_filename, const char* index_filename, int tiles_x, int tiles_y)
+{
+    // the partitioning pass works on the flattened file contents, never the full element graph
+    PlyData ply;
+    if (!read_ply_file(ply_filename, ply))
+        return false;
+    if (ply.num_vertices == 0 || ply.face_ids.empty() || tiles_x < 1 || tiles_y < 1)
+    {
+        std::cout << "Nothing to tile in " << ply_filename << std::endl;
+        return false;
+    }
+
+    glm::dvec3 min_pt(ply.vertex_values[SLOT_X], ply.vertex_values[SLOT_Y], ply.vertex_values[SLOT_Z]);
+    glm::dvec3 max_pt = min_pt;
+    double min_scalar = ply.vertex_values[SLOT_S];
+    double max_scalar = min_scalar;
+    for (size_t i = 0; i < ply.num_vertices; i++)
+    {
+        const double* a = &ply.vertex_values[i * NUM_VERTEX_SLOTS];
+        glm::dvec3 p(a[SLOT_X], a[SLOT_Y], a[SLOT_Z]);
+        min_pt = glm::min(min_pt, p);
+        max_pt = glm::max(max_pt, p);
+        min_scalar = std::min(min_scalar, a[SLOT_S]);
+        max_scalar = std::max(max_scalar, a[SLOT_S]);
+    }
+
+    // assign each face to the tile holding its centroid, then bucket the faces by tile
+    const size_t num_faces = ply.face_ids.size();
+    const size_t num_tiles = static_cast<size_t>(tiles_x) * static_cast<size_t>(tiles_y);
+    glm::dvec2 extent = glm::max(glm::dvec2(max_pt - min_pt), glm::dvec2(1e-300));
+    std::vector<uint32_t> face_tile(num_faces);
+    std::vector<size_t> tile_offsets(num_tiles + 1, 0);
+    for (size_t f = 0; f < num_faces; f++)
+    {
+        glm::dvec2 centroid(0.0);
+        for (int j = 0; j < 4; j++)
+        {
+            const double* a = &ply.vertex_values[static_cast<size_t>(ply.face_indices[f * 4 + j]) * NUM_VERTEX_SLOTS];
+            centroid += 0.25 * glm::dvec2(a[SLOT_X], a[SLOT_Y]);
+        }
+        glm::dvec2 t = (centroid - glm::dvec2(min_pt)) / extent;
+        int tx = std::min(tiles_x - 1, std::max(0, static_cast<int>(t.x * tiles_x)));
+        int ty = std::min(tiles_y - 1, std::max(0, static_cast<int>(t.y * tiles_y)));
+        face_tile[f] = static_cast<uint32_t>(ty * tiles_x + tx);
+        tile_offsets[face_tile[f] + 1]++;
+    }
+    for (size_t t = 0; t < num_tiles; t++)
+        tile_offsets[t + 1] += tile_offsets[t];
+    std::vector<uint32_t> tile_faces(num_faces);
+    std::vector<size_t> fill(tile_offsets.begin(), tile_offsets.end() - 1);
+    for (size_t f = 0; f < num_faces; f++)
+        tile_faces[fill[face_tile[f]]++] = static_cast<uint32_t>(f);
+
+    std::filesystem::path index_path(index_filename);
+    std::filesystem::path directory = index_path.parent_path();
+    std::string stem = index_path.stem().string();
+
+    std::ofstream index(index_filename);
+    if (!index)
+    {
+        std::cout << "Could not write tile index: " << index_filename << std::endl;
+        return false;
+    }
+    index.precision(17);
+    index << "tiles 1\n";
+    index << "bounds " << min_pt.x << " " << min_pt.y << " " << min_pt.z << " "
+          << max_pt.x << " " << max_pt.y << " " << max_pt.z << "\n";
+    index << "scalar " << min_scalar << " " << max_scalar << "\n";
+
+    // vertices on tile borders are copied into every tile that uses them, the stamp
+    // array lets us renumber each tile's vertices without clearing a map per tile
+    std::vector<uint32_t> stamp(ply.num_vertices, UINT32_MAX);
+    std::vector<uint32_t> local_index(ply.num_vertices, 0);
+    std::vector<uint32_t> vertices, faces;
+    for (size_t t = 0; t < num_tiles; t++)
+    {
+        if (tile_offsets[t] == tile_offsets[t + 1])
+            continue;
+
+        vertices.clear();
+        faces.assign(tile_faces.begin() + tile_offsets[t], tile_faces.begin() + tile_offsets[t + 1]);
+        glm::dvec2 tile_min(std::numeric_limits<double>::max());
+        glm::dvec2 tile_max(-std::numeric_limits<double>::max());
+        for (uint32_t f : faces)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                uint32_t v = ply.face_indices[static_cast<size_t>(f) * 4 + j];
+                if (stamp[v] != t)
+                {
+                    stamp[v] = static_cast<uint32_t>(t);
+                    local_index[v] = static_cast<uint32_t>(vertices.size());
+                    vertices.push_back(v);
+                }
+                const double* a = &ply.vertex_values[static_cast<size_t>(v) * NUM_VERTEX_SLOTS];
+                tile_min = glm::min(tile_min, glm::dvec2(a[SLOT_X], a[SLOT_Y]));
+                tile_max = glm::max(tile_max, glm::dvec2(a[SLOT_X], a[SLOT_Y]));
+            }
+        }
+
+        std::string tile_name = stem + "_" + std::to_string(t % tiles_x) + "_" + std::to_string(t / tiles_x) + ".ply";
+        if (!write_tile_file((directory / tile_name).string(), ply, vertices, faces, local_index))
+        {
+            std::cout << "Could not write tile file: " << tile_name << std::endl;
+            return false;
+        }
+        index << "tile " << vertices.size() << " " << faces.size() << " "
+              << tile_min.x << " " << tile_min.y << " " << tile_max.x << " " << tile_max.y << " "
+              << tile_name << "\n";
+    }
+
+    std::cout << "Wrote " << index_filename << " with tiles from " << ply_filename << std::endl;
+    return static_cast<bool>(index);
+}
+
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;// TiledMesh Class Methods
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+;///////////////////////////////////////////////////////////////////////////////
+
+TiledMesh::TiledMesh(const char* index_filename, size_t memory_budget, size_t gpu_budget)
+    : m_memory_budget(memory_budget), m_gpu_budget(gpu_budget)
+{
+    std::ifstream file(index_filename);
+    if (!file)
+    {
+        std::cout << "Could not open tile index: " << index_filename << std::endl;
+        return;
+    }
+
+    std::filesystem::path directory = std::filesystem::path(index_filename).parent_path();
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream iss(line);
+        std::string keyword;
+        iss >> keyword;
+        if (keyword == "bounds")
+            iss >> m_min.x >> m_min.y >> m_min.z >> m_max.x >> m_max.y >> m_max.z;
+        else if (keyword == "scalar")
+            iss >> m_min_scalar >> m_max_scalar;
+        else if (keyword == "tile")
+        {
+            Tile tile;
+            std::string name;
+            iss >> tile.num_vertices >> tile.num_faces
+                >> tile.min_xy.x >> tile.min_xy.y >> tile.max_xy.x >> tile.max_xy.y;
+            std::getline(iss >> std::ws, name);
+            tile.filename = (directory / name).string();
+            m_tiles.push_back(tile);
+        }
+    }
+
+    std::cout << "Opened tiled mesh from " << index_filename << " with " << m_tiles.size() << " tiles" << std::endl;
+}
+
+TiledMesh::~TiledMesh() {}
+
+size_t TiledMesh::num_tiles() const { return m_tiles.size(); }
+const TiledMesh::Tile& TiledMesh::tile(size_t i) const { return m_tiles[i]; }
+size_t TiledMesh::resident_bytes() const { return m_resident_bytes; }
+size_t TiledMesh::gpu_bytes() const { return m_gpu_bytes; }
+glm::dvec3 TiledMesh::midpoint() const { return 0.5 * (m_min + m_max); }
+double TiledMesh::get_radius() const { return 0.5 * glm::length(m_max - m_min); }
+
+void TiledMesh::set_memory_budget(size_t bytes)
+{
+    m_memory_budget = bytes;
+    evict_until_under_budget(SIZE_MAX);
+}
+
+void TiledMesh::set_gpu_budget(size_t bytes)
+{
+    // drawables over the new budget are released by the next update_residency
+    m_gpu_budget = bytes;
+}
+
+void TiledMesh::get_min_max_scalar(double& min_scalar, double& max_scalar) const
+{
+    min_scalar = m_min_scalar;
+    max_scalar = m_max_scalar;
+}
+
+void TiledMesh::get_min_max_coords(double& min_x, double& max_x, double& min_y,
+    double& max_y, double& min_z, double& max_z) const
+{
+    min_x = m_min.x; max_x = m_max.x;
+    min_y = m_min.y; max_y = m_max.y;
+    min_z = m_min.z; max_z = m_max.z;
+}
+
+std::shared_ptr<QuadMesh> TiledMesh::get_tile(size_t i)
+{
+    Tile& tile = m_tiles[i];
+    if (tile.mesh)
+    {
+        m_lru.remove(i);
+        m_lru.push_front(i);
+        return tile.mesh;
+    }
+
+    // tiles are small and already binary, a cache file per tile would only fill the cache
+    tile.mesh = std::make_shared<QuadMesh>(tile.filename.c_str(), false, nullptr, false);
+    tile.bytes = tile.mesh->footprint().cpu_total();
+    m_resident_bytes += tile.bytes;
+    m_lru.push_front(i);
+    evict_until_under_budget(i);
+    return tile.mesh;
+}
+
+void TiledMesh::evict_until_under_budget(size_t keep)
+{
+    // drop least recently used tiles first, callers still holding a tile keep it alive
+    while (m_resident_bytes > m_memory_budget && !m_lru.empty() && m_lru.back() != keep)
+    {
+        Tile& tile = m_tiles[m_lru.back()];
+        m_lru.pop_back();
+        tile.mesh = nullptr;
+        m_resident_bytes -= tile.bytes;
+        tile.bytes = 0;
+    }
+}
+
+std::vector<size_t> TiledMesh::tiles_overlapping(const glm::dvec2& min_xy, const glm::dvec2& max_xy) const
+{
+    std::vector<size_t> result;
+    for (size_t i = 0; i < m_tiles.size(); i++)
+    {
+        const Tile& tile = m_tiles[i];
+        if (tile.max_xy.x >= min_xy.x && tile.min_xy.x <= max_xy.x &&
+            tile.max_xy.y >= min_xy.y && tile.min_xy.y <= max_xy.y)
+            result.push_back(i);
+    }
+    return result;
+}
+
+void TiledMesh::update_residency(const glm::dvec2& min_xy, const glm::dvec2& max_xy,
+    std::vector<size_t>& load, std::vector<size_t>& release)
+{
+    load.clear();
+    release.clear();
+    std::vector<size_t> visible = tiles_overlapping(min_xy, max_xy);
+    std::vector<bool> in_view(m_tiles.size(), false);
+    for (size_t i : visible)
+    {
+        in_view[i] = true;
+        if (m_tiles[i].drawable == Drawable::Loading || m_tiles[i].drawable == Drawable::Drawn)
+        {
+            m_drawn.remove(i);
+            m_drawn.push_front(i);
+        }
+    }
+
+    // drawn tiles out of view can make room for the ones coming into view
+    size_t releasable = 0;
+    for (size_t i : m_drawn)
+    {
+        if (!in_view[i] && m_tiles[i].drawable == Drawable::Drawn)
+            releasable += m_tiles[i].gpu_bytes;
+    }
+
+    for (size_t i : visible)
+    {
+        Tile& tile = m_tiles[i];
+        if (tile.drawable != Drawable::None)
+            continue;
+        size_t bytes = estimate_gpu_bytes(tile);
+        if (m_gpu_bytes - releasable + bytes > m_gpu_budget)
+            break; // the tiles in view fill the budget, the rest are left out
+
+        // release drawn tiles out of view until it fits, least recently visible first
+        for (auto it = m_drawn.end(); m_gpu_bytes + bytes > m_gpu_budget;)
+        {
+            --it;
+            if (in_view[*it] || m_tiles[*it].drawable != Drawable::Drawn)
+                continue;
+            releasable -= m_tiles[*it].gpu_bytes;
+            release.push_back(*it);
+            release_drawable(*it);
+            it = m_drawn.erase(it);
+        }
+
+        tile.drawable = Drawable::Loading;
+        tile.gpu_bytes = bytes;
+        m_gpu_bytes += bytes;
+        m_drawn.push_front(i);
+        load.push_back(i);
+    }
+}
+
+void TiledMesh::tile_loaded(size_t i, size_t gpu_bytes)
+{
+    Tile& tile = m_tiles[i];
+    if (tile.drawable != Drawable::Loading)
+        return;
+    m_gpu_bytes -= tile.gpu_bytes;
+    tile.gpu_bytes = gpu_bytes;
+    m_gpu_bytes += gpu_bytes;
+    tile.drawable = (gpu_bytes > 0) ? Drawable::Drawn : Drawable::Failed;
+    if (gpu_bytes == 0)
+        m_drawn.remove(i);
+}
+
+void TiledMesh::release_drawable(size_t i)
+{
+    Tile& tile = m_tiles[i];
+    m_gpu_bytes -= tile.gpu_bytes;
+    tile.gpu_bytes = 0;
+    tile.drawable = Drawable::None;
+}
+
+size_t TiledMesh::estimate_gpu_bytes(const Tile& tile)
+{
+    // a surface's position and normal, attributes, neighbor offset and about 4
+    // neighbors per vertex, and two triangles per face
+    return tile.num_vertices * (6 + DrawItem::SURFACE_ATTRIBUTE_FLOATS) * sizeof(float) +
+           tile.num_vertices * 5 * sizeof(unsigned int) + tile.num_faces * 6 * sizeof(unsigned int);
+}
+
+Face TiledMesh::get_face_containing_xy_point(const glm::dvec3& point,
+    std::shared_ptr<QuadMesh>& tile_mesh)
+{
+    glm::dvec2 p(point.x, point.y);
+    for (size_t i : tiles_overlapping(p, p))
+    {
+        std::shared_ptr<QuadMesh> mesh = get_tile(i);
+        Face face = mesh->get_face_containing_xy_point(point);
+        if (face)
+        {
+            tile_mesh = mesh;
+            return face;
+        }
+    }
+    tile_mesh = nullptr;
+    return nullptr;
+}
+
+void TiledMesh::compute_xy_streamline(std::vector<glm::dvec3>& streamline,
+    const glm::dvec3& start_pos, double step_size, int num_steps)
+{
+    streamline.clear();
+    streamline.push_back(start_pos);
+
+    std::shared_ptr<QuadMesh> mesh;
+    Face face = get_face_containing_xy_point(start_pos, mesh);
+    if (!face)
+        return; // starting point is outside the mesh
+
+    // backward, flip, then forward, the same way QuadMesh::compute_xy_streamline does
+    trace_xy_streamline(streamline, start_pos, mesh, face, step_size, num_steps, -1);
+    std::reverse(streamline.begin(), streamline.end());
+    trace_xy_streamline(streamline, start_pos, mesh, face, step_size, num_steps, 1);
+}
+
+std::unique_ptr<QuadMesh> TiledMesh::compute_xy_streamlines(const glm::dvec2& min_xy, const glm::dvec2& max_xy,
+    int seeds_x, int seeds_y, double step_size, int num_steps)
+{
+    glm::dvec2 lo = glm::max(min_xy, glm::dvec2(m_min));
+    glm::dvec2 hi = glm::min(max_xy, glm::dvec2(m_max));
+    std::vector<std::vector<glm::dvec3>> streamlines;
+    if (lo.x < hi.x && lo.y < hi.y)
+    {
+        glm::dvec2 cell = (hi - lo) / glm::dvec2(seeds_x, seeds_y);
+        for (int y = 0; y < seeds_y; y++)
+        {
+            for (int x = 0; x < seeds_x; x++)
+            {
+                glm::dvec2 seed = lo + cell * glm::dvec2(x + 0.5, y + 0.5);
+                streamlines.emplace_back();
+                compute_xy_streamline(streamlines.back(), glm::dvec3(seed, 0.0), step_size, num_steps);
+            }
+        }
+    }
+    return std::make_unique<QuadMesh>(streamlines);
+}
+
+double TiledMesh::get_grid_spacing() const
+{
+    size_t num_faces = 0;
+    for (const Tile& tile : m_tiles)
+        num_faces += tile.num_faces;
+    glm::dvec3 extent = m_max - m_min;
+    return (num_faces > 0) ? std::sqrt(extent.x * extent.y / static_cast<double>(num_faces)) : 0.0;
+}
+
+void TiledMesh::trace_xy_streamline(std::vector<glm::dvec3>& streamline, glm::dvec3 pos,
+    std::shared_ptr<QuadMesh> mesh, Face face,
+    double step_size, int num_steps, int direction)
+{
+    // looked up again only when the streamline crosses into another tile
+    const FaceInterpolation* table = mesh->built_face_interpolation();
+    Face next_face = nullptr;
+    for (int step = 0; step < num_steps; step++)
+    {
+        glm::dvec3 next_pos = mesh->take_xy_streamline_step(pos, face, next_face, step_size, direction, table);
+        streamline.push_back(next_pos);
+
+        if (!next_face)
+        {
+            // the step stopped on a boundary edge of this tile, which may be shared with
+            // a neighboring tile, so look just past the edge in the direction of travel
+            if (next_pos == pos)
+                break; // zero vector field
+            glm::dvec3 travel = glm::normalize(next_pos - pos);
+            glm::dvec3 probe = next_pos + travel * (1e-6 * step_size);
+            std::shared_ptr<QuadMesh> next_mesh;
+            next_face = get_face_containing_xy_point(probe, next_mesh);
+            if (!next_face || next_mesh == mesh)
+                break; // streamline has exited the whole mesh
+            mesh = next_mesh;
+            table = mesh->built_face_interpolation();
+        }
+        pos = next_pos;
+        face = next_face;
+    }
+}
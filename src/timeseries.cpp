@@ -0,0 +1,263 @@
+#include "timeseries.h"
+#include "plyreader.h"
+#include "drawitem.h"
+#include "parallel.h"
+#include <iostream>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+TimeSeries::TimeSeries(const std::vector<std::string>& filenames, size_t num_vertices,
+    size_t ring_size, unsigned int num_decoders)
+    : m_filenames(filenames), m_num_vertices(num_vertices)
+{
+    m_ring.resize(std::max<size_t>(ring_size, 1));
+    if (num_decoders == 0)
+        num_decoders = std::max(num_worker_threads() / 2, 2u);
+    for (unsigned int i = 0; i < num_decoders; i++)
+        m_decoders.emplace_back(&TimeSeries::run_decoder, this);
+
+    std::cout << "Opened time series with " << m_filenames.size() << " frames" << std::endl;
+}
+
+TimeSeries::~TimeSeries()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_decoders)
+        thread.join();
+}
+
+// match a file name against a pattern where * is any run of characters and ? any one character
+static bool wildcard_match(const char* pattern, const char* name)
+{
+    if (*pattern == '\0')
+        return *name == '\0';
+    if (*pattern == '*')
+        return wildcard_match(pattern + 1, name) || (*name != '\0' && wildcard_match(pattern, name + 1));
+    if (*name != '\0' && (*pattern == '?' || *pattern == *name))
+        return wildcard_match(pattern + 1, name + 1);
+    return false;
+}
+
+// compare names with runs of digits compared by value, so frame_9 sorts before frame_10
+static bool natural_less(const std::string& a, const std::string& b)
+{
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size())
+    {
+        if (std::isdigit(static_cast<unsigned char>(a[i])) && std::isdigit(static_cast<unsigned char>(b[j])))
+        {
+            size_t i_end = i, j_end = j;
+            while (i_end < a.size() && std::isdigit(static_cast<unsigned char>(a[i_end]))) i_end++;
+            while (j_end < b.size() && std::isdigit(static_cast<unsigned char>(b[j_end]))) j_end++;
+
+            // skip leading zeros, then a longer run of digits is a bigger number
+            while (i < i_end - 1 && a[i] == '0') i++;
+            while (j < j_end - 1 && b[j] == '0') j++;
+            if (i_end - i != j_end - j)
+                return i_end - i < j_end - j;
+            int c = a.compare(i, i_end - i, b, j, j_end - j);
+            if (c != 0)
+                return c < 0;
+            i = i_end;
+            j = j_end;
+        }
+        else
+        {
+            if (a[i] != b[j])
+                return a[i] < b[j];
+            i++;
+            j++;
+        }
+    }
+    return a.size() - i < b.size() - j;
+}
+
+std::vector<std::string> TimeSeries::expand_pattern(const std::string& pattern)
+{
+    std::filesystem::path path(pattern);
+    std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+    std::string name_pattern = path.filename().string();
+
+    std::vector<std::string> filenames;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file() && wildcard_match(name_pattern.c_str(), name.c_str()))
+            filenames.push_back(entry.path().string());
+    }
+    sort_filenames(filenames);
+    return filenames;
+}
+
+void TimeSeries::sort_filenames(std::vector<std::string>& filenames)
+{
+    std::sort(filenames.begin(), filenames.end(), natural_less);
+}
+
+size_t TimeSeries::num_frames() const { return m_filenames.size(); }
+const std::string& TimeSeries::filename(size_t i) const { return m_filenames[i]; }
+
+void TimeSeries::seek(size_t i)
+{
+    if (m_filenames.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_position = i % m_filenames.size();
+    }
+    m_wake.notify_all();
+}
+
+size_t TimeSeries::position() const { return m_position; }
+
+std::shared_ptr<const TimeSeries::Frame> TimeSeries::frame(size_t i)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::shared_ptr<const Frame>& frame = m_ring[i % m_ring.size()];
+    return (frame && frame->index == i) ? frame : nullptr;
+}
+
+void TimeSeries::set_playing(bool playing)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_playing = playing;
+    m_next_frame_time = 0.0;
+}
+
+bool TimeSeries::playing() const { return m_playing; }
+
+void TimeSeries::set_frame_rate(double frames_per_second)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_frame_rate = std::max(frames_per_second, 0.1);
+}
+
+double TimeSeries::frame_rate() const { return m_frame_rate; }
+
+std::shared_ptr<const TimeSeries::Frame> TimeSeries::update(double time)
+{
+    if (m_filenames.empty())
+        return nullptr;
+
+    bool moved = false;
+    std::shared_ptr<const Frame> result;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // step to the next frame when the current one has been on screen long enough
+        const double period = 1.0 / m_frame_rate;
+        if (m_playing && m_shown == m_position && time >= m_next_frame_time)
+        {
+            m_position = (m_position + 1) % m_filenames.size();
+            moved = true;
+        }
+
+        if (m_shown != m_position)
+        {
+            const std::shared_ptr<const Frame>& frame = m_ring[m_position % m_ring.size()];
+            if (frame && frame->index == m_position)
+            {
+                m_shown = m_position;
+                m_next_frame_time = (m_next_frame_time + period > time) ? m_next_frame_time + period : time + period;
+                if (!frame->values.empty()) // frames that failed to decode are skipped
+                    result = frame;
+            }
+        }
+    }
+
+    if (moved)
+        m_wake.notify_all();
+    return result;
+}
+
+bool TimeSeries::in_window(size_t i) const
+{
+    size_t n = m_filenames.size();
+    size_t ahead = (i + n - m_position) % n;
+    return ahead < std::min(m_ring.size(), n);
+}
+
+void TimeSeries::run_decoder()
+{
+    while (true)
+    {
+        // find the nearest frame in the prefetch window that nobody has decoded yet
+        size_t next = SIZE_MAX;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&]
+            {
+                if (m_stop)
+                    return true;
+                size_t n = m_filenames.size();
+                for (size_t k = 0; k < std::min(m_ring.size(), n); k++)
+                {
+                    size_t i = (m_position + k) % n;
+                    const std::shared_ptr<const Frame>& frame = m_ring[i % m_ring.size()];
+                    if ((!frame || frame->index != i) &&
+                        std::find(m_decoding.begin(), m_decoding.end(), i) == m_decoding.end())
+                    {
+                        next = i;
+                        return true;
+                    }
+                }
+                return false;
+            });
+            if (m_stop)
+                return;
+            m_decoding.push_back(next);
+        }
+
+        // a frame that fails to decode is stored without values so it is not retried
+        std::shared_ptr<Frame> frame = std::make_shared<Frame>();
+        frame->index = next;
+        if (!decode_frame(next, *frame))
+        {
+            frame->values.clear();
+            frame->attributes.clear();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decoding.erase(std::find(m_decoding.begin(), m_decoding.end(), next));
+            if (in_window(next))
+                m_ring[next % m_ring.size()] = frame;
+        }
+        m_wake.notify_all();
+    }
+}
+
+bool TimeSeries::decode_frame(size_t i, Frame& frame) const
+{
+    PlyData ply;
+    if (!read_ply_file(m_filenames[i].c_str(), ply, false))
+        return false;
+    if (ply.num_vertices != m_num_vertices)
+    {
+        std::cout << "Time series frame " << m_filenames[i] << " has " << ply.num_vertices
+                  << " vertices instead of " << m_num_vertices << std::endl;
+        return false;
+    }
+
+    frame.values.resize(m_num_vertices * 4);
+    frame.attributes.resize(m_num_vertices * DrawItem::SURFACE_ATTRIBUTE_FLOATS);
+    for (size_t v = 0; v < m_num_vertices; v++)
+    {
+        const double* a = &ply.vertex_values[v * NUM_VERTEX_SLOTS];
+        double* values = &frame.values[v * 4];
+        values[0] = a[SLOT_S];
+        values[1] = a[SLOT_VX];
+        values[2] = a[SLOT_VY];
+        values[3] = a[SLOT_VZ];
+        DrawItem::surfaceAttributes(a[SLOT_S], glm::dvec3(a[SLOT_VX], a[SLOT_VY], a[SLOT_VZ]),
+            &frame.attributes[v * DrawItem::SURFACE_ATTRIBUTE_FLOATS]);
+    }
+    return true;
+}